@@ -0,0 +1,26 @@
+#ifndef CPPTL_CLOCK_H_INCLUDED
+# define CPPTL_CLOCK_H_INCLUDED
+
+# include <cpptl/forwards.h>
+
+namespace CppTL {
+
+/*! \brief Access to the system clocks.
+ */
+class CPPTL_API Clock
+{
+public:
+   /// Returns the time in seconds elapsed since an unspecified origin.
+   /// The time is not affected by system clock adjustment.
+   static double monotonic();
+
+   /// Returns the processor time in seconds consumed by the calling thread.
+   /// Falls back to the processor time of the process if the platform does not
+   /// provide per thread times.
+   static double threadCpu();
+};
+
+} // namespace CppTL
+
+
+#endif // CPPTL_CLOCK_H_INCLUDED
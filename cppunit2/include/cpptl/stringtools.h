@@ -240,6 +240,29 @@ namespace CppTL {
 #endif
 
 
+/*! \brief Returns a hash of the string that is stable across runs and platforms.
+ * The 32 bits FNV-1a hash is used. Unlike a pointer based hash, it can be used to
+ * partition data consistently between several processes or machines.
+ */
+inline unsigned int
+stableHash( const char *first, const char *last )
+{
+   unsigned int hash = 2166136261u;
+   for ( ; first != last; ++first )
+   {
+      hash ^= (unsigned char)*first;
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+inline unsigned int
+stableHash( const ConstString &text )
+{
+   return stableHash( text.c_str(), text.c_str() + text.length() );
+}
+
+
 inline void
 escapeControl( char c, CppTL::StringBuffer &escaped, const char *newLineEscape = "\\n" )
 {
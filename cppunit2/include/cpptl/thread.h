@@ -44,6 +44,44 @@ private:
    void *data_;
 # endif
 };
+
+
+# if CPPTL_HAS_THREAD
+/*! \brief Minimal thread handle.
+ * The thread runs the functor passed to start(), then processes the thread exit
+ * handlers so that ThreadLocalStorage values are released.
+ * The destructor joins the thread if it is still joinable.
+ */
+class CPPTL_API Thread : public NonCopyable
+{
+public:
+   Thread();
+   ~Thread();
+
+   /// Starts a new thread that calls \c run. Returns \c false if the thread could
+   /// not be created.
+   bool start( const Functor0 &run );
+
+   /// Waits for the thread to complete. Returns \c false if the thread could not
+   /// be joined, a thread joining itself for example. It is still joinable then.
+   bool join();
+
+   bool isJoinable() const;
+
+   /// Gives up the remaining of the current thread time slice.
+   static void yield();
+
+   /// Suspends the current thread for the given duration.
+   static void sleep( unsigned int milliseconds );
+
+   /// Returns the number of processors available, or 1 if it can not be determined.
+   static unsigned int hardwareConcurrency();
+
+private:
+   Functor0 run_;
+   void *data_;
+};
+# endif // # if CPPTL_HAS_THREAD
  
    
 // //////////////////////////////////////////////////////////////////
@@ -0,0 +1,69 @@
+#ifndef CPPTL_WORKQUEUE_H_INCLUDED
+# define CPPTL_WORKQUEUE_H_INCLUDED
+
+# include <cpptl/thread.h>
+# include <deque>
+
+namespace CppTL {
+
+/*! \brief Double ended work queue that supports work-stealing.
+ *
+ * The owner thread takes items from the front of the queue using pop(), while other
+ * threads take items from the back using steal(). The owner therefore processes its
+ * items in the order they were pushed, and thieves take the items the owner would
+ * process last.
+ *
+ * Notes: the queue is protected by a Mutex. Contention is low since the owner and
+ * thieves only compete when a thread runs out of work.
+ */
+template<class ValueType>
+class WorkStealingQueue : public NonCopyable
+{
+public:
+   typedef std::deque<ValueType> Items;
+
+   void push( const ValueType &value )
+   {
+      Mutex::ScopedLockGuard guard( lock_ );
+      items_.push_back( value );
+   }
+
+   /// Takes the next item for the owner thread.
+   /// @returns \c false if the queue is empty.
+   bool pop( ValueType &value )
+   {
+      Mutex::ScopedLockGuard guard( lock_ );
+      if ( items_.empty() )
+         return false;
+      value = items_.front();
+      items_.pop_front();
+      return true;
+   }
+
+   /// Takes an item on behalf of another thread.
+   /// @returns \c false if the queue is empty.
+   bool steal( ValueType &value )
+   {
+      Mutex::ScopedLockGuard guard( lock_ );
+      if ( items_.empty() )
+         return false;
+      value = items_.back();
+      items_.pop_back();
+      return true;
+   }
+
+   bool empty() const
+   {
+      Mutex::ScopedLockGuard guard( lock_ );
+      return items_.empty();
+   }
+
+private:
+   mutable Mutex lock_;
+   Items items_;
+};
+
+} // namespace CppTL
+
+
+#endif // CPPTL_WORKQUEUE_H_INCLUDED
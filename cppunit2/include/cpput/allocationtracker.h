@@ -0,0 +1,165 @@
+#ifndef CPPUT_ALLOCATIONTRACKER_H_INCLUDED
+# define CPPUT_ALLOCATIONTRACKER_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <cpput/assertcommon.h>
+# include <stddef.h>
+
+namespace CppUT {
+
+/*! \brief Heap allocations made by a thread.
+ * \ingroup group_allocation
+ *
+ * The allocations are only counted if the program is linked with the
+ * cpput_allocationhooks library, which replaces the global operator new and
+ * operator delete (and malloc() and free() with the GNU C library). The sizes
+ * are the usable sizes of the allocated blocks, which may be slightly larger
+ * than the requested ones.
+ *
+ * Memory allocated by a thread and freed by another one is counted as live
+ * by the first thread.
+ */
+struct CPPUT_API AllocationCounters
+{
+   AllocationCounters();
+
+   CppTL::LargestUnsignedInt allocationCount_;
+   CppTL::LargestUnsignedInt deallocationCount_;
+   CppTL::LargestUnsignedInt allocatedBytes_;
+   CppTL::LargestUnsignedInt deallocatedBytes_;
+   /// Bytes allocated but not freed yet. May be negative if the thread freed
+   /// memory allocated by another thread.
+   CppTL::LargestInt liveBytes_;
+   CppTL::LargestInt peakLiveBytes_;
+};
+
+
+/// Returns \c true if the program is linked with the cpput_allocationhooks
+/// library.
+bool CPPUT_API areAllocationHooksInstalled();
+
+/*! \brief Enables tracking the allocations of each test.
+ * \ingroup group_allocation
+ *
+ * When enabled, TestMeta::runTest() stores the allocations made by each phase
+ * of the test in the "allocations" statistics of the test status, and fails the
+ * test if some memory it allocated is still live once its TestCase has been
+ * destroyed. See LightTestRunner option --track-allocations.
+ *
+ * The leak check relies on AllocationRegion::liveAllocationCount(): a test
+ * that frees memory allocated before it started can hide its own leaks.
+ */
+void CPPUT_API setAllocationTracking( bool enabled );
+
+bool CPPUT_API isAllocationTrackingEnabled();
+
+/// Returns the allocations made by the current thread since it started.
+AllocationCounters CPPUT_API threadAllocationCounters();
+
+
+/*! \brief Counts the heap allocations made by the current thread while alive.
+ * \ingroup group_allocation
+ *
+ * \code
+ * CppUT::AllocationRegion region;
+ * cache.lookup( key );
+ * CPPUT_CHECK( region.allocationCount() == 0 );
+ * \endcode
+ * See also CPPUT_CHECK_NO_ALLOCATION().
+ */
+class CPPUT_API AllocationRegion
+{
+public:
+   AllocationRegion();
+
+   ~AllocationRegion();
+
+   CppTL::LargestUnsignedInt allocationCount() const;
+
+   CppTL::LargestUnsignedInt allocatedBytes() const;
+
+   /*! Number of allocations made in the region minus the number of blocks
+    * freed in it. Freeing a block allocated before the region, or by another
+    * thread, is counted too: it may hide an allocation of the region that is
+    * still live, or make the count negative.
+    */
+   CppTL::LargestInt liveAllocationCount() const;
+
+   CppTL::LargestInt liveBytes() const;
+
+   /// Maximum of liveBytes() since the region was created.
+   CppTL::LargestInt peakLiveBytes() const;
+
+private:
+   AllocationRegion( const AllocationRegion &other );
+   AllocationRegion &operator =( const AllocationRegion &other );
+
+   AllocationCounters start_;
+};
+
+
+/*! \brief Stops counting the allocations of the current thread while alive.
+ * \ingroup group_allocation
+ * Used by the framework, so that the memory it keeps on behalf of a test,
+ * such as the failed assertions, is not reported as leaked by the test.
+ */
+class CPPUT_API AllocationTrackingPause
+{
+public:
+   AllocationTrackingPause();
+
+   ~AllocationTrackingPause();
+
+private:
+   AllocationTrackingPause( const AllocationTrackingPause &other );
+   AllocationTrackingPause &operator =( const AllocationTrackingPause &other );
+};
+
+
+/// Checks that no allocation was made in the region.
+CheckerResult CPPUT_API checkNoAllocation( const AllocationRegion &region,
+                                           const char *expressionCode );
+
+
+namespace Impl {
+
+   /// Called by the allocation hooks.
+   void CPPUT_API recordAllocation( size_t size );
+
+   /// Called by the allocation hooks.
+   void CPPUT_API recordDeallocation( size_t size );
+
+   /// Called by the allocation hooks when they are initialized.
+   void CPPUT_API setAllocationHooksInstalled();
+
+} // namespace Impl
+
+} // namespace CppUT
+
+
+/*! \brief Checks that evaluating an expression performs no heap allocation.
+ * \ingroup group_allocation
+ * Fails if the program is not linked with the cpput_allocationhooks library.
+ * \see CppUT::AllocationRegion
+ */
+# define CPPUT_CHECK_NO_ALLOCATION( expression )                              \
+   {                                                                          \
+      ::CppUT::AllocationRegion cpputAllocationRegion;                        \
+      expression;                                                             \
+      CPPUT_BEGIN_CHECKING_MACRO()                                            \
+         ::CppUT::checkNoAllocation( cpputAllocationRegion, #expression );    \
+   }
+
+/*! \brief Asserts that evaluating an expression performs no heap allocation.
+ * \ingroup group_allocation
+ * \see CPPUT_CHECK_NO_ALLOCATION()
+ */
+# define CPPUT_ASSERT_NO_ALLOCATION( expression )                             \
+   {                                                                          \
+      ::CppUT::AllocationRegion cpputAllocationRegion;                        \
+      expression;                                                             \
+      CPPUT_BEGIN_ASSERTION_MACRO()                                           \
+         ::CppUT::checkNoAllocation( cpputAllocationRegion, #expression );    \
+   }
+
+#endif // CPPUT_ALLOCATIONTRACKER_H_INCLUDED
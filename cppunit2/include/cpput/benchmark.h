@@ -0,0 +1,435 @@
+#ifndef CPPUT_BENCHMARK_H_INCLUDED
+# define CPPUT_BENCHMARK_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <cpput/testing.h>
+# include <json/value.h>
+# include <string>
+# include <vector>
+
+namespace CppUT {
+
+/*! \brief Iteration count of a benchmark sample, passed to the benchmark body.
+ * \ingroup group_benchmark
+ *
+ * The body runs the measured operation iterationCount() times:
+ * \code
+ * CPPUT_BENCHMARK( benchStringCopy )
+ * {
+ *    std::string source( 100, 'x' );
+ *    while ( state.keepRunning() )
+ *       CppUT::doNotOptimize( std::string( source ) );
+ * }
+ * \endcode
+ * The body is called once per sample. Only the iterations are timed, from the
+ * first to the last keepRunning() call, so the set up code before the loop is
+ * not measured. A body that does not call keepRunning() is timed as a whole.
+ */
+class CPPUT_API BenchmarkState
+{
+public:
+   typedef CppTL::LargestUnsignedInt IterationCount;
+
+   explicit BenchmarkState( IterationCount iterationCount,
+                            unsigned int range = 0,
+                            unsigned int threadIndex = 0,
+                            unsigned int threadCount = 1 );
+
+   /// Number of times the body must run the measured operation.
+   IterationCount iterationCount() const
+   {
+      return iterationCount_;
+   }
+
+   /// Input size the operation must be measured with, for a benchmark
+   /// registered with a BenchmarkRange. 0 otherwise.
+   unsigned int range() const
+   {
+      return range_;
+   }
+
+   /// Index of the thread running the body, in [0, threadCount()).
+   unsigned int threadIndex() const
+   {
+      return threadIndex_;
+   }
+
+   /// Number of threads running the body at the same time, for a benchmark
+   /// created by makeThreadedBenchmark(). 1 otherwise.
+   unsigned int threadCount() const
+   {
+      return threadCount_;
+   }
+
+   /// Returns \c true until the operation has been run iterationCount() times.
+   bool keepRunning()
+   {
+      if ( remaining_ != iterationCount_  &&  remaining_ != 0 )
+      {
+         --remaining_;
+         return true;
+      }
+      return startOrStop();
+   }
+
+   /// Duration in seconds of the keepRunning() loop, 0 if it was not run.
+   double loopDuration() const
+   {
+      return stopTime_ - startTime_;
+   }
+
+   /// CppTL::Clock::monotonic() time of the first keepRunning() call.
+   double loopStartTime() const
+   {
+      return startTime_;
+   }
+
+private:
+   /// Starts the timer on the first keepRunning() call, and stops it on the last.
+   bool startOrStop();
+
+   IterationCount iterationCount_;
+   IterationCount remaining_;
+   unsigned int range_;
+   unsigned int threadIndex_;
+   unsigned int threadCount_;
+   double startTime_;
+   double stopTime_;
+};
+
+
+typedef void (*BenchmarkFn)( BenchmarkState &state );
+
+
+/*! \brief How benchmarks are measured.
+ * \ingroup group_benchmark
+ * See setBenchmarkSettings().
+ */
+struct CPPUT_API BenchmarkSettings
+{
+   BenchmarkSettings();
+
+   /// Duration in seconds the iteration count of a sample is calibrated to.
+   double sampleTime_;
+   /// Minimum duration in seconds the benchmark is run before sampling it.
+   double warmUpTime_;
+   /// Number of samples measured.
+   unsigned int sampleCount_;
+};
+
+
+/*! \brief Statistics of the samples of a benchmark, in nanoseconds per operation.
+ * \ingroup group_benchmark
+ *
+ * The outliers, outside of [q1 - 1.5 iqr, q3 + 1.5 iqr] where iqr is the
+ * interquartile range, are rejected before computing the statistics.
+ */
+struct CPPUT_API BenchmarkStatistics
+{
+   BenchmarkStatistics();
+
+   /// Computes the statistics of the samples.
+   static BenchmarkStatistics compute( const std::vector<double> &samples );
+
+   /// Returns the statistics as stored in the "benchmark" statistics of the
+   /// benchmark TestStatus.
+   Json::Value toJson() const;
+
+   /// Samples kept after rejecting the outliers, in measurement order.
+   std::vector<double> samples_;
+   unsigned int outlierCount_;
+   double mean_;
+   double median_;
+   double p99_;
+   double min_;
+   double max_;
+   double standardDeviation_;
+};
+
+
+/*! \brief Comparison of the samples of a benchmark to baseline samples.
+ * \ingroup group_benchmark
+ *
+ * The significance of the difference is given by a two-sided Mann-Whitney U
+ * test, which does not assume the samples to be normally distributed. It uses
+ * the normal approximation of U, corrected for ties, which is accurate from
+ * about 8 samples on each side.
+ */
+struct CPPUT_API BenchmarkComparison
+{
+   BenchmarkComparison();
+
+   static BenchmarkComparison compare( const std::vector<double> &baselineSamples,
+                                       const std::vector<double> &samples );
+
+   double baselineMedian_;
+   double median_;
+   /// Relative change of the median: 0.1 means 10% slower than the baseline.
+   double change_;
+   /// Probability of samples at least as different if both sets were drawn from
+   /// the same distribution. 1 if there are no samples.
+   double pValue_;
+};
+
+
+/*! \brief Input sizes a benchmark is measured with.
+ * \ingroup group_benchmark
+ * The sizes go from \a first to \a last, each one being \a multiplier times
+ * the previous one. \a last is always measured.
+ */
+struct CPPUT_API BenchmarkRange
+{
+   BenchmarkRange( unsigned int first = 0,
+                   unsigned int last = 0,
+                   unsigned int multiplier = 2 );
+
+   bool isEmpty() const;
+
+   std::vector<unsigned int> sizes() const;
+
+   unsigned int first_;
+   unsigned int last_;
+   unsigned int multiplier_;
+};
+
+
+/*! \brief Asymptotic complexity of a benchmark, ordered from the fastest growing
+ * to the slowest one.
+ * \ingroup group_benchmark
+ */
+enum BenchmarkComplexity
+{
+   complexityConstant = 0,    ///< O(1)
+   complexityLogarithmic,     ///< O(log n)
+   complexityLinear,          ///< O(n)
+   complexityLinearithmic,    ///< O(n log n)
+   complexityQuadratic,       ///< O(n^2)
+   complexityUnspecified      ///< No complexity is expected.
+};
+
+/// Returns the name of the complexity, "O(n log n)" for example.
+const char * CPPUT_API complexityName( BenchmarkComplexity complexity );
+
+
+/*! \brief Least squares fit of the duration of a benchmark to its input size.
+ * \ingroup group_benchmark
+ *
+ * The durations are fitted to coefficient_ * f(n) for each complexity f. The
+ * best fit is the one with the smallest root mean square of the residuals.
+ */
+struct CPPUT_API BenchmarkComplexityFit
+{
+   BenchmarkComplexityFit();
+
+   /// Fits the durations measured for each input size.
+   static BenchmarkComplexityFit compute( const std::vector<unsigned int> &sizes,
+                                          const std::vector<double> &durations );
+
+   /// Fits the durations to a given complexity.
+   static BenchmarkComplexityFit compute( const std::vector<unsigned int> &sizes,
+                                          const std::vector<double> &durations,
+                                          BenchmarkComplexity complexity );
+
+   BenchmarkComplexity complexity_;
+   double coefficient_;
+   /// Root mean square of the residuals, relative to the mean duration.
+   double rms_;
+};
+
+
+/*! \brief Sets how the benchmarks are measured.
+ * \ingroup group_benchmark
+ * Must be called before running the benchmarks. See LightTestRunner options
+ * --benchmark-time, --benchmark-warmup and --benchmark-samples.
+ */
+void CPPUT_API setBenchmarkSettings( const BenchmarkSettings &settings );
+
+const BenchmarkSettings & CPPUT_API benchmarkSettings();
+
+
+/*! \brief Creates a test that measures a benchmark.
+ * \ingroup group_benchmark
+ *
+ * The iteration count of a sample is calibrated so that it lasts about
+ * BenchmarkSettings::sampleTime_. The benchmark is then warmed up, and
+ * BenchmarkSettings::sampleCount_ samples are measured. The BenchmarkStatistics
+ * of the samples, along with the iteration count and the throughput in
+ * operations per second, are stored in the "benchmark" statistics of the test
+ * status.
+ *
+ * The benchmark belongs to the group "benchmark", so it can be selected or
+ * excluded with a group filter (--groups "!benchmark").
+ */
+TestMeta CPPUT_API makeBenchmark( BenchmarkFn run,
+                                  const std::string &name );
+
+TestMeta CPPUT_API makeBenchmark( BenchmarkFn run,
+                                  const MetaData &metaData );
+
+/*! \brief Creates a benchmark measured for each size of a range.
+ * \ingroup group_benchmark
+ *
+ * The benchmark is measured as by makeBenchmark() for each size, which the body
+ * gets from BenchmarkState::range(). The median durations are then fitted to
+ * the complexities (BenchmarkComplexityFit). The median of each size and the
+ * best fit are stored in the "sweep" statistics of the test status, and the
+ * statistics of the last size in its "benchmark" statistics.
+ *
+ * The benchmark fails if the best fit grows faster than \a expected. The range
+ * should be wide enough for the complexities to be told apart, 8 to 1M for
+ * example.
+ */
+TestMeta CPPUT_API makeBenchmark( BenchmarkFn run,
+                                  const MetaData &metaData,
+                                  const BenchmarkRange &range,
+                                  BenchmarkComplexity expected = complexityUnspecified );
+
+
+/*! \brief Creates a benchmark run simultaneously on an increasing number of
+ * threads.
+ * \ingroup group_benchmark
+ *
+ * The benchmark is measured on 1, 2, 4... up to \a maxThreadCount threads, 0
+ * meaning CppTL::Thread::hardwareConcurrency(). For each sample, the threads
+ * wait on a barrier, so that they start running the body together, and each
+ * one runs the same number of iterations. A sample lasts from the first
+ * keepRunning() call to the last one of all the threads. The body gets its
+ * thread from BenchmarkState::threadIndex().
+ *
+ * The throughput in operations per second and the scaling efficiency, the
+ * throughput divided by the thread count and the single thread throughput, are
+ * stored for each thread count in the "scaling" statistics of the test status.
+ * The statistics of a single thread are stored in its "benchmark" statistics.
+ *
+ * Assertions failing on the other threads than the first one are reported
+ * without their details.
+ */
+TestMeta CPPUT_API makeThreadedBenchmark( BenchmarkFn run,
+                                          const MetaData &metaData,
+                                          unsigned int maxThreadCount = 0 );
+
+
+/*! \brief Forces the compiler to compute \a value, as if it was used.
+ * \ingroup group_benchmark
+ * Prevents the measured operation from being optimized away when its result
+ * is not used.
+ */
+template<class ValueType>
+inline void doNotOptimize( const ValueType &value );
+
+/*! \brief Forces the compiler to perform all pending writes to memory.
+ * \ingroup group_benchmark
+ */
+inline void clobberMemory();
+
+
+namespace Impl {
+
+   /// Prevents the compiler from assuming anything about the pointed memory.
+   void CPPUT_API escape( const void *pointer );
+
+   class CPPUT_API BenchmarkRegisterer
+   {
+   public:
+      BenchmarkRegisterer( Suite suite,
+                           const TestMeta &benchmark );
+   };
+
+} // namespace Impl
+
+
+# if defined(__GNUC__)
+template<class ValueType>
+inline void doNotOptimize( const ValueType &value )
+{
+   __asm__ __volatile__( "" : : "g"(&value) : "memory" );
+}
+
+inline void clobberMemory()
+{
+   __asm__ __volatile__( "" : : : "memory" );
+}
+# else
+// Falls back to calls the compiler can not see through.
+template<class ValueType>
+inline void doNotOptimize( const ValueType &value )
+{
+   Impl::escape( &value );
+}
+
+inline void clobberMemory()
+{
+   Impl::escape( 0 );
+}
+# endif
+
+} // namespace CppUT
+
+
+/*! \brief Declares and registers a benchmark in the current suite.
+ * \ingroup group_benchmark
+ * The body is a static void function taking a CppUT::BenchmarkState &state
+ * parameter. See makeBenchmark() and BenchmarkState.
+ */
+# define CPPUT_BENCHMARK( benchmarkName )                                          \
+   static void benchmarkName( ::CppUT::BenchmarkState &state );                    \
+   static ::CppUT::Impl::BenchmarkRegisterer                                       \
+      CPPTL_MAKE_UNIQUE_NAME(cpputBenchmarkRegisterer)(                            \
+         CPPUT_CURRENT_SUITE(),                                                    \
+         ::CppUT::makeBenchmark( &benchmarkName, #benchmarkName ) );               \
+   static void benchmarkName( ::CppUT::BenchmarkState &state )
+
+
+/*! \brief Declares and registers a benchmark measured for each size of a range.
+ * \ingroup group_benchmark
+ * The sizes go from \a first to \a last in powers of 2. The benchmark fails if
+ * its durations grow faster than the CppUT::BenchmarkComplexity \a expected.
+ * \code
+ * CPPUT_BENCHMARK_RANGE( benchSort, 8, 1 << 20, CppUT::complexityLinearithmic )
+ * {
+ *    std::vector<int> values( state.range() );
+ *    while ( state.keepRunning() )
+ *    {
+ *       std::generate( values.begin(), values.end(), rand );
+ *       std::sort( values.begin(), values.end() );
+ *    }
+ * }
+ * \endcode
+ */
+# define CPPUT_BENCHMARK_RANGE( benchmarkName, first, last, expected )             \
+   static void benchmarkName( ::CppUT::BenchmarkState &state );                    \
+   static ::CppUT::Impl::BenchmarkRegisterer                                       \
+      CPPTL_MAKE_UNIQUE_NAME(cpputBenchmarkRegisterer)(                            \
+         CPPUT_CURRENT_SUITE(),                                                    \
+         ::CppUT::makeBenchmark( &benchmarkName,                                   \
+                                 ::CppUT::MetaData( #benchmarkName ),              \
+                                 ::CppUT::BenchmarkRange( first, last ),           \
+                                 expected ) );                                     \
+   static void benchmarkName( ::CppUT::BenchmarkState &state )
+
+
+/*! \brief Declares and registers a benchmark run on 1, 2, 4... up to
+ * \a maxThreadCount threads at the same time.
+ * \ingroup group_benchmark
+ * See makeThreadedBenchmark().
+ * \code
+ * static CppTL::Mutex mutex;
+ * CPPUT_BENCHMARK_THREADS( benchMutexContention, 8 )
+ * {
+ *    while ( state.keepRunning() )
+ *       CppTL::Mutex::ScopedLockGuard guard( mutex );
+ * }
+ * \endcode
+ */
+# define CPPUT_BENCHMARK_THREADS( benchmarkName, maxThreadCount )                  \
+   static void benchmarkName( ::CppUT::BenchmarkState &state );                    \
+   static ::CppUT::Impl::BenchmarkRegisterer                                       \
+      CPPTL_MAKE_UNIQUE_NAME(cpputBenchmarkRegisterer)(                            \
+         CPPUT_CURRENT_SUITE(),                                                    \
+         ::CppUT::makeThreadedBenchmark( &benchmarkName,                           \
+                                         ::CppUT::MetaData( #benchmarkName ),      \
+                                         maxThreadCount ) );                       \
+   static void benchmarkName( ::CppUT::BenchmarkState &state )
+
+
+#endif // CPPUT_BENCHMARK_H_INCLUDED
@@ -62,6 +62,15 @@
 # define CPPUT_DLL_SUPPORT 1
 # endif
 
+// OS specific stuffs...
+///////////////////////////////////////////////////////////////////////////
+
+// CPPUT_HAS_FORK is defined to 1 if tests can be isolated in child processes
+// using fork(). Define CPPUT_NO_FORK to disable.
+# if !defined(CPPUT_NO_FORK)  &&  !(defined(WIN32) || defined(_WIN32) || defined(__WIN32__))
+#  define CPPUT_HAS_FORK 1
+# endif
+
 // STL specific stuffs...
 ///////////////////////////////////////////////////////////////////////////
 
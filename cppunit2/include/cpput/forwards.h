@@ -17,6 +17,7 @@ namespace Impl {
    class DependenciesData;
    class GroupData;
    class RegistryImpl;
+   class ResourceData;
    class SuiteImpl;
    class TestExtendedDataList;
    class TimeOutData;
@@ -25,6 +26,7 @@ namespace Impl {
 // testing.h
 class ExceptionGuardContext;
 class ExceptionGuard;
+class FrozenRegistry;
 class MetaData;
 class Registry;
 class StaticSuite;
@@ -34,6 +36,17 @@ class TestExtendedData;
 template<class AType, class BType>
 struct EqualityTraits;
 
+// benchmark.h
+class BenchmarkState;
+struct BenchmarkComplexityFit;
+struct BenchmarkRange;
+struct BenchmarkSettings;
+struct BenchmarkStatistics;
+
+// testgroupfilter.h
+class TestGroupFilter;
+class TestGroupSet;
+
 // testcase.h
 typedef TestCase *(*TestCaseFactoryFn)();
 
@@ -0,0 +1,168 @@
+#ifndef CPPUT_LIGHTTESTREPORTER_H_INCLUDED
+# define CPPUT_LIGHTTESTREPORTER_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <cpput/benchmark.h>
+# include <cpput/testinfo.h>
+# include <cpptl/conststring.h>
+# include <json/value.h>
+# include <stdio.h>
+# include <string>
+# include <vector>
+
+namespace CppUT {
+
+   /// Counters of a LightTestRunner run.
+   struct LightTestSummary
+   {
+      LightTestSummary()
+         : testRun_( 0 )
+         , testFailed_( 0 )
+         , testSkipped_( 0 )
+         , testNotRun_( 0 )
+         , ignoredFailureCount_( 0 )
+         , assertionCount_( 0 )
+      {
+      }
+
+      unsigned int testRun_;
+      unsigned int testFailed_;
+      unsigned int testSkipped_;
+      /// Tests not run because the run was stopped on failure.
+      unsigned int testNotRun_;
+      unsigned int ignoredFailureCount_;
+      unsigned int assertionCount_;
+   };
+
+
+   /*! \brief Durations of the tests of a LightTestRunner run.
+    * See LightTestRunner::setTimingReport().
+    */
+   struct LightTestTimings
+   {
+      enum 
+      { 
+         /// Number of buckets of the histogram.
+         histogramSize = 8
+      };
+
+      /// A test among the slowest of the run.
+      struct SlowTest
+      {
+         CppTL::ConstString path_;
+         /// Total duration of the test in seconds.
+         double duration_;
+         /// Wall-clock and thread CPU times of each phase of the test: the
+         /// "timing" statistics set by TestMeta::runTest().
+         Json::Value timing_;
+      };
+
+      typedef std::vector<SlowTest> SlowTests;
+
+      LightTestTimings()
+         : histogram_( histogramSize, 0 )
+      {
+      }
+
+      /// Returns the exclusive upper bound in seconds of the given histogram bucket.
+      /// Buckets grow by a factor of 10 from 10 microseconds. The last bucket has
+      /// no upper bound.
+      static double bucketUpperBound( unsigned int bucket );
+
+      /// Returns the histogram bucket of the given duration.
+      static unsigned int bucketOf( double duration );
+
+      /// Formats a duration with a unit suited to its magnitude ("12.5ms", "3.2ns").
+      static std::string formatDuration( double seconds );
+
+      /// Slowest tests, slowest first.
+      SlowTests slowest_;
+      /// Number of tests in each duration bucket.
+      std::vector<unsigned int> histogram_;
+   };
+
+
+   /*! \brief Change of a benchmark from its baseline.
+    * See LightTestRunner::setBenchmarkBaselineFile().
+    */
+   struct LightBenchmarkDelta
+   {
+      CppTL::ConstString path_;
+      BenchmarkComparison comparison_;
+      /// Slower than the threshold, with significance. The benchmark failed.
+      bool isRegression_;
+   };
+
+   typedef std::vector<LightBenchmarkDelta> LightBenchmarkDeltas;
+
+
+   /*! \brief Receives the results of LightTestRunner as soon as they are known.
+    *
+    * Results are reported in the test plan order, so the report does not depend
+    * on the number of worker threads or processes. The reporter does not need
+    * to be thread-safe: it is only called by the thread running runTests().
+    */
+   class CPPUT_API LightTestReporter
+   {
+   public:
+      virtual ~LightTestReporter();
+
+      /// Called before a test is run, only when tests are run serially.
+      virtual void testStarting( const CppTL::ConstString &testPath );
+
+      /// Reports the result of a test.
+      /// \param failureReport Description of the failures and logs of the test.
+      ///                      Empty if the test has none.
+      virtual void testCompleted( const CppTL::ConstString &testPath,
+                                  const TestStatus &status,
+                                  const CppTL::ConstString &failureReport ) = 0;
+
+      /// Called before runCompleted() if the timing report is enabled.
+      virtual void reportTimings( const LightTestTimings &timings );
+
+      /// Called before runCompleted() if benchmarks were compared to a baseline.
+      virtual void reportBenchmarkDeltas( const LightBenchmarkDeltas &deltas );
+
+      virtual void runCompleted( const LightTestSummary &summary ) = 0;
+   };
+
+
+   /*! \brief Reporter writing each test status and failures as plain text.
+    * The text goes through a buffer of bounded size, flushed after each test.
+    */
+   class CPPUT_API LightTextReporter : public LightTestReporter
+   {
+   public:
+      /// \param output Stream the report is written to. It is not closed.
+      explicit LightTextReporter( FILE *output = stdout );
+
+      virtual ~LightTextReporter();
+
+   public: // overridden from LightTestReporter
+      virtual void testStarting( const CppTL::ConstString &testPath );
+
+      virtual void testCompleted( const CppTL::ConstString &testPath,
+                                  const TestStatus &status,
+                                  const CppTL::ConstString &failureReport );
+
+      virtual void reportTimings( const LightTestTimings &timings );
+
+      virtual void reportBenchmarkDeltas( const LightBenchmarkDeltas &deltas );
+
+      virtual void runCompleted( const LightTestSummary &summary );
+
+   private:
+      void write( const char *text, size_t length );
+      void write( const std::string &text );
+      void flush();
+
+      enum { bufferCapacity = 8192 };
+      FILE *output_;
+      CppTL::ConstString startedTestPath_;
+      std::string buffer_;
+   };
+
+} // namespace CppUT
+
+
+#endif // CPPUT_LIGHTTESTREPORTER_H_INCLUDED
@@ -2,17 +2,39 @@
 # define CPPUT_LIGHTTESTRUNNER_H_INCLUDED
 
 # include <cpput/forwards.h>
+# include <cpput/lighttestreporter.h>
+# include <cpput/testgroupfilter.h>
+# include <cpput/testpathfilter.h>
 # include <cpput/testinfo.h>
 # include <cpput/testing.h>
 # include <cpptl/intrusiveptr.h>
+# include <cpptl/thread.h>
 # include <deque>
+# include <map>
+# include <vector>
 
 namespace CppUT {
 
-   /* Lightweight test runner intended for unit testing CppUnit itself 
+   /* Lightweight test runner intended for unit testing CppUnit itself
     * and the open test framework.
+    *
+    * Tests are first collected from the suites in a test plan, then run either
+    * serially or by a pool of worker threads (see setThreadCount()). In both
+    * cases, the results are reported in the plan order as soon as they are known
+    * (see setReporter()).
+    *
+    * The dependencies declared by the tests (see MetaData::addDependency()) are
+    * honored in all modes: a test is only started once all its prerequisites
+    * have passed, and is skipped if one of them failed or was skipped.
+    * Prerequisites that are not part of the test plan (filtered out, in another
+    * shard...) are ignored. The tests whose dependencies form a cycle are
+    * reported as faults, and the tests depending on a cycle are skipped.
+    *
+    * The tests requiring the same resources (see MetaData::requireResource()) are
+    * run next to each other, and dispatched to the same worker process, so that
+    * the resources are built as few times as possible.
     */
-   class LightTestRunner : private TestResultUpdater
+   class LightTestRunner
    {
    public:
       LightTestRunner();
@@ -21,45 +43,356 @@ namespace CppUT {
 
       void addSuite( const Suite &suite );
 
-      bool runTests();
+      /*! \brief Sets the reporter the results are streamed to.
+       * The reporter must outlive the calls to runTests(). By default, a
+       * LightTextReporter writes the results to stdout.
+       */
+      void setReporter( LightTestReporter &reporter );
+
+      /*! \brief Only runs the tests whose path matches the glob pattern.
+       * May be called several times to select the tests matching any of the
+       * patterns. See TestPathFilter for the pattern syntax.
+       */
+      void addFilter( const std::string &pattern );
+
+      /// Does not run the tests whose path matches the glob pattern.
+      void addExclude( const std::string &pattern );
+
+      /// Only runs the tests whose groups are selected by the filter.
+      void setGroupFilter( const TestGroupFilter &filter );
+
+      /*! \brief Sets the number of worker threads used to run the tests.
+       * 1 (the default) runs the tests serially in the calling thread. 0 uses
+       * one worker per available processor.
+       */
+      void setThreadCount( unsigned int threadCount );
+
+      /*! \brief Runs the tests in a pool of child processes.
+       * The worker processes are forked once, after all the tests have been
+       * registered. A test that crashes its worker process is reported as a fault
+       * and the worker is replaced. 0 (the default) runs the tests in this process.
+       * Only available if CPPUT_HAS_FORK is defined.
+       */
+      void setProcessCount( unsigned int processCount );
+
+      /*! \brief Only runs the tests of the given shard.
+       * The tests are partitioned into \a shardCount shards by a stable hash of
+       * their full path. Runs sharing the same tests and shard count, possibly on
+       * different machines, therefore run disjoint sets of tests that add up to the
+       * whole test plan.
+       * \param shardIndex Index of the shard to run, in [0, shardCount).
+       * \param shardCount Number of shards. 1 (the default) runs all the tests.
+       */
+      void setShard( unsigned int shardIndex, unsigned int shardCount );
+
+      /*! \brief Lists the tests of each shard instead of running them.
+       * Used to check that the shards are balanced.
+       */
+      void setListShards( bool listShards );
+
+      /*! \brief Sets the time-out of the tests that do not have one.
+       * A test running for longer than its time-out (see MetaData::setTimeOut())
+       * is reported as a fault, and the runner moves on to the remaining tests.
+       * Time-outs are only enforced when the tests are run by worker threads or
+       * processes: a timed out worker process is killed, while a timed out worker
+       * thread is abandoned and replaced.
+       * 0 (the default) means that tests without a time-out may run forever.
+       */
+      void setDefaultTimeOut( double timeOutInSeconds );
+
+      /*! \brief Dumps the backtrace of timed out tests to stderr.
+       * Only supported with glibc, ignored otherwise.
+       */
+      void setDumpBacktraceOnTimeOut( bool dumpBacktrace );
+
+      /*! \brief Sets the file used to remember the duration of the tests between runs.
+       * The measured durations (the "duration" statistics of each test) are merged
+       * into the file after each run. Using this history, parallel runs start the
+       * longest tests first. It does not change which tests belong to a shard
+       * (see setShard()): only their order within the shard.
+       */
+      void setTimingCacheFile( const std::string &path );
+
+      /*! \brief Sets the file used to remember the outcome of the tests of the last run.
+       * The outcomes are merged into the file after each run. An empty path (the
+       * default) disables it.
+       */
+      void setLastRunFile( const std::string &path );
+
+      /*! \brief Runs the tests that failed in the last run first, then the tests
+       * never run before, then the other tests.
+       * Requires setLastRunFile().
+       */
+      void setFailedFirst( bool failedFirst );
+
+      /*! \brief Only runs the tests that failed in the last run.
+       * All the tests are run if no test failed in the last run.
+       * Requires setLastRunFile().
+       */
+      void setFailuresOnly( bool failuresOnly );
+
+      /*! \brief Stops running tests after the first failure.
+       * With worker threads or processes, the tests already running complete.
+       */
+      void setStopOnFailure( bool stopOnFailure );
+
+      /*! \brief Runs each test \a repeatCount times in a row.
+       * Used to expose intermittent failures, and to measure the run-to-run
+       * variance of the test durations before trusting them. A repeated test
+       * fails if any of its runs failed. Its report gives the number of passed
+       * and failed runs, and the spread of their durations. Its "duration"
+       * statistics is the mean duration of a run. The time-out of the test
+       * applies to all its runs.
+       * 0 repeats each test until it fails, and implies setRepeatUntilFailure().
+       */
+      void setRepeatCount( unsigned int repeatCount );
+
+      /// Stops repeating a test after its first failed run.
+      void setRepeatUntilFailure( bool untilFailure );
+
+      /*! \brief Runs \a copyCount copies of each test at the same time.
+       * Each copy runs in its own thread, with its own TestInfo and a new TestCase
+       * for each run, and repeats the test as set by setRepeatCount(). Used to
+       * expose the race conditions of the code under test. 1 (the default) runs
+       * a single copy. Only available if CPPTL_HAS_THREAD is defined.
+       */
+      void setConcurrentCopies( unsigned int copyCount );
 
-   private: // overridden from TestResultUpdater
-      virtual void addResultLog( const Json::Value &log );
+      /*! \brief Saves the results of the benchmarks to a baseline file.
+       * The results are merged into the file, keeping the benchmarks that were
+       * not run. See makeBenchmark().
+       */
+      void setBenchmarkSaveFile( const std::string &path );
 
-      virtual void addResultAssertion( const Assertion &assertion );
+      /*! \brief Compares the results of the benchmarks to a baseline file.
+       * The baseline is a file written by setBenchmarkSaveFile(). The samples of
+       * each benchmark are compared to the baseline samples (see
+       * BenchmarkComparison), and the benchmark fails if it regressed: its median
+       * is slower than the baseline median by more than the threshold, and the
+       * difference is significant. A regressed benchmark fails like any other
+       * test, so the tests depending on it are skipped. A table of the changes
+       * is reported at the end of the run.
+       */
+      void setBenchmarkBaselineFile( const std::string &path );
+
+      /*! \brief Sets when a benchmark slower than its baseline fails.
+       * \param threshold Relative change of the median tolerated. 0.05 (the default)
+       *                  tolerates up to 5% slower.
+       * \param significance The change must have a p-value below it. Defaults to 0.05.
+       */
+      void setBenchmarkRegressionThreshold( double threshold,
+                                            double significance = 0.05 );
+
+      /*! \brief Reports the slowest tests and a histogram of the test durations
+       * at the end of the run.
+       * \param slowestCount Number of slowest tests to report. 0 (the default)
+       *                     disables the timing report.
+       */
+      void setTimingReport( unsigned int slowestCount );
+
+      /*! \brief Configures the runner from the command line.
+       * Supported options:
+       * - --filter=PATTERN: see addFilter().
+       * - --exclude=PATTERN: see addExclude().
+       * - --groups EXPRESSION, --groups=EXPRESSION: see setGroupFilter() and
+       *   TestGroupFilter for the expression syntax.
+       * - -j N, --jobs=N: see setThreadCount().
+       * - --fork=N: see setProcessCount().
+       * - --shard-index=I, --shard-count=N: see setShard(). The environment variables
+       *   CPPUT_SHARD_INDEX and CPPUT_SHARD_COUNT are used if the options are not given.
+       * - --list-shards: see setListShards().
+       * - --timeout=S: see setDefaultTimeOut().
+       * - --timeout-backtrace: see setDumpBacktraceOnTimeOut().
+       * - --timing-cache=FILE: see setTimingCacheFile().
+       * - --last-run=FILE: see setLastRunFile(). Defaults to the program path
+       *   followed by ".lastrun" if --failed-first or --failures-only is given,
+       *   so that the other runs do not write next to the program.
+       * - --failed-first: see setFailedFirst().
+       * - --failures-only: see setFailuresOnly().
+       * - -x, --stop-on-failure: see setStopOnFailure().
+       * - --timing-report[=N]: see setTimingReport(). N defaults to 10.
+       * - --repeat=N: see setRepeatCount().
+       * - --until-failure: see setRepeatUntilFailure(). Repeats each test until it
+       *   fails if --repeat is not given.
+       * - --concurrent-copies=K: see setConcurrentCopies().
+       * - --benchmark-time=S, --benchmark-warmup=S, --benchmark-samples=N: sets the
+       *   sample time, warm-up time and sample count of the benchmarks, see
+       *   setBenchmarkSettings().
+       * - --benchmark-save=FILE: see setBenchmarkSaveFile().
+       * - --benchmark-baseline=FILE: see setBenchmarkBaselineFile().
+       * - --benchmark-threshold=PERCENT: see setBenchmarkRegressionThreshold().
+       * \returns \c false if the command line is invalid. The usage has been
+       *          printed to stdout in that case.
+       */
+      bool parseCommandLine( int argc, const char *argv[] );
+
+      bool runTests();
 
    private:
-      void runTestSuite( const Suite &suite );
-      void runTestCase( const TestMeta &testCase );
-      CppTL::ConstString getTestPath() const;
-      void reportFailure( const Assertion &failure );
-      void reportFailureDetail( const Json::Value &detail, 
-                                int nestingLevel = 0);
-      void reportLog( const Json::Value &log );
-
-      struct ResultElement
+      class ProcessWorker;
+      class RepeatedTest;
+      class ResultCollector;
+      class Worker;
+
+      /// A test selected to be run with its full path.
+      struct PlannedTest
       {
-         int index_;
-         bool isLog_;
+         const TestMeta *test_;
+         CppTL::ConstString path_;
       };
 
+      /// Outcome of a planned test, captured in the thread that ran it.
+      struct TestResult
+      {
+         TestResult()
+            : ignoredFailureCount_( 0 )
+            , hasRun_( false )
+         {
+         }
+
+         TestStatus status_;
+         CppTL::ConstString report_;
+         unsigned int ignoredFailureCount_;
+         bool hasRun_;
+      };
+
+      /// How many times each test is run, see setRepeatCount().
+      struct RepeatSettings
+      {
+         RepeatSettings()
+            : repeatCount_( 1 )
+            , copyCount_( 1 )
+            , untilFailure_( false )
+         {
+         }
+
+         bool isEnabled() const
+         {
+            return repeatCount_ != 1  ||  copyCount_ > 1  ||  untilFailure_;
+         }
+
+         /// 0 if the test is repeated until it fails.
+         unsigned int repeatCount_;
+         unsigned int copyCount_;
+         bool untilFailure_;
+      };
+
+      typedef unsigned int PlanIndex;
+      typedef std::vector<PlanIndex> PlanOrder;
+
+      void collectTests( const FrozenRegistry &registry,
+                         int suiteIndex,
+                         TestPathFilter::State filterState );
+      void collectTests( const FrozenRegistry &registry,
+                         int suiteIndex,
+                         CppTL::ConstString::size_type prefixLength,
+                         TestPathFilter::State filterState );
+      void assignShards( std::vector<unsigned int> &shards ) const;
+      void selectShard();
+      void listShards() const;
+      void loadTimingCache();
+      void saveTimingCache();
+      bool hasTimingHistory() const;
+      double predictedDuration( PlanIndex index ) const;
+      void orderLongestFirst( PlanOrder &order ) const;
+      void loadLastRun();
+      void saveLastRun();
+      void applyLastRunOrder();
+      void groupByResources();
+      void reserveResources();
+      void cancelReservedResources( PlanIndex index );
+      void resolveDependencies();
+      void findDependencyCycles( std::vector<bool> &isInCycle ) const;
+      void selectReadyTests( const PlanOrder &order,
+                             PlanOrder &readyTests ) const;
+      bool takeReadyTest( PlanIndex &index );
+      bool takeReadyTest( PlanIndex &index,
+                          unsigned int resourceGroup,
+                          const std::vector<unsigned int> &claimedGroups );
+      bool hasReadyTests() const;
+      void pushReadyTest( PlanIndex index );
+      bool hasBlockedTests() const;
+      void testCompleted( PlanIndex index,
+                          const TestResult &result );
+      void resolveTest( PlanIndex index );
+      void skipDependent( PlanIndex index,
+                          PlanIndex prerequisite );
+      bool isStopRequested() const;
+      void runTestsSerially();
+      void runTestsInParallel( unsigned int threadCount );
+      void runTestsInProcesses( unsigned int processCount );
+      void reportCompletedResults();
+      void reportRemainingResults();
+      void runPlannedTest( PlanIndex index,
+                           ResultCollector &collector );
+      static void runTest( const PlannedTest &planned,
+                           const RepeatSettings &repeat,
+                           ResultCollector &collector,
+                           TestResult &result );
+      void recordFault( PlanIndex index,
+                        const std::string &message );
+      void makeFaultResult( PlanIndex index,
+                            const std::string &message,
+                            TestResult &result ) const;
+      double timeOutOf( PlanIndex index ) const;
+      void recordTimeOut( PlanIndex index );
+      bool hasRun( PlanIndex index ) const;
+      void reportTestResult( PlanIndex index );
+      void recordTiming( PlanIndex index );
+      void loadBenchmarkBaseline();
+      void compareToBaseline( PlanIndex index );
+      void saveBenchmarkResults();
+      unsigned int effectiveThreadCount() const;
+      static void printUsage( const char *programName );
+
       typedef std::deque<Suite> SuitesToRun;
       SuitesToRun suitesToRun_;
-      typedef std::deque<CppTL::ConstString> TestPath;
-      TestPath testPath_;
-      CppTL::StringBuffer report_;
-      typedef std::deque<Json::Value> Logs;
-      Logs logs_;
-      typedef std::deque<Assertion> Assertions;
-      Assertions assertions_;
-      typedef std::deque<ResultElement> ResultElements;
-      ResultElements results_;
-      unsigned int testRun_;
-      unsigned int testFailed_;
-      unsigned int testSkipped_;
-      unsigned int ignoredFailureCount_;
-      unsigned int totalAssertionCount_;
-   }; 
+      TestPathFilter filter_;
+      TestGroupFilter groupFilter_;
+      typedef std::vector<PlannedTest> TestPlan;
+      TestPlan plan_;
+      typedef std::vector<TestResult> TestResults;
+      TestResults results_;
+      /// Index of the set of resources required by each test, 0 if none.
+      std::vector<unsigned int> resourceGroups_;
+      typedef std::vector<PlanOrder> Dependents;
+      Dependents dependents_;
+      std::vector<unsigned int> pendingPrerequisites_;
+      std::deque<PlanIndex> readyTests_;
+      unsigned int blockedCount_;
+      LightTextReporter defaultReporter_;
+      LightTestReporter *reporter_;
+      LightTestSummary summary_;
+      LightTestTimings timings_;
+      RepeatSettings repeat_;
+      PlanIndex reportCursor_;
+      unsigned int threadCount_;
+      unsigned int processCount_;
+      unsigned int slowestCount_;
+      unsigned int shardIndex_;
+      unsigned int shardCount_;
+      bool listShards_;
+      double defaultTimeOut_;
+      bool dumpBacktrace_;
+      std::string timingCachePath_;
+      Json::Value timingCache_;
+      double meanDuration_;
+      std::string lastRunPath_;
+      Json::Value lastRun_;
+      std::string benchmarkSavePath_;
+      std::string benchmarkBaselinePath_;
+      Json::Value benchmarkBaseline_;
+      /// Changes from the baseline, by plan index: the tests complete in any order.
+      typedef std::map<PlanIndex, LightBenchmarkDelta> BenchmarkDeltas;
+      BenchmarkDeltas benchmarkDeltas_;
+      double benchmarkThreshold_;
+      double benchmarkSignificance_;
+      mutable CppTL::Mutex resultLock_;
+      bool failedFirst_;
+      bool failuresOnly_;
+      bool stopOnFailure_;
+      bool isStopRequested_;
+   };
 
 } // namespace CppUT
 
@@ -0,0 +1,105 @@
+#ifndef CPPUT_PERFCOUNTERS_H_INCLUDED
+# define CPPUT_PERFCOUNTERS_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <json/value.h>
+
+namespace CppUT {
+
+/*! \brief Events counted by PerfCounters.
+ * \ingroup group_perfcounters
+ */
+enum PerfCounter
+{
+   perfCycles = 0,
+   perfInstructions,
+   perfCacheMisses,
+   perfBranchMisses,
+   perfPageFaults,
+   perfContextSwitches,
+   perfCounterCount
+};
+
+/// Returns the name of the counter in the statistics, "cache_misses" for example.
+const char * CPPUT_API perfCounterName( PerfCounter counter );
+
+
+/*! \brief Values of the counters measured by PerfCounters.
+ * \ingroup group_perfcounters
+ */
+struct CPPUT_API PerfCounterValues
+{
+   PerfCounterValues();
+
+   bool isAvailable( PerfCounter counter ) const;
+
+   double value( PerfCounter counter ) const;
+
+   void set( PerfCounter counter,
+             double value );
+
+   /// Adds the values of the counters available in both. The counters of a
+   /// default constructed instance are all considered available.
+   void add( const PerfCounterValues &other );
+
+   /*! Returns the available counters divided by \a divisor, by name, along with
+    * the instructions per cycle ("ipc") if both are available.
+    */
+   Json::Value toJson( double divisor = 1 ) const;
+
+   double values_[perfCounterCount];
+   bool available_[perfCounterCount];
+   bool isEmpty_;
+};
+
+
+/*! \brief Counts hardware and software events in the current thread.
+ * \ingroup group_perfcounters
+ *
+ * On Linux, the cycles, instructions, cache misses and branch misses are
+ * counted in user space with perf_event_open(). They are not available if the
+ * kernel does not permit it (see /proc/sys/kernel/perf_event_paranoid), or on
+ * the other platforms. The page faults and the context switches are then still
+ * counted with getrusage(), where available.
+ */
+class CPPUT_API PerfCounters
+{
+public:
+   PerfCounters();
+
+   ~PerfCounters();
+
+   /// Returns \c true if at least one hardware counter could be opened.
+   bool hasHardwareCounters() const;
+
+   void start();
+
+   /// Returns the events counted since start().
+   PerfCounterValues stop();
+
+private:
+   PerfCounters( const PerfCounters &other );
+   PerfCounters &operator =( const PerfCounters &other );
+
+   PerfCounterValues readUsage() const;
+
+   int descriptors_[perfPageFaults];
+   PerfCounterValues startUsage_;
+};
+
+
+/*! \brief Enables counting the events of each test.
+ * \ingroup group_perfcounters
+ *
+ * When enabled, TestMeta::runTest() stores the events counted while running
+ * the test in the "counters" statistics of the test status, and the
+ * benchmarks store the events per operation in their "benchmark" statistics.
+ * See LightTestRunner option --perf-counters.
+ */
+void CPPUT_API setPerfCounters( bool enabled );
+
+bool CPPUT_API arePerfCountersEnabled();
+
+} // namespace CppUT
+
+#endif // CPPUT_PERFCOUNTERS_H_INCLUDED
@@ -0,0 +1,180 @@
+#ifndef CPPUT_RESOURCE_H_INCLUDED
+# define CPPUT_RESOURCE_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <cpptl/functor.h>
+# include <string>
+
+namespace CppUT {
+
+/*! \brief Base class of the resources shared by several tests.
+ * \ingroup group_testfixture
+ *
+ * A resource is some costly state, such as a large in-memory dataset, that
+ * is built once and used by all the tests declaring it (see
+ * MetaData::requireResource()). The resource is destroyed when the last
+ * test using it completes.
+ */
+class CPPUT_API Resource
+{
+public:
+   virtual ~Resource();
+};
+
+
+typedef CppTL::Functor0R<Resource *> ResourceFactory;
+
+
+/*! \brief Named resources, created lazily and reference counted.
+ * \ingroup group_testfixture
+ *
+ * Resources are registered by name with the factory creating them (see
+ * CPPUT_REGISTER_RESOURCE()). The factory is only called when the first test
+ * requiring the resource is run, and the resource is destroyed once all the
+ * tests that were expected to use it are done:
+ * - a test runner reserves the resources required by the tests of its plan
+ *   before running them (see reserve()), and cancels the remaining reservations
+ *   at the end of the run (see cancelReservations()),
+ * - TestMeta::runTest() acquires the resources required by the test before
+ *   calling TestCase::setUp(), and releases them after TestCase::tearDown().
+ *
+ * The resources are shared by the tests running in parallel in worker threads,
+ * so they must be safe to use concurrently in that case. Worker processes
+ * each create their own instance.
+ */
+class CPPUT_API ResourceRegistry
+{
+public:
+   /// Registers a resource factory. Replaces any factory with the same name.
+   static void add( const std::string &name,
+                    const ResourceFactory &factory );
+
+   static bool has( const std::string &name );
+
+   /// Declares that one more test will use the resource.
+   static void reserve( const std::string &name );
+
+   /// Cancels the reservation of a test that will not run, and destroys the
+   /// resource if no longer in use.
+   static void cancelReservation( const std::string &name );
+
+   /// Cancels the reservations of the tests that did not run, and destroys
+   /// the resources no longer in use.
+   static void cancelReservations();
+
+   /*! \brief Creates the resource if needed and marks it as in use.
+    * \exception std::logic_error if the resource is not registered.
+    * The exceptions thrown by the factory are propagated.
+    */
+   static void acquire( const std::string &name );
+
+   /// Marks the resource as no longer in use by the test, and destroys it if
+   /// no other test is expected to use it.
+   static void release( const std::string &name );
+
+   /*! \brief Returns the instance of a resource acquired by the running test.
+    * \exception std::logic_error if the resource is not in use.
+    */
+   static Resource &get( const std::string &name );
+};
+
+
+/*! \brief Returns a resource required by the running test.
+ * \ingroup group_testfixture
+ * \code
+ * CPPUT_TEST_FUNCTION_WITH_META( testLookup, requireResource( "dataset" ) )
+ * {
+ *    Dataset &dataset = CppUT::resource<Dataset>( "dataset" );
+ *    ...
+ * }
+ * \endcode
+ */
+template<class ResourceType>
+ResourceType &resource( const std::string &name )
+{
+   return static_cast<ResourceType &>( ResourceRegistry::get( name ) );
+}
+
+
+namespace Impl {
+
+   template<class ResourceType>
+   struct ResourceCreator
+   {
+      static Resource *create()
+      {
+         return new ResourceType();
+      }
+   };
+
+   class CPPUT_API ResourceRegisterer
+   {
+   public:
+      ResourceRegisterer( const std::string &name,
+                          const ResourceFactory &factory )
+      {
+         ResourceRegistry::add( name, factory );
+      }
+   };
+
+   class CPPUT_API SuiteFixtureRegisterer
+   {
+   public:
+      SuiteFixtureRegisterer( Suite suite,
+                              const std::string &name,
+                              const ResourceFactory &factory );
+   };
+
+} // namespace Impl
+
+} // namespace CppUT
+
+
+/*! \brief Registers a resource created by the default constructor of ResourceType.
+ * \ingroup group_testfixture
+ * ResourceType must derive from CppUT::Resource.
+ */
+# define CPPUT_REGISTER_RESOURCE( ResourceType, name )                              \
+   static ::CppUT::Impl::ResourceRegisterer                                         \
+      CPPTL_MAKE_UNIQUE_NAME(cpputResourceRegisterer)(                              \
+         name, ::CppTL::cfn0r( &::CppUT::Impl::ResourceCreator<ResourceType>::create ) )
+
+
+/*! \brief Declares a fixture shared by all the tests of the current suite.
+ * \ingroup group_testfixture
+ *
+ * The fixture is a resource (see CppUT::Resource) required by every test of the
+ * current suite and of its nested suites. Its constructor is the one-time setUp
+ * of the suite: it runs before the first of these tests. Its destructor is the
+ * one-time tearDown: it runs after the last of them. The tests access it with
+ * CppUT::resource():
+ * \code
+ * CPPUT_SUITE( "Index" ) {
+ *
+ * struct LoadedIndex : CppUT::Resource
+ * {
+ *    LoadedIndex() { index_.load( "words.idx" ); }
+ *    Index index_;
+ * };
+ *
+ * CPPUT_SUITE_FIXTURE( LoadedIndex, "Index.loaded" );
+ *
+ * CPPUT_TEST_FUNCTION( testLookup )
+ * {
+ *    Index &index = CppUT::resource<LoadedIndex>( "Index.loaded" ).index_;
+ *    ...
+ * }
+ *
+ * } // end suite
+ * \endcode
+ * When tests run in worker threads, they share the same fixture instance. When
+ * they run in worker processes, each process creates its own.
+ */
+# define CPPUT_SUITE_FIXTURE( FixtureType, name )                                   \
+   static ::CppUT::Impl::SuiteFixtureRegisterer                                     \
+      CPPTL_MAKE_UNIQUE_NAME(cpputSuiteFixtureRegisterer)(                          \
+         CPPUT_CURRENT_SUITE(), name,                                               \
+         ::CppTL::cfn0r( &::CppUT::Impl::ResourceCreator<FixtureType>::create ) )
+
+
+#endif // CPPUT_RESOURCE_H_INCLUDED
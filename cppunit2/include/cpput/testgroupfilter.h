@@ -0,0 +1,122 @@
+#ifndef CPPUT_TESTGROUPFILTER_H_INCLUDED
+# define CPPUT_TESTGROUPFILTER_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <string>
+# include <vector>
+
+namespace CppUT {
+
+/*! \brief Set of the groups a test belongs to, as a bitset.
+ *
+ * Group names are interned into bit positions when tests are added to a
+ * group (see MetaData::addToGroup()), so that testing the groups of a test
+ * against a TestGroupFilter only costs a few bitwise operations. The interning
+ * table is mostly filled at registration time, but groups may also be added
+ * while tests run on several threads.
+ */
+class CPPUT_API TestGroupSet
+{
+public:
+   /// Returns the bit position of the group. A new group gets the next free one.
+   static unsigned int intern( const std::string &groupName );
+
+   void add( unsigned int bit );
+
+   bool isEmpty() const;
+
+   /// Returns an upper bound of the bit positions of the groups in the set.
+   unsigned int bitCapacity() const;
+
+   bool contains( unsigned int bit ) const;
+
+   /// Returns \c true if all the groups of \c other are in this set.
+   bool containsAll( const TestGroupSet &other ) const
+   {
+      const unsigned int size = (unsigned int)words_.size();
+      for ( unsigned int index = 0; index < other.words_.size(); ++index )
+      {
+         Word word = index < size ? words_[index] : 0;
+         if ( (word & other.words_[index]) != other.words_[index] )
+            return false;
+      }
+      return true;
+   }
+
+   /// Returns \c true if a group is in both sets.
+   bool intersects( const TestGroupSet &other ) const
+   {
+      const unsigned int size = (unsigned int)CPPTL_MIN( words_.size(), other.words_.size() );
+      for ( unsigned int index = 0; index < size; ++index )
+      {
+         if ( (words_[index] & other.words_[index]) != 0 )
+            return true;
+      }
+      return false;
+   }
+
+   void insert( const TestGroupSet &other );
+
+private:
+   typedef CppTL::LargestUnsignedInt Word;
+   enum { bitsPerWord = sizeof(Word) * 8 };
+   std::vector<Word> words_;
+};
+
+
+/*! \brief Selects tests by evaluating a boolean expression over their groups.
+ *
+ * The expression combines group names with '&' (and), '|' (or), '!' (not)
+ * and parentheses. '&' binds tighter than '|'. For example, "fast & !db | smoke"
+ * selects the tests of the group "smoke", and the tests of the group "fast"
+ * that are not in the group "db".
+ *
+ * The expression is compiled into a disjunction of terms, each term being a
+ * set of required groups and a set of forbidden groups. Testing a test is
+ * therefore a few bitwise operations per term, one for simple expressions.
+ */
+class CPPUT_API TestGroupFilter
+{
+public:
+   TestGroupFilter();
+
+   /*! \brief Compiles the expression.
+    * \param error [out] Description of the syntax error if any.
+    * \returns \c false if the expression is invalid. The filter is left unchanged.
+    */
+   bool setExpression( const std::string &expression,
+                       std::string &error );
+
+   /// Returns \c true if no expression was set.
+   bool isEmpty() const;
+
+   bool isSelected( const TestGroupSet &groups ) const
+   {
+      if ( isEmpty_ )
+         return true;
+      for ( Terms::const_iterator it = terms_.begin(); it != terms_.end(); ++it )
+      {
+         if ( groups.containsAll( it->required_ )  &&  !groups.intersects( it->forbidden_ ) )
+            return true;
+      }
+      return false;
+   }
+
+private:
+   class Parser;
+
+   struct Term
+   {
+      TestGroupSet required_;
+      TestGroupSet forbidden_;
+   };
+
+   typedef std::vector<Term> Terms;
+   Terms terms_;
+   bool isEmpty_;
+};
+
+} // namespace CppUT
+
+
+#endif // CPPUT_TESTGROUPFILTER_H_INCLUDED
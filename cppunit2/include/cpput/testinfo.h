@@ -138,6 +138,9 @@ namespace CppUT {
                           const Json::Value &value );
       //Json::Value getStatistics( const std::string &name );
 
+      /// Returns an object value with all the statistics set on the test.
+      const Json::Value &statistics() const;
+
       void addSpecific( const std::string &type,
                         const Json::Value &value );
 
@@ -10,12 +10,16 @@
 # include <cpput/impl/testcase.h>
 # include <cpput/impl/traits.h>
 # undef CPPUT_TESTING_H_PROLOG_IMPL_INCLUDES
+# include <cpput/testgroupfilter.h> // for MetaData
 # include <cpptl/conststring.h> // for ResourceNames
 # include <cpptl/functor.h>
+# include <cpptl/thread.h>
 # include <json/value.h> // for MetaData
 # include <deque>
+# include <map>
 # include <set>
 # include <string>
+# include <vector>
 
 # ifndef CPPUT_NO_DEFAULT_STRINGIZE
 #  ifndef CPPTL_NO_SSTREAM
@@ -184,6 +188,38 @@ How and where are suite stored ?
    static void testFunctionName()
 
 
+/*! \brief Declares a test function registered without running code at start-up.
+ * The test is described by a constant-initialized CppUT::TestDescriptor, and its
+ * TestMeta is only created if the test runner selects it. Useful for binaries with
+ * a very large number of tests. The suite is given by its path from the root
+ * suite, as the current suite is only known once static initialization runs.
+ * \code
+ * CPPUT_STATIC_TEST_FUNCTION( "Parser/Literals", testParseInteger ) {
+ *   CPPUT_CHECK( parse( "12" ) == 12 );
+ * }
+ * \endcode
+ */
+#define CPPUT_STATIC_TEST_FUNCTION( suitePath, testFunctionName )                   \
+   CPPUT_STATIC_TEST_FUNCTION_WITH_META( suitePath, testFunctionName, 0, 0, 0 )
+
+/*! \brief Declares a test function with a description, a time-out and groups,
+ * registered without running code at start-up. See CPPUT_STATIC_TEST_FUNCTION().
+ * \param description String literal, or 0.
+ * \param timeOut Time-out in seconds, 0 if none.
+ * \param groups String literal with the groups separated by spaces, or 0.
+ */
+#define CPPUT_STATIC_TEST_FUNCTION_WITH_META( suitePath, testFunctionName,             \
+                                              description, timeOut, groups )           \
+   static void testFunctionName();                                                     \
+   static ::CppUT::TestDescriptor CPPTL_MAKE_UNIQUE_NAME(cpputTestDescriptor) =        \
+      { suitePath, #testFunctionName, &testFunctionName,                               \
+        description, timeOut, groups, 0 };                                             \
+   static ::CppUT::TestDescriptorLink                                                  \
+      CPPTL_MAKE_UNIQUE_NAME(cpputTestDescriptorLink)(                                 \
+         CPPTL_MAKE_UNIQUE_NAME(cpputTestDescriptor) );                                \
+   static void testFunctionName()
+
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // Lightweight test fixture
@@ -328,6 +364,18 @@ public:
 
    void add( const TestMeta &testCase );
 
+   /// Adds the test cases in a single registration, for suites with many
+   /// generated tests.
+   void add( const std::vector<TestMeta> &testCases );
+
+   /*! \brief Makes all the tests of the suite and of its nested suites require a resource.
+    *
+    * The resource is created before the first of these tests runs, and destroyed
+    * after the last one (see ResourceRegistry). This applies to the tests already
+    * in the suite and to the ones added later. See CPPUT_SUITE_FIXTURE().
+    */
+   void addFixture( const std::string &resourceName );
+
    bool operator <( const Suite &other ) const;
    bool operator ==( const Suite &other ) const;
    unsigned int hash() const;
@@ -352,6 +400,29 @@ private:
 };
 
 
+/*! \ingroup group_testregistry
+ * \brief A registration measured by the registration profiler.
+ * See Registry::setRegistrationProfiling().
+ */
+struct RegistrationProfileEntry
+{
+   /// Path of the suite the tests were added to, or that was created or reparented.
+   std::string suitePath_;
+   /// Name of the registered test, empty if several tests or none were registered.
+   std::string testName_;
+   unsigned int testCount_;
+   unsigned int createdSuiteCount_;
+   unsigned int reparentCount_;
+   /// Time elapsed since the previous registration, in seconds.
+   double duration_;
+   /// Allocations made since the previous registration, 0 if not counted.
+   double allocationCount_;
+   double allocatedBytes_;
+};
+
+typedef std::vector<RegistrationProfileEntry> RegistrationProfile;
+
+
 /*! \ingroup group_testregistry
  * Static registry for all tests.
  * Any suite or test added to the registry by a dynamic library that contains test should
@@ -362,6 +433,36 @@ class CPPUT_API Registry
 public:
    static Suite getRootSuite();
 
+   /*! \brief Returns a snapshot of all the registered suites and tests.
+    *
+    * Called once the tests are registered, typically at the start of main() by
+    * the test runner. The first call builds the snapshot, the later ones return
+    * the same one. The registered suites must not be modified afterward: adding
+    * a test or a nested suite to them triggers an assertion. Suites created
+    * afterward that are not nested in the registered ones can still be modified.
+    *
+    * If the environment variable CPPUT_PROFILE_REGISTRATION is set, the first
+    * call also prints the time spent and the allocations made registering the
+    * tests of each suite during static initialization, slowest suites first.
+    * Its value is the number of suites printed if greater than 1, 20 otherwise.
+    * The allocations are only counted if the program is linked with the
+    * cpput_allocationhooks library.
+    */
+   static const FrozenRegistry &freeze();
+
+   static bool isFrozen();
+
+   /*! \brief Starts or stops recording the registrations, as the environment
+    * variable CPPUT_PROFILE_REGISTRATION does, without printing them.
+    * To measure static initialization, call it from a static initializer that
+    * runs before the registrations, in the same translation unit for example.
+    * \returns \c true if the registrations were recorded before the call.
+    */
+   static bool setRegistrationProfiling( bool enabled );
+
+   /// Returns the registrations recorded while profiling, in order.
+   static RegistrationProfile registrationProfile();
+
    static std::string dump();
 };
 
@@ -431,7 +532,10 @@ public:
 /*! This class represents the data about a test.
  * \ingroup group_testcases
  *
- * It is the base class of TestMeta.
+ * It is the base class of TestMeta. The strings (name, description, groups,
+ * dependencies and resources) are interned: each distinct string is stored
+ * once and shared by all the tests. toJson() builds the JSON representation
+ * for the reporters that need it.
  */
 class CPPUT_API MetaData
 {
@@ -449,6 +553,9 @@ public:
 
    std::string name() const;
 
+   /// Returns the interned name, shared by the copies of the test.
+   const char *internedName() const;
+
    void setTimeOut( double timeOutInSeconds );
 
    double timeOut() const;
@@ -459,12 +566,51 @@ public:
 
    std::string groupAt( unsigned int index ) const;
 
+   /// Returns the groups of the test as a bitset, see TestGroupFilter.
+   const TestGroupSet &groupSet() const;
+
+   /*! \brief Declares a test that must pass before this test is run.
+    * \param testName Name of a test of the same suite, a path relative to the
+    *                 suite of this test ("Nested/test"), or the full path of
+    *                 the test ("//Root/Suite/test").
+    */
+   void addDependency( const std::string &testName );
+
+   /// Adds the dependencies separated by spaces, commas or semicolons.
+   void setDependenciesFromPackedString( const std::string &dependencies );
+
+   int dependencyCount() const;
+
+   std::string dependencyAt( unsigned int index ) const;
+
+   /// Declares a resource used by the test, see ResourceRegistry. Duplicates are ignored.
+   void requireResource( const std::string &resourceName );
+
+   int resourceCount() const;
+
+   std::string resourceAt( unsigned int index ) const;
+
+   /// Returns the input of the test, null until the test stores some.
    Json::Value &input();
 
    const Json::Value &input() const;
 
+   /*! Returns the data as a JSON object: "configuration" (name, description,
+    * timeOut, groups, dependencies and resources) and "input".
+    */
+   Json::Value toJson() const;
+
 private:
-   Json::Value info_;
+   typedef std::vector<const char *> InternedStrings;
+
+   const char *name_;
+   const char *description_;
+   double timeOut_;
+   TestGroupSet groupSet_;
+   InternedStrings groups_;
+   InternedStrings dependencies_;
+   InternedStrings resources_;
+   Json::Value input_;
 };
 
 
@@ -527,6 +673,23 @@ public:
 
 
 
+namespace Impl {
+
+   class CPPUT_API ResourceData : public TestExtendedData
+   {
+   public:
+      ResourceData( const std::string &resourceName );
+
+      virtual void apply( MetaData &test ) const;
+
+   private:
+      std::string resourceName_;
+   };
+
+} // namespace Impl
+
+
+
 /*! \ingroup group_testfixture
  */
 class CPPUT_API TestExtendedDataFactory
@@ -541,6 +704,8 @@ public:
    static Impl::DependenciesData depends( const std::string &dependency );
 
    static Impl::GroupData group( const std::string &groupName );
+
+   static Impl::ResourceData requireResource( const std::string &resourceName );
 };
 
 
@@ -702,6 +867,116 @@ TestMeta CPPUT_API makeFailingTestCase( const std::string &name,
                                         const Message &message );
 
 
+/*! \ingroup group_testregistry
+ * \brief Constant-initialized description of a test function.
+ *
+ * A plain aggregate, initialized by the compiler without running code. The
+ * registry turns it into a TestMeta only when the test is selected to run,
+ * see CPPUT_STATIC_TEST_FUNCTION().
+ */
+struct TestDescriptor
+{
+   /// Path of the suite from the root suite, "Parser/Literals" for example.
+   const char *suitePath_;
+   const char *name_;
+   void (*run_)();
+   /// Description of the test, or 0.
+   const char *description_;
+   /// Time-out in seconds, 0 if none.
+   double timeOut_;
+   /// Groups of the test separated by spaces, or 0.
+   const char *groups_;
+   /// Next descriptor of the registry list, set by TestDescriptorLink.
+   TestDescriptor *next_;
+};
+
+
+/*! \ingroup group_testregistry
+ * \brief Adds a TestDescriptor to the registry.
+ * Only links the descriptor in a list, without allocating nor locking. The
+ * suites of the descriptors are created by Registry::freeze(), so the tests are
+ * only visible in the FrozenRegistry.
+ */
+class CPPUT_API TestDescriptorLink
+{
+public:
+   explicit TestDescriptorLink( TestDescriptor &descriptor );
+};
+
+
+/*! \ingroup group_testregistry
+ * \brief Immutable flattened copy of a tree of suites, see Registry::freeze().
+ *
+ * The suites are stored breadth-first, so that the nested suites of a suite are
+ * contiguous, and so are its tests. Reading a FrozenRegistry takes no lock, so
+ * that it can be traversed concurrently by several threads.
+ */
+class CPPUT_API FrozenRegistry
+{
+   friend class Impl::RegistryImpl;
+public:
+   struct SuiteEntry
+   {
+      Suite suite_;
+      CppTL::ConstString name_;
+      /// The names of the suite and of its parents, each preceded by a '/'.
+      /// "//Root1" for suite "Root1" of the root suite.
+      CppTL::ConstString path_;
+      /// Index of the parent suite, -1 for the first suite.
+      int parent_;
+      int firstNestedSuite_;
+      int endNestedSuite_;
+      int firstTest_;
+      int endTest_;
+   };
+
+   struct TestEntry
+   {
+      /// 0 for a test registered with a TestDescriptor until testMetaAt() is
+      /// called for it.
+      mutable const TestMeta *test_;
+      /// Descriptor of the test, or 0.
+      const TestDescriptor *descriptor_;
+      CppTL::ConstString name_;
+      /// Path of the test, "//Root1/testRoot1Test1" for example.
+      CppTL::ConstString path_;
+      /// Index of the suite of the test.
+      int suite_;
+   };
+
+   /// Creates an empty snapshot.
+   FrozenRegistry();
+
+   /// Creates a snapshot of \a rootSuite and of its nested suites. The paths
+   /// start with the path of \a rootSuite in the registry.
+   explicit FrozenRegistry( const Suite &rootSuite );
+
+   int suiteCount() const;
+   const SuiteEntry &suiteAt( int index ) const;
+
+   int testCount() const;
+   const TestEntry &testAt( int index ) const;
+
+   /// Returns the test, creating its TestMeta on the first call if it was
+   /// registered with a TestDescriptor. Takes a lock in this case only.
+   const TestMeta &testMetaAt( int index ) const;
+
+   /// Returns the index of the suite, -1 if it is not in the snapshot.
+   int indexOf( const Suite &suite ) const;
+
+private:
+   typedef std::vector<SuiteEntry> SuiteEntries;
+   SuiteEntries suites_;
+   typedef std::vector<TestEntry> TestEntries;
+   TestEntries tests_;
+   typedef std::map<Suite,int> SuiteIndexes;
+   SuiteIndexes indexes_;
+   /// The tests created from their TestDescriptor.
+   mutable std::deque<TestMeta> createdTests_;
+   mutable CppTL::Mutex lock_;
+};
+
+
 
 
 /** Exception handler context.
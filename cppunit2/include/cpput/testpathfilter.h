@@ -0,0 +1,109 @@
+#ifndef CPPUT_TESTPATHFILTER_H_INCLUDED
+# define CPPUT_TESTPATHFILTER_H_INCLUDED
+
+# include <cpput/forwards.h>
+# include <map>
+# include <string>
+# include <vector>
+
+namespace CppUT {
+
+/*! \brief Selects tests by matching their path against glob patterns.
+ *
+ * A test is selected if its path matches at least one include pattern (or if
+ * there is no include pattern) and matches no exclude pattern. Patterns are
+ * matched against the whole test path, as reported by the test runner:
+ * - '*' matches any sequence of characters, including '/',
+ * - '?' matches any single character,
+ * - '\' matches the next character literally.
+ *
+ * All the patterns are compiled into a single automaton, which is made
+ * deterministic lazily as paths are matched. The path is fed incrementally
+ * while walking the suite tree, so that a suite whose path can not lead to a
+ * selected test can be skipped with all its nested suites (see isPruned()).
+ *
+ * Example:
+ * \code
+ * TestPathFilter filter;
+ * filter.addInclude( "*Parser*" );
+ * filter.addExclude( "//Slow/" "*" );
+ * TestPathFilter::State state = filter.advance( filter.start(), "//Slow" );
+ * if ( !filter.isPruned( state ) )
+ *    ...
+ * \endcode
+ */
+class CPPUT_API TestPathFilter
+{
+public:
+   typedef unsigned int State;
+
+   TestPathFilter();
+
+   void addInclude( const std::string &pattern );
+
+   void addExclude( const std::string &pattern );
+
+   /// Returns \c true if no pattern was added.
+   bool isEmpty() const;
+
+   /// Returns the state before matching any character.
+   State start();
+
+   /// Returns the state reached by matching \c text from \c state.
+   State advance( State state, 
+                  const std::string &text );
+
+   /// Returns \c true if no path starting with the text matched so far can
+   /// be selected.
+   bool isPruned( State state ) const;
+
+   /// Returns \c true if the text matched so far is a selected path.
+   bool isSelected( State state ) const;
+
+private:
+   struct Token
+   {
+      enum Kind
+      {
+         literal = 1,
+         anyChar,
+         anySequence,
+         accept
+      };
+
+      Kind kind_;
+      char literal_;
+      bool isExclude_;
+   };
+
+   /// State of the deterministic automaton: a set of states of the
+   /// non-deterministic automaton, which are indexes in tokens_.
+   struct DeterministicState
+   {
+      std::vector<unsigned int> positions_;
+      /// Next state for each character, or -1 if not computed yet.
+      std::vector<int> transitions_;
+      bool isPruned_;
+      bool isSelected_;
+   };
+
+   void addPattern( const std::string &pattern, bool isExclude );
+   void addClosure( std::vector<unsigned int> &positions ) const;
+   State intern( std::vector<unsigned int> &positions );
+   State transition( State state, unsigned char c );
+
+   typedef std::vector<Token> Tokens;
+   Tokens tokens_;
+   std::vector<unsigned int> startPositions_;
+   typedef std::vector<DeterministicState> DeterministicStates;
+   DeterministicStates states_;
+   typedef std::map<std::vector<unsigned int>, State> StateIndex;
+   StateIndex stateIndex_;
+   bool hasInclude_;
+   bool isCompiled_;
+};
+
+} // namespace CppUT
+
+
+#endif // CPPUT_TESTPATHFILTER_H_INCLUDED
@@ -0,0 +1,84 @@
+#include <cpptl/clock.h>
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
+# define CPPTL_USE_WIN32_CLOCK 1
+# if !defined(APIENTRY)
+#  undef NOMINMAX
+#  define WIN32_LEAN_AND_MEAN 
+#  define NOGDI
+#  define NOUSER
+#  define NOKERNEL
+#  define NOSOUND
+#  define NOMINMAX
+#  define BLENDFUNCTION void    // for mingw & gcc
+#  include <windows.h>
+# endif
+#endif
+#include <time.h>
+#if !defined(CPPTL_USE_WIN32_CLOCK)
+# include <sys/time.h>
+# include <unistd.h>
+#endif
+
+namespace CppTL {
+
+// class Clock
+// //////////////////////////////////////////////////////////////////////
+
+#if CPPTL_USE_WIN32_CLOCK
+
+double 
+Clock::monotonic()
+{
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+   if ( !::QueryPerformanceFrequency( &frequency )  ||  !::QueryPerformanceCounter( &counter ) )
+      return ::GetTickCount() / 1000.0;
+   return double(counter.QuadPart) / double(frequency.QuadPart);
+}
+
+
+double 
+Clock::threadCpu()
+{
+   FILETIME creationTime, exitTime, kernelTime, userTime;
+   if ( !::GetThreadTimes( ::GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime ) )
+      return double( clock() ) / CLOCKS_PER_SEC;
+   // FILETIME are in 100 nanoseconds units
+   ULARGE_INTEGER kernel, user;
+   kernel.LowPart = kernelTime.dwLowDateTime;
+   kernel.HighPart = kernelTime.dwHighDateTime;
+   user.LowPart = userTime.dwLowDateTime;
+   user.HighPart = userTime.dwHighDateTime;
+   return double( kernel.QuadPart + user.QuadPart ) / 1e7;
+}
+
+#else
+
+double 
+Clock::monotonic()
+{
+# if defined(_POSIX_MONOTONIC_CLOCK) && _POSIX_MONOTONIC_CLOCK >= 0
+   struct timespec now;
+   if ( clock_gettime( CLOCK_MONOTONIC, &now ) == 0 )
+      return now.tv_sec + now.tv_nsec / 1e9;
+# endif
+   struct timeval time;
+   gettimeofday( &time, 0 );
+   return time.tv_sec + time.tv_usec / 1e6;
+}
+
+
+double 
+Clock::threadCpu()
+{
+# if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+   struct timespec now;
+   if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now ) == 0 )
+      return now.tv_sec + now.tv_nsec / 1e9;
+# endif
+   return double( clock() ) / CLOCKS_PER_SEC;
+}
+
+#endif
+
+} // namespace CppTL
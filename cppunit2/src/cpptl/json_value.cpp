@@ -1013,6 +1013,8 @@ Value::Members
 Value::getMemberNames() const
 {
    JSON_ASSERT( type_ == nullValue  ||  type_ == objectValue );
+   if ( type_ == nullValue )
+       return Value::Members();
    Members members;
    members.reserve( value_.map_->size() );
    ObjectValues::const_iterator it = value_.map_->begin();
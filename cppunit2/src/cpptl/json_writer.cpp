@@ -64,7 +64,32 @@ std::string valueToString( bool value )
 
 std::string valueToQuotedString( const char *value )
 {
-   return std::string("\"") + value + "\"";
+   // Escapes the characters that Reader::decodeString() expects to be escaped.
+   std::string result( "\"" );
+   for ( const char *c = value; *c != 0; ++c )
+   {
+      switch ( *c )
+      {
+      case '"': result += "\\\""; break;
+      case '\\': result += "\\\\"; break;
+      case '\b': result += "\\b"; break;
+      case '\f': result += "\\f"; break;
+      case '\n': result += "\\n"; break;
+      case '\r': result += "\\r"; break;
+      case '\t': result += "\\t"; break;
+      default:
+         if ( (unsigned char)*c < 0x20 )
+         {
+            char buffer[8];
+            sprintf( buffer, "\\u%04x", (unsigned int)(unsigned char)*c );
+            result += buffer;
+         }
+         else
+            result += *c;
+      }
+   }
+   result += "\"";
+   return result;
 }
 
 
@@ -15,6 +15,10 @@
 #  endif
 # elif defined(CPPTL_USE_PTHREAD_THREAD)
 #  include <pthread.h>
+#  include <errno.h>
+#  include <sched.h>
+#  include <time.h>
+#  include <unistd.h>
 # endif // # elif defined(CPPTL_USE_PTHREAD_THREAD)
 #endif
 
@@ -239,6 +243,84 @@ Mutex::unlock()
 }
 
 
+// class Thread (win32)
+// //////////////////////////////////////////////////////////////////////
+
+static DWORD WINAPI threadEntry( LPVOID param )
+{
+   Functor0 &run = *static_cast<Functor0 *>( param );
+   run();
+   processThreadExitHandlers();
+   return 0;
+}
+
+
+Thread::Thread()
+   : data_( 0 )
+{
+}
+
+
+Thread::~Thread()
+{
+   join();
+}
+
+
+bool 
+Thread::start( const Functor0 &run )
+{
+   CPPTL_ASSERT_MESSAGE( !isJoinable(), "Thread already started." );
+   run_ = run;
+   data_ = ::CreateThread( 0, 0, &threadEntry, &run_, 0, 0 );
+   return data_ != 0;
+}
+
+
+bool 
+Thread::join()
+{
+   if ( !isJoinable() )
+      return true;
+   HANDLE handle = static_cast<HANDLE>( data_ );
+   if ( ::WaitForSingleObject( handle, INFINITE ) != WAIT_OBJECT_0 )
+      return false;
+   ::CloseHandle( handle );
+   data_ = 0;
+   return true;
+}
+
+
+bool 
+Thread::isJoinable() const
+{
+   return data_ != 0;
+}
+
+
+void 
+Thread::yield()
+{
+   ::Sleep( 0 );
+}
+
+
+void 
+Thread::sleep( unsigned int milliseconds )
+{
+   ::Sleep( milliseconds );
+}
+
+
+unsigned int 
+Thread::hardwareConcurrency()
+{
+   SYSTEM_INFO info;
+   ::GetSystemInfo( &info );
+   return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+
 // class Impl::RawThreadStorage (win32)
 // //////////////////////////////////////////////////////////////////////
 
@@ -352,6 +434,95 @@ Mutex::unlock()
 }
 
 
+// class Thread (pthread)
+// //////////////////////////////////////////////////////////////////////
+
+extern "C" {
+   static void *cpptlThreadEntry( void *param )
+   {
+      Functor0 &run = *static_cast<Functor0 *>( param );
+      run();
+      processThreadExitHandlers();
+      return 0;
+   }
+}
+
+
+Thread::Thread()
+   : data_( 0 )
+{
+}
+
+
+Thread::~Thread()
+{
+   join();
+}
+
+
+bool 
+Thread::start( const Functor0 &run )
+{
+   CPPTL_ASSERT_MESSAGE( !isJoinable(), "Thread already started." );
+   run_ = run;
+   pthread_t *thread = new pthread_t();
+   if ( pthread_create( thread, 0, &cpptlThreadEntry, &run_ ) != 0 )
+   {
+      delete thread;
+      return false;
+   }
+   data_ = thread;
+   return true;
+}
+
+
+bool 
+Thread::join()
+{
+   if ( !isJoinable() )
+      return true;
+   pthread_t *thread = static_cast<pthread_t *>( data_ );
+   if ( pthread_join( *thread, 0 ) != 0 )
+      return false;
+   delete thread;
+   data_ = 0;
+   return true;
+}
+
+
+bool 
+Thread::isJoinable() const
+{
+   return data_ != 0;
+}
+
+
+void 
+Thread::yield()
+{
+   sched_yield();
+}
+
+
+void 
+Thread::sleep( unsigned int milliseconds )
+{
+   struct timespec duration;
+   duration.tv_sec = milliseconds / 1000;
+   duration.tv_nsec = (milliseconds % 1000) * 1000000L;
+   while ( nanosleep( &duration, &duration ) != 0  &&  errno == EINTR )
+      ;
+}
+
+
+unsigned int 
+Thread::hardwareConcurrency()
+{
+   long count = sysconf( _SC_NPROCESSORS_ONLN );
+   return count > 0 ? (unsigned int)count : 1;
+}
+
+
 // class Impl::ThreadLocalStorageImpl (pthread)
 // //////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,231 @@
+// Replaces the global allocation functions to count the heap allocations of
+// each thread (see cpput/allocationtracker.h).
+// This file is built as the separate cpput_allocationhooks library: linking
+// with it is what enables allocation tracking.
+
+#include <cpput/allocationtracker.h>
+#include <new>
+#include <errno.h>
+#include <stdlib.h>
+
+#if defined(__GLIBC__)
+# include <malloc.h>
+// malloc() and friends are replaced too, forwarding to the GNU C library
+// implementation. operator new then relies on them to count its allocations.
+# define CPPUT_HOOK_MALLOC 1
+#elif defined(__APPLE__)
+# include <malloc/malloc.h>
+#elif defined(_MSC_VER)
+# include <malloc.h>
+#endif
+
+namespace {
+
+   /// Returns the usable size of a block returned by malloc().
+   size_t allocationSize( void *pointer )
+   {
+#if defined(__GLIBC__)
+      return malloc_usable_size( pointer );
+#elif defined(__APPLE__)
+      return malloc_size( pointer );
+#elif defined(_MSC_VER)
+      return _msize( pointer );
+#else
+      return 0;
+#endif
+   }
+
+
+   void *allocate( size_t size )
+   {
+      void *pointer = malloc( size == 0 ? 1 : size );
+#if !CPPUT_HOOK_MALLOC
+      if ( pointer != 0 )
+         CppUT::Impl::recordAllocation( allocationSize( pointer ) );
+#endif
+      return pointer;
+   }
+
+
+   void deallocate( void *pointer )
+   {
+#if !CPPUT_HOOK_MALLOC
+      if ( pointer != 0 )
+         CppUT::Impl::recordDeallocation( allocationSize( pointer ) );
+#endif
+      free( pointer );
+   }
+
+
+   class AllocationHooksInstaller
+   {
+   public:
+      AllocationHooksInstaller()
+      {
+         CppUT::Impl::setAllocationHooksInstalled();
+      }
+   };
+
+   AllocationHooksInstaller installer;
+
+} // end anonymous namespace
+
+
+#if CPPUT_HOOK_MALLOC
+extern "C" {
+
+void *__libc_malloc( size_t size );
+void *__libc_calloc( size_t count, size_t size );
+void *__libc_realloc( void *pointer, size_t size );
+void *__libc_memalign( size_t alignment, size_t size );
+void __libc_free( void *pointer );
+
+
+void *
+malloc( size_t size )
+{
+   void *pointer = __libc_malloc( size );
+   if ( pointer != 0 )
+      CppUT::Impl::recordAllocation( malloc_usable_size( pointer ) );
+   return pointer;
+}
+
+
+void *
+calloc( size_t count,
+        size_t size )
+{
+   void *pointer = __libc_calloc( count, size );
+   if ( pointer != 0 )
+      CppUT::Impl::recordAllocation( malloc_usable_size( pointer ) );
+   return pointer;
+}
+
+
+void *
+realloc( void *pointer,
+         size_t size )
+{
+   const size_t oldSize = pointer != 0 ? malloc_usable_size( pointer ) : 0;
+   void *newPointer = __libc_realloc( pointer, size );
+   if ( newPointer != 0  ||  size == 0 )
+   {
+      if ( pointer != 0 )
+         CppUT::Impl::recordDeallocation( oldSize );
+      if ( newPointer != 0 )
+         CppUT::Impl::recordAllocation( malloc_usable_size( newPointer ) );
+   }
+   return newPointer;
+}
+
+
+void *
+memalign( size_t alignment,
+          size_t size )
+{
+   void *pointer = __libc_memalign( alignment, size );
+   if ( pointer != 0 )
+      CppUT::Impl::recordAllocation( malloc_usable_size( pointer ) );
+   return pointer;
+}
+
+
+void *
+aligned_alloc( size_t alignment,
+               size_t size )
+{
+   return memalign( alignment, size );
+}
+
+
+int
+posix_memalign( void **result,
+                size_t alignment,
+                size_t size )
+{
+   if ( alignment % sizeof(void *) != 0  ||  (alignment & (alignment - 1)) != 0 )
+      return EINVAL;
+   void *pointer = memalign( alignment, size );
+   if ( pointer == 0 )
+      return ENOMEM;
+   *result = pointer;
+   return 0;
+}
+
+
+void
+free( void *pointer )
+{
+   if ( pointer != 0 )
+      CppUT::Impl::recordDeallocation( malloc_usable_size( pointer ) );
+   __libc_free( pointer );
+}
+
+} // extern "C"
+#endif // CPPUT_HOOK_MALLOC
+
+
+void *
+operator new( size_t size ) throw( std::bad_alloc )
+{
+   void *pointer = allocate( size );
+   if ( pointer == 0 )
+      throw std::bad_alloc();
+   return pointer;
+}
+
+
+void *
+operator new[]( size_t size ) throw( std::bad_alloc )
+{
+   void *pointer = allocate( size );
+   if ( pointer == 0 )
+      throw std::bad_alloc();
+   return pointer;
+}
+
+
+void *
+operator new( size_t size,
+              const std::nothrow_t & ) throw()
+{
+   return allocate( size );
+}
+
+
+void *
+operator new[]( size_t size,
+                const std::nothrow_t & ) throw()
+{
+   return allocate( size );
+}
+
+
+void
+operator delete( void *pointer ) throw()
+{
+   deallocate( pointer );
+}
+
+
+void
+operator delete[]( void *pointer ) throw()
+{
+   deallocate( pointer );
+}
+
+
+void
+operator delete( void *pointer,
+                 const std::nothrow_t & ) throw()
+{
+   deallocate( pointer );
+}
+
+
+void
+operator delete[]( void *pointer,
+                   const std::nothrow_t & ) throw()
+{
+   deallocate( pointer );
+}
@@ -0,0 +1,220 @@
+#include <cpput/allocationtracker.h>
+
+// The counters are only accessed by their thread, and must not be allocated
+// on the heap, since they are updated by the allocation hooks.
+#if defined(_MSC_VER)
+# define CPPUT_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+# define CPPUT_THREAD_LOCAL __thread
+#else
+# define CPPUT_THREAD_LOCAL
+#endif
+
+namespace {
+
+   struct ThreadAllocations
+   {
+      CppTL::LargestUnsignedInt allocationCount_;
+      CppTL::LargestUnsignedInt deallocationCount_;
+      CppTL::LargestUnsignedInt allocatedBytes_;
+      CppTL::LargestUnsignedInt deallocatedBytes_;
+      CppTL::LargestInt liveBytes_;
+      CppTL::LargestInt peakLiveBytes_;
+      unsigned int pauseDepth_;
+   };
+
+   CPPUT_THREAD_LOCAL ThreadAllocations threadAllocations;
+
+   bool hooksInstalled = false;
+   bool trackingEnabled = false;
+
+} // end anonymous namespace
+
+
+namespace CppUT {
+
+// Class AllocationCounters
+// //////////////////////////////////////////////////////////////////
+
+AllocationCounters::AllocationCounters()
+   : allocationCount_( 0 )
+   , deallocationCount_( 0 )
+   , allocatedBytes_( 0 )
+   , deallocatedBytes_( 0 )
+   , liveBytes_( 0 )
+   , peakLiveBytes_( 0 )
+{
+}
+
+
+// Allocation tracking functions
+// //////////////////////////////////////////////////////////////////
+
+bool
+areAllocationHooksInstalled()
+{
+   return hooksInstalled;
+}
+
+
+void
+setAllocationTracking( bool enabled )
+{
+   trackingEnabled = enabled;
+}
+
+
+bool
+isAllocationTrackingEnabled()
+{
+   return trackingEnabled  &&  hooksInstalled;
+}
+
+
+AllocationCounters
+threadAllocationCounters()
+{
+   AllocationCounters counters;
+   const ThreadAllocations &allocations = threadAllocations;
+   counters.allocationCount_ = allocations.allocationCount_;
+   counters.deallocationCount_ = allocations.deallocationCount_;
+   counters.allocatedBytes_ = allocations.allocatedBytes_;
+   counters.deallocatedBytes_ = allocations.deallocatedBytes_;
+   counters.liveBytes_ = allocations.liveBytes_;
+   counters.peakLiveBytes_ = allocations.peakLiveBytes_;
+   return counters;
+}
+
+
+CheckerResult
+checkNoAllocation( const AllocationRegion &region,
+                   const char *expressionCode )
+{
+   const CppTL::LargestUnsignedInt allocationCount = region.allocationCount();
+   const CppTL::LargestUnsignedInt allocatedBytes = region.allocatedBytes();
+   CheckerResult result;
+   if ( !areAllocationHooksInstalled() )
+   {
+      result.setFailed();
+      result.setName( "no allocation" );
+      result.appendMessage( "allocations are not tracked: the program is not linked "
+                            "with the cpput_allocationhooks library." );
+   }
+   else if ( allocationCount != 0 )
+   {
+      result.setFailed();
+      result.setName( "no allocation" );
+      result.appendMessage( "expression allocated memory." );
+      result.predicate( "expression" ) = expressionCode;
+      result.predicate( "allocations" ) = double(allocationCount);
+      result.predicate( "bytes" ) = double(allocatedBytes);
+   }
+   return result;
+}
+
+
+// Class AllocationRegion
+// //////////////////////////////////////////////////////////////////
+
+AllocationRegion::AllocationRegion()
+   : start_( threadAllocationCounters() )
+{
+   threadAllocations.peakLiveBytes_ = threadAllocations.liveBytes_;
+}
+
+
+AllocationRegion::~AllocationRegion()
+{
+   threadAllocations.peakLiveBytes_ = CPPTL_MAX( threadAllocations.peakLiveBytes_,
+                                                 start_.peakLiveBytes_ );
+}
+
+
+CppTL::LargestUnsignedInt
+AllocationRegion::allocationCount() const
+{
+   return threadAllocations.allocationCount_ - start_.allocationCount_;
+}
+
+
+CppTL::LargestUnsignedInt
+AllocationRegion::allocatedBytes() const
+{
+   return threadAllocations.allocatedBytes_ - start_.allocatedBytes_;
+}
+
+
+CppTL::LargestInt
+AllocationRegion::liveAllocationCount() const
+{
+   return CppTL::LargestInt( allocationCount() )
+          - CppTL::LargestInt( threadAllocations.deallocationCount_ - start_.deallocationCount_ );
+}
+
+
+CppTL::LargestInt
+AllocationRegion::liveBytes() const
+{
+   return threadAllocations.liveBytes_ - start_.liveBytes_;
+}
+
+
+CppTL::LargestInt
+AllocationRegion::peakLiveBytes() const
+{
+   return threadAllocations.peakLiveBytes_ - start_.liveBytes_;
+}
+
+
+// Class AllocationTrackingPause
+// //////////////////////////////////////////////////////////////////
+
+AllocationTrackingPause::AllocationTrackingPause()
+{
+   ++threadAllocations.pauseDepth_;
+}
+
+
+AllocationTrackingPause::~AllocationTrackingPause()
+{
+   --threadAllocations.pauseDepth_;
+}
+
+
+namespace Impl {
+
+void
+recordAllocation( size_t size )
+{
+   ThreadAllocations &allocations = threadAllocations;
+   if ( allocations.pauseDepth_ != 0 )
+      return;
+   ++allocations.allocationCount_;
+   allocations.allocatedBytes_ += size;
+   allocations.liveBytes_ += size;
+   if ( allocations.liveBytes_ > allocations.peakLiveBytes_ )
+      allocations.peakLiveBytes_ = allocations.liveBytes_;
+}
+
+
+void
+recordDeallocation( size_t size )
+{
+   ThreadAllocations &allocations = threadAllocations;
+   if ( allocations.pauseDepth_ != 0 )
+      return;
+   ++allocations.deallocationCount_;
+   allocations.deallocatedBytes_ += size;
+   allocations.liveBytes_ -= size;
+}
+
+
+void
+setAllocationHooksInstalled()
+{
+   hooksInstalled = true;
+}
+
+} // namespace Impl
+
+} // namespace CppUT
@@ -0,0 +1,904 @@
+#include <cpput/benchmark.h>
+#include <cpput/assertcommon.h>
+#include <cpput/perfcounters.h>
+#include <cpput/testinfo.h>
+#include <cpptl/clock.h>
+#include <cpptl/functor.h>
+#include <cpptl/scopedptr.h>
+#include <cpptl/thread.h>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+namespace {
+
+   CppUT::BenchmarkSettings &settings()
+   {
+      static CppUT::BenchmarkSettings instance;
+      return instance;
+   }
+
+
+   /// Returns the quantile of sorted samples, interpolating between the closest ones.
+   double quantile( const std::vector<double> &sortedSamples,
+                    double probability )
+   {
+      if ( sortedSamples.empty() )
+         return 0;
+      double position = probability * (sortedSamples.size() - 1);
+      unsigned int index = (unsigned int)position;
+      if ( index + 1 >= sortedSamples.size() )
+         return sortedSamples.back();
+      double weight = position - index;
+      return sortedSamples[index] * (1 - weight) + sortedSamples[index + 1] * weight;
+   }
+
+
+   /// Returns the probability that a standard normal variable exceeds |z| in
+   /// absolute value (Abramowitz and Stegun 7.1.26, error below 1.5e-7).
+   double twoSidedNormalTail( double z )
+   {
+      const double x = fabs( z ) / sqrt( 2.0 );
+      const double t = 1 / (1 + 0.3275911 * x);
+      const double polynomial = t * (0.254829592 + t * (-0.284496736 
+                                + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429))));
+      return polynomial * exp( -x * x );
+   }
+
+
+   double median( const std::vector<double> &samples )
+   {
+      std::vector<double> sorted( samples );
+      std::sort( sorted.begin(), sorted.end() );
+      return quantile( sorted, 0.5 );
+   }
+
+
+   /// What a benchmark test case measures.
+   struct BenchmarkDefinition
+   {
+      BenchmarkDefinition( CppUT::BenchmarkFn run = 0 )
+         : run_( run )
+         , expected_( CppUT::complexityUnspecified )
+         , isThreaded_( false )
+         , maxThreadCount_( 0 )
+      {
+      }
+
+      CppUT::BenchmarkFn run_;
+      CppUT::BenchmarkRange range_;
+      CppUT::BenchmarkComplexity expected_;
+      bool isThreaded_;
+      unsigned int maxThreadCount_;
+   };
+
+
+#if CPPTL_HAS_THREAD
+   /// Releases a fixed number of threads together.
+   class StartBarrier
+   {
+   public:
+      StartBarrier( unsigned int threadCount )
+         : remaining_( threadCount )
+      {
+      }
+
+      /// Waits until all the threads have arrived or left.
+      void arriveAndWait()
+      {
+         leave();
+         for ( ;; )
+         {
+            {
+               CppTL::Mutex::ScopedLockGuard guard( lock_ );
+               if ( remaining_ == 0 )
+                  return;
+            }
+            CppTL::Thread::yield();
+         }
+      }
+
+      /// Stops waiting for a thread that will not arrive.
+      void leave()
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         --remaining_;
+      }
+
+   private:
+      CppTL::Mutex lock_;
+      unsigned int remaining_;
+   };
+
+
+   /* Runs the benchmark body on a secondary thread of a sample.
+    * The thread has its own TestInfo: the failure is only recorded, to be
+    * reported by the first thread.
+    */
+   class BenchmarkThread
+   {
+   public:
+      BenchmarkThread( CppUT::BenchmarkFn run,
+                       StartBarrier &barrier,
+                       CppUT::BenchmarkState::IterationCount iterationCount,
+                       unsigned int range,
+                       unsigned int threadIndex,
+                       unsigned int threadCount )
+         : run_( run )
+         , barrier_( barrier )
+         , state_( iterationCount, range, threadIndex, threadCount )
+         , startTime_( 0 )
+         , stopTime_( 0 )
+      {
+      }
+
+      void run()
+      {
+         CppUT::TestInfo &testInfo = CppUT::TestInfo::threadInstance();
+         testInfo.startNewTest();
+         barrier_.arriveAndWait();
+         startTime_ = CppTL::Clock::monotonic();
+         try
+         {
+            run_( state_ );
+         }
+         catch ( const CppUT::AbortingAssertionException &e )
+         {
+            const std::string prefix( "AbortingAssertionException:\n" );
+            failure_ = e.what();
+            if ( failure_.compare( 0, prefix.length(), prefix ) == 0 )
+               failure_.erase( 0, prefix.length() );
+         }
+         catch ( const std::exception &e )
+         {
+            failure_ = e.what();
+         }
+         catch ( ... )
+         {
+            failure_ = "Unexpected exception.";
+         }
+         stopTime_ = CppTL::Clock::monotonic();
+         if ( failure_.empty()  &&  testInfo.testStatus().hasFailed() )
+            failure_ = "Assertion failed.";
+         if ( state_.loopDuration() > 0 )
+         {
+            startTime_ = state_.loopStartTime();
+            stopTime_ = startTime_ + state_.loopDuration();
+         }
+      }
+
+      CppUT::BenchmarkFn run_;
+      StartBarrier &barrier_;
+      CppUT::BenchmarkState state_;
+      double startTime_;
+      double stopTime_;
+      std::string failure_;
+   };
+#endif
+
+
+   /* Measures a benchmark function.
+    * The iteration count is first calibrated by running samples of increasing
+    * iteration count until one lasts for the target sample time. The benchmark
+    * keeps running until the warm-up time has elapsed, then the samples are
+    * measured.
+    * A benchmark with a range is measured that way for each size, only the
+    * first one being warmed up, and its median durations are fitted to the
+    * complexities. A threaded benchmark is measured that way for each thread
+    * count, with the iteration count calibrated on a single thread.
+    */
+   class BenchmarkTestCase : public CppUT::TestCase
+   {
+   public:
+      typedef CppUT::BenchmarkState::IterationCount IterationCount;
+
+      static CppUT::TestCase *factory( BenchmarkDefinition definition )
+      {
+         return new BenchmarkTestCase( definition );
+      }
+
+      BenchmarkTestCase( const BenchmarkDefinition &definition )
+         : definition_( definition )
+      {
+      }
+
+   public: // overriden from TestCase
+      virtual void run()
+      {
+         if ( definition_.isThreaded_ )
+            runOnThreads();
+         else if ( definition_.range_.isEmpty() )
+         {
+            CppUT::BenchmarkStatistics statistics;
+            IterationCount iterationCount = 0;
+            if ( measureSamples( 0, 1, settings().warmUpTime_, statistics, iterationCount ) )
+               setBenchmarkStatistics( statistics, iterationCount );
+         }
+         else
+            runSweep();
+      }
+
+   private:
+      void runSweep()
+      {
+         const CppUT::BenchmarkComplexity expected = definition_.expected_;
+         const std::vector<unsigned int> sizes = definition_.range_.sizes();
+         std::vector<double> medians;
+         Json::Value sweep( Json::objectValue );
+         Json::Value &ranges = sweep["ranges"];
+         Json::Value &mediansNs = sweep["median_ns"];
+         ranges = Json::Value( Json::arrayValue );
+         mediansNs = Json::Value( Json::arrayValue );
+         double warmUpTime = settings().warmUpTime_;
+         for ( std::vector<unsigned int>::const_iterator it = sizes.begin(); it != sizes.end(); ++it )
+         {
+            CppUT::BenchmarkStatistics statistics;
+            IterationCount iterationCount = 0;
+            if ( !measureSamples( *it, 1, warmUpTime, statistics, iterationCount ) )
+               return;
+            warmUpTime = 0;
+            medians.push_back( statistics.median_ );
+            ranges.append( *it );
+            mediansNs.append( statistics.median_ );
+            if ( *it == sizes.back() )
+               setBenchmarkStatistics( statistics, iterationCount );
+         }
+
+         CppUT::BenchmarkComplexityFit fit = CppUT::BenchmarkComplexityFit::compute( sizes, medians );
+         sweep["complexity"] = CppUT::complexityName( fit.complexity_ );
+         sweep["coefficient_ns"] = fit.coefficient_;
+         sweep["rms"] = fit.rms_;
+         if ( expected != CppUT::complexityUnspecified )
+            sweep["expected"] = CppUT::complexityName( expected );
+         CppUT::TestInfo::threadInstance().testStatus().setStatistics( "sweep", sweep );
+
+         if ( fit.complexity_ > expected )
+         {
+            CppUT::BenchmarkComplexityFit expectedFit = 
+               CppUT::BenchmarkComplexityFit::compute( sizes, medians, expected );
+            char message[256];
+            sprintf( message, "Benchmark complexity is %s (rms %.1f%%), expected %s (rms %.1f%%).",
+                     CppUT::complexityName( fit.complexity_ ), fit.rms_ * 100,
+                     CppUT::complexityName( expected ), expectedFit.rms_ * 100 );
+            CPPUT_CHECKING_FAIL( message );
+         }
+      }
+
+      void runOnThreads()
+      {
+         unsigned int maxThreadCount = definition_.maxThreadCount_;
+         if ( maxThreadCount == 0 )
+            maxThreadCount = CPPTL_MAX( CppTL::Thread::hardwareConcurrency(), 1u );
+#if !CPPTL_HAS_THREAD
+         maxThreadCount = 1;
+#endif
+         const std::vector<unsigned int> threadCounts = CppUT::BenchmarkRange( 1, maxThreadCount ).sizes();
+         Json::Value scaling( Json::objectValue );
+         Json::Value &threads = scaling["threads"];
+         Json::Value &throughputs = scaling["ops_per_second"];
+         Json::Value &efficiencies = scaling["efficiency"];
+         threads = Json::Value( Json::arrayValue );
+         throughputs = Json::Value( Json::arrayValue );
+         efficiencies = Json::Value( Json::arrayValue );
+         IterationCount iterationCount = 0;
+         double singleThreadThroughput = 0;
+         double warmUpTime = settings().warmUpTime_;
+         for ( std::vector<unsigned int>::const_iterator it = threadCounts.begin(); it != threadCounts.end(); ++it )
+         {
+            CppUT::BenchmarkStatistics statistics;
+            if ( !measureSamples( 0, *it, warmUpTime, statistics, iterationCount ) )
+               return;
+            warmUpTime = 0;
+            // Each thread runs the iteration count in the duration of the sample.
+            const double throughput = statistics.median_ > 0 ? *it * 1e9 / statistics.median_ : 0.0;
+            if ( *it == 1 )
+            {
+               singleThreadThroughput = throughput;
+               setBenchmarkStatistics( statistics, iterationCount );
+            }
+            threads.append( *it );
+            throughputs.append( throughput );
+            efficiencies.append( singleThreadThroughput > 0 ? throughput / (*it * singleThreadThroughput) 
+                                                            : 0.0 );
+         }
+         CppUT::TestInfo::threadInstance().testStatus().setStatistics( "scaling", scaling );
+      }
+
+      /// Measures the samples of an input size on a thread count. The iteration
+      /// count is calibrated if \a iterationCount is 0. @returns \c false if the
+      /// benchmark failed.
+      bool measureSamples( unsigned int range,
+                           unsigned int threadCount,
+                           double warmUpTime,
+                           CppUT::BenchmarkStatistics &statistics,
+                           IterationCount &iterationCount )
+      {
+         const CppUT::BenchmarkSettings &benchmarkSettings = settings();
+         const double warmUpEnd = CppTL::Clock::monotonic() + warmUpTime;
+         if ( iterationCount == 0 )
+            iterationCount = calibrate( range, benchmarkSettings.sampleTime_ );
+         while ( CppTL::Clock::monotonic() < warmUpEnd )
+         {
+            if ( !measure( range, threadCount, iterationCount ) )
+               return false;
+         }
+
+         // The events are only counted on the current thread.
+         CppTL::ScopedPtr<CppUT::PerfCounters> counters;
+         if ( CppUT::arePerfCountersEnabled()  &&  threadCount == 1 )
+            counters.reset( new CppUT::PerfCounters() );
+         CppUT::PerfCounterValues counterValues;
+         std::vector<double> samples;
+         for ( unsigned int index = 0; index < benchmarkSettings.sampleCount_; ++index )
+         {
+            if ( counters.get() != 0 )
+               counters->start();
+            double duration;
+            if ( !measure( range, threadCount, iterationCount, &duration ) )
+               return false;
+            if ( counters.get() != 0 )
+               counterValues.add( counters->stop() );
+            samples.push_back( duration * 1e9 / double(iterationCount) );
+         }
+         statistics = CppUT::BenchmarkStatistics::compute( samples );
+         sampleCounters_ = Json::Value();
+         if ( counters.get() != 0 )
+            sampleCounters_ = counterValues.toJson( double(iterationCount) * benchmarkSettings.sampleCount_ );
+         return true;
+      }
+
+      void setBenchmarkStatistics( const CppUT::BenchmarkStatistics &statistics,
+                                   IterationCount iterationCount )
+      {
+         Json::Value result = statistics.toJson();
+         result["iterations"] = double(iterationCount);
+         result["ops_per_second"] = statistics.mean_ > 0 ? 1e9 / statistics.mean_ : 0.0;
+         if ( !sampleCounters_.isNull() )
+            result["counters_per_op"] = sampleCounters_;
+         CppUT::TestInfo::threadInstance().testStatus().setStatistics( "benchmark", result );
+      }
+
+      /// Returns the iteration count of a sample lasting about \a sampleTime.
+      IterationCount calibrate( unsigned int range,
+                                double sampleTime )
+      {
+         IterationCount iterationCount = 1;
+         for ( ;; )
+         {
+            double duration;
+            if ( !measure( range, 1, iterationCount, &duration ) )
+               return iterationCount;
+            if ( duration >= sampleTime )
+               return iterationCount;
+            // Grows quickly while the duration is too short to be reliable.
+            double factor = duration > sampleTime / 10 ? sampleTime * 1.2 / duration : 10;
+            IterationCount next = IterationCount( double(iterationCount) * factor );
+            iterationCount = CPPTL_MAX( next, iterationCount + 1 );
+         }
+      }
+
+      /// Runs a sample. @returns \c false if the benchmark failed.
+      bool measure( unsigned int range,
+                    unsigned int threadCount,
+                    IterationCount iterationCount,
+                    double *duration = 0 )
+      {
+#if CPPTL_HAS_THREAD
+         if ( threadCount > 1 )
+            return measureOnThreads( range, threadCount, iterationCount, duration );
+#endif
+         CppUT::BenchmarkState state( iterationCount, range );
+         double startTime = CppTL::Clock::monotonic();
+         definition_.run_( state );
+         if ( duration != 0 )
+         {
+            *duration = state.loopDuration();
+            if ( *duration <= 0 )
+               *duration = CppTL::Clock::monotonic() - startTime;
+         }
+         return !CppUT::TestInfo::threadInstance().testStatus().hasFailed();
+      }
+
+#if CPPTL_HAS_THREAD
+      /// Runs a sample on \a threadCount threads, the first one being the
+      /// current thread.
+      bool measureOnThreads( unsigned int range,
+                             unsigned int threadCount,
+                             IterationCount iterationCount,
+                             double *duration )
+      {
+         StartBarrier barrier( threadCount );
+         std::vector<BenchmarkThread *> benchmarkThreads;
+         std::vector<CppTL::Thread *> threads;
+         for ( unsigned int index = 1; index < threadCount; ++index )
+         {
+            BenchmarkThread *benchmarkThread = new BenchmarkThread( definition_.run_, barrier, 
+                                                                    iterationCount, range, 
+                                                                    index, threadCount );
+            CppTL::Thread *thread = new CppTL::Thread();
+            if ( !thread->start( CppTL::memfn0( benchmarkThread, &BenchmarkThread::run ) ) )
+            {
+               delete thread;
+               delete benchmarkThread;
+               barrier.leave();
+               continue;
+            }
+            benchmarkThreads.push_back( benchmarkThread );
+            threads.push_back( thread );
+         }
+
+         CppUT::BenchmarkState state( iterationCount, range, 0, threadCount );
+         barrier.arriveAndWait();
+         double startTime = CppTL::Clock::monotonic();
+         try
+         {
+            definition_.run_( state );
+         }
+         catch ( ... )
+         {
+            joinThreads( threads );
+            for ( std::vector<BenchmarkThread *>::iterator it = benchmarkThreads.begin(); 
+                  it != benchmarkThreads.end(); 
+                  ++it )
+               delete *it;
+            throw;
+         }
+         double stopTime = CppTL::Clock::monotonic();
+         if ( state.loopDuration() > 0 )
+         {
+            startTime = state.loopStartTime();
+            stopTime = startTime + state.loopDuration();
+         }
+         joinThreads( threads );
+
+         std::string failure;
+         const bool isComplete = benchmarkThreads.size() + 1 == threadCount;
+         for ( std::vector<BenchmarkThread *>::const_iterator it = benchmarkThreads.begin(); 
+               it != benchmarkThreads.end(); 
+               ++it )
+         {
+            startTime = CPPTL_MIN( startTime, (*it)->startTime_ );
+            stopTime = CPPTL_MAX( stopTime, (*it)->stopTime_ );
+            if ( failure.empty()  &&  !(*it)->failure_.empty() )
+            {
+               failure = "Benchmark failed on thread " 
+                         + std::string( CppTL::toString( (*it)->state_.threadIndex() ).c_str() )
+                         + ": " + (*it)->failure_;
+            }
+            delete *it;
+         }
+         if ( duration != 0 )
+            *duration = stopTime - startTime;
+         if ( !isComplete )
+            failure = "Failed to start the benchmark threads.";
+         if ( !failure.empty() )
+         {
+            CPPUT_CHECKING_FAIL( failure );
+            return false;
+         }
+         return !CppUT::TestInfo::threadInstance().testStatus().hasFailed();
+      }
+
+      static void joinThreads( std::vector<CppTL::Thread *> &threads )
+      {
+         for ( std::vector<CppTL::Thread *>::iterator it = threads.begin(); it != threads.end(); ++it )
+         {
+            (*it)->join();
+            delete *it;
+         }
+         threads.clear();
+      }
+#endif
+
+      BenchmarkDefinition definition_;
+      /// Events per operation counted by the last measureSamples() call.
+      Json::Value sampleCounters_;
+   };
+
+
+   /// Returns f(n) of the complexity.
+   double complexityOf( CppUT::BenchmarkComplexity complexity,
+                        double n )
+   {
+      switch ( complexity )
+      {
+      case CppUT::complexityLogarithmic:
+         return log( n ) / log( 2.0 );
+      case CppUT::complexityLinear:
+         return n;
+      case CppUT::complexityLinearithmic:
+         return n * log( n ) / log( 2.0 );
+      case CppUT::complexityQuadratic:
+         return n * n;
+      default:
+         return 1;
+      }
+   }
+
+} // end anonymous namespace
+
+
+namespace CppUT {
+
+// Class BenchmarkState
+// //////////////////////////////////////////////////////////////////
+
+BenchmarkState::BenchmarkState( IterationCount iterationCount,
+                                unsigned int range,
+                                unsigned int threadIndex,
+                                unsigned int threadCount )
+   : iterationCount_( iterationCount )
+   , remaining_( iterationCount )
+   , range_( range )
+   , threadIndex_( threadIndex )
+   , threadCount_( threadCount )
+   , startTime_( 0 )
+   , stopTime_( 0 )
+{
+}
+
+
+bool 
+BenchmarkState::startOrStop()
+{
+   if ( remaining_ == 0 )
+   {
+      if ( stopTime_ == 0 )
+         stopTime_ = CppTL::Clock::monotonic();
+      return false;
+   }
+   startTime_ = CppTL::Clock::monotonic();
+   --remaining_;
+   return true;
+}
+
+
+// Class BenchmarkSettings
+// //////////////////////////////////////////////////////////////////
+
+BenchmarkSettings::BenchmarkSettings()
+   : sampleTime_( 0.01 )
+   , warmUpTime_( 0.1 )
+   , sampleCount_( 20 )
+{
+}
+
+
+// Class BenchmarkStatistics
+// //////////////////////////////////////////////////////////////////
+
+BenchmarkStatistics::BenchmarkStatistics()
+   : outlierCount_( 0 )
+   , mean_( 0 )
+   , median_( 0 )
+   , p99_( 0 )
+   , min_( 0 )
+   , max_( 0 )
+   , standardDeviation_( 0 )
+{
+}
+
+
+BenchmarkStatistics
+BenchmarkStatistics::compute( const std::vector<double> &samples )
+{
+   BenchmarkStatistics statistics;
+   if ( samples.empty() )
+      return statistics;
+
+   std::vector<double> sorted( samples );
+   std::sort( sorted.begin(), sorted.end() );
+   const double q1 = quantile( sorted, 0.25 );
+   const double q3 = quantile( sorted, 0.75 );
+   const double lowerFence = q1 - 1.5 * (q3 - q1);
+   const double upperFence = q3 + 1.5 * (q3 - q1);
+   for ( std::vector<double>::const_iterator it = samples.begin(); it != samples.end(); ++it )
+   {
+      if ( *it < lowerFence  ||  *it > upperFence )
+         ++statistics.outlierCount_;
+      else
+         statistics.samples_.push_back( *it );
+   }
+
+   sorted = statistics.samples_;
+   std::sort( sorted.begin(), sorted.end() );
+   double total = 0;
+   for ( std::vector<double>::const_iterator it = sorted.begin(); it != sorted.end(); ++it )
+      total += *it;
+   statistics.mean_ = total / sorted.size();
+   double totalSquaredDeviation = 0;
+   for ( std::vector<double>::const_iterator it = sorted.begin(); it != sorted.end(); ++it )
+      totalSquaredDeviation += (*it - statistics.mean_) * (*it - statistics.mean_);
+   if ( sorted.size() > 1 )
+      statistics.standardDeviation_ = sqrt( totalSquaredDeviation / (sorted.size() - 1) );
+   statistics.median_ = quantile( sorted, 0.5 );
+   statistics.p99_ = quantile( sorted, 0.99 );
+   statistics.min_ = sorted.front();
+   statistics.max_ = sorted.back();
+   return statistics;
+}
+
+
+Json::Value
+BenchmarkStatistics::toJson() const
+{
+   Json::Value result( Json::objectValue );
+   result["mean_ns"] = mean_;
+   result["median_ns"] = median_;
+   result["p99_ns"] = p99_;
+   result["min_ns"] = min_;
+   result["max_ns"] = max_;
+   result["stddev_ns"] = standardDeviation_;
+   result["outliers"] = outlierCount_;
+   Json::Value &samples = result["samples_ns"];
+   samples = Json::Value( Json::arrayValue );
+   for ( std::vector<double>::const_iterator it = samples_.begin(); it != samples_.end(); ++it )
+      samples.append( *it );
+   return result;
+}
+
+
+// Class BenchmarkComparison
+// //////////////////////////////////////////////////////////////////
+
+BenchmarkComparison::BenchmarkComparison()
+   : baselineMedian_( 0 )
+   , median_( 0 )
+   , change_( 0 )
+   , pValue_( 1 )
+{
+}
+
+
+BenchmarkComparison
+BenchmarkComparison::compare( const std::vector<double> &baselineSamples,
+                              const std::vector<double> &samples )
+{
+   BenchmarkComparison comparison;
+   if ( baselineSamples.empty()  ||  samples.empty() )
+      return comparison;
+   comparison.baselineMedian_ = median( baselineSamples );
+   comparison.median_ = median( samples );
+   if ( comparison.baselineMedian_ > 0 )
+      comparison.change_ = comparison.median_ / comparison.baselineMedian_ - 1;
+
+   // Ranks both sets together, tied values getting the mean of their ranks.
+   typedef std::pair<double, bool> Value;   // (sample, is from baseline)
+   std::vector<Value> values;
+   for ( std::vector<double>::const_iterator it = baselineSamples.begin(); it != baselineSamples.end(); ++it )
+      values.push_back( Value( *it, true ) );
+   for ( std::vector<double>::const_iterator it = samples.begin(); it != samples.end(); ++it )
+      values.push_back( Value( *it, false ) );
+   std::sort( values.begin(), values.end() );
+   const double n1 = double( baselineSamples.size() );
+   const double n2 = double( samples.size() );
+   const double n = n1 + n2;
+   double baselineRankSum = 0;
+   double tieCorrection = 0;
+   for ( unsigned int start = 0; start < values.size(); )
+   {
+      unsigned int end = start + 1;
+      while ( end < values.size()  &&  values[end].first == values[start].first )
+         ++end;
+      const double rank = (start + 1 + end) / 2.0;
+      for ( unsigned int index = start; index < end; ++index )
+      {
+         if ( values[index].second )
+            baselineRankSum += rank;
+      }
+      const double tieCount = end - start;
+      tieCorrection += tieCount * tieCount * tieCount - tieCount;
+      start = end;
+   }
+
+   const double u = baselineRankSum - n1 * (n1 + 1) / 2;
+   const double meanU = n1 * n2 / 2;
+   const double varianceU = n1 * n2 / 12 * ((n + 1) - tieCorrection / (n * (n - 1)));
+   if ( varianceU <= 0 )
+      return comparison;   // all the samples are equal
+   double difference = fabs( u - meanU ) - 0.5;   // continuity correction
+   comparison.pValue_ = twoSidedNormalTail( CPPTL_MAX( difference, 0.0 ) / sqrt( varianceU ) );
+   return comparison;
+}
+
+
+// Class BenchmarkRange
+// //////////////////////////////////////////////////////////////////
+
+BenchmarkRange::BenchmarkRange( unsigned int first,
+                                unsigned int last,
+                                unsigned int multiplier )
+   : first_( first )
+   , last_( last )
+   , multiplier_( CPPTL_MAX( multiplier, 2u ) )
+{
+}
+
+
+bool 
+BenchmarkRange::isEmpty() const
+{
+   return first_ == 0  ||  last_ < first_;
+}
+
+
+std::vector<unsigned int> 
+BenchmarkRange::sizes() const
+{
+   std::vector<unsigned int> result;
+   if ( isEmpty() )
+      return result;
+   for ( CppTL::LargestUnsignedInt size = first_; size < last_; size *= multiplier_ )
+      result.push_back( (unsigned int)size );
+   result.push_back( last_ );
+   return result;
+}
+
+
+// Class BenchmarkComplexityFit
+// //////////////////////////////////////////////////////////////////
+
+const char *
+complexityName( BenchmarkComplexity complexity )
+{
+   switch ( complexity )
+   {
+   case complexityConstant:
+      return "O(1)";
+   case complexityLogarithmic:
+      return "O(log n)";
+   case complexityLinear:
+      return "O(n)";
+   case complexityLinearithmic:
+      return "O(n log n)";
+   case complexityQuadratic:
+      return "O(n^2)";
+   default:
+      return "unspecified";
+   }
+}
+
+
+BenchmarkComplexityFit::BenchmarkComplexityFit()
+   : complexity_( complexityUnspecified )
+   , coefficient_( 0 )
+   , rms_( 0 )
+{
+}
+
+
+BenchmarkComplexityFit 
+BenchmarkComplexityFit::compute( const std::vector<unsigned int> &sizes,
+                                 const std::vector<double> &durations )
+{
+   BenchmarkComplexityFit best;
+   for ( int complexity = complexityConstant; complexity < complexityUnspecified; ++complexity )
+   {
+      BenchmarkComplexityFit fit = compute( sizes, durations, BenchmarkComplexity(complexity) );
+      if ( best.complexity_ == complexityUnspecified  ||  fit.rms_ < best.rms_ )
+         best = fit;
+   }
+   return best;
+}
+
+
+BenchmarkComplexityFit 
+BenchmarkComplexityFit::compute( const std::vector<unsigned int> &sizes,
+                                 const std::vector<double> &durations,
+                                 BenchmarkComplexity complexity )
+{
+   BenchmarkComplexityFit fit;
+   fit.complexity_ = complexity;
+   const unsigned int count = CPPTL_MIN( sizes.size(), durations.size() );
+   double totalDuration = 0;
+   double durationByComplexity = 0;
+   double squaredComplexity = 0;
+   for ( unsigned int index = 0; index < count; ++index )
+   {
+      const double f = complexityOf( complexity, sizes[index] );
+      totalDuration += durations[index];
+      durationByComplexity += durations[index] * f;
+      squaredComplexity += f * f;
+   }
+   if ( squaredComplexity == 0  ||  totalDuration == 0 )
+      return fit;
+
+   fit.coefficient_ = durationByComplexity / squaredComplexity;
+   double squaredResiduals = 0;
+   for ( unsigned int index = 0; index < count; ++index )
+   {
+      const double residual = durations[index] 
+                              - fit.coefficient_ * complexityOf( complexity, sizes[index] );
+      squaredResiduals += residual * residual;
+   }
+   fit.rms_ = sqrt( squaredResiduals / count ) / (totalDuration / count);
+   return fit;
+}
+
+
+// Benchmark functions
+// //////////////////////////////////////////////////////////////////
+
+void
+setBenchmarkSettings( const BenchmarkSettings &benchmarkSettings )
+{
+   settings() = benchmarkSettings;
+}
+
+
+const BenchmarkSettings &
+benchmarkSettings()
+{
+   return settings();
+}
+
+
+TestMeta
+makeBenchmark( BenchmarkFn run,
+               const std::string &name )
+{
+   return makeBenchmark( run, MetaData( name ) );
+}
+
+
+TestMeta
+makeBenchmark( BenchmarkFn run,
+               const MetaData &metaData )
+{
+   return makeBenchmark( run, metaData, BenchmarkRange() );
+}
+
+
+TestMeta
+makeBenchmark( BenchmarkFn run,
+               const MetaData &metaData,
+               const BenchmarkRange &range,
+               BenchmarkComplexity expected )
+{
+   BenchmarkDefinition definition( run );
+   definition.range_ = range;
+   definition.expected_ = expected;
+   MetaData benchmarkData( metaData );
+   benchmarkData.addToGroup( "benchmark" );
+   return TestMeta( CppTL::bind_cfnr( &BenchmarkTestCase::factory, definition ), benchmarkData );
+}
+
+
+TestMeta
+makeThreadedBenchmark( BenchmarkFn run,
+                       const MetaData &metaData,
+                       unsigned int maxThreadCount )
+{
+   BenchmarkDefinition definition( run );
+   definition.isThreaded_ = true;
+   definition.maxThreadCount_ = maxThreadCount;
+   MetaData benchmarkData( metaData );
+   benchmarkData.addToGroup( "benchmark" );
+   return TestMeta( CppTL::bind_cfnr( &BenchmarkTestCase::factory, definition ), benchmarkData );
+}
+
+
+namespace Impl {
+
+/// Does nothing. As it is defined out of line, the compiler of the caller must
+/// assume that the pointed memory is read, without any shared state written by
+/// the concurrent callers.
+void
+escape( const void * )
+{
+}
+
+
+// Class BenchmarkRegisterer
+// //////////////////////////////////////////////////////////////////
+
+BenchmarkRegisterer::BenchmarkRegisterer( Suite suite,
+                                          const TestMeta &benchmark )
+{
+   suite.add( benchmark );
+}
+
+} // namespace Impl
+
+
+} // namespace CppUT
@@ -108,7 +108,7 @@ DependenciesData::DependenciesData(  const std::string &dependencies  )
 void 
 DependenciesData::apply( MetaData &test ) const
 {
-//   test.setDependenciesFromPackedString( dependencies );
+   test.setDependenciesFromPackedString( dependencies_ );
 }
 
 
@@ -126,6 +126,21 @@ GroupData::apply( MetaData &test ) const
    test.addToGroup( groupName_ );
 }
 
+
+// class ResourceData
+// //////////////////////////////////////////////////////////////////
+
+ResourceData::ResourceData( const std::string &resourceName )
+   : resourceName_( resourceName )
+{
+}
+
+void 
+ResourceData::apply( MetaData &test ) const
+{
+   test.requireResource( resourceName_ );
+}
+
 } // end namespace Impl
 
 
@@ -162,5 +177,11 @@ TestExtendedDataFactory::group( const std::string &groupName )
    return Impl::GroupData( groupName );
 }
 
+Impl::ResourceData 
+TestExtendedDataFactory::requireResource( const std::string &resourceName )
+{
+   return Impl::ResourceData( resourceName );
+}
+
 
 } // namespace CppUT
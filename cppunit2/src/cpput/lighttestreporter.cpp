@@ -0,0 +1,387 @@
+#include <cpput/lighttestreporter.h>
+#include <cpput/perfcounters.h>
+#include <cpptl/stringtools.h>
+
+namespace {
+
+   /// Formats the events counted by CppUT::PerfCounters, "12.3 cycles, 20.1
+   /// instructions (IPC 1.63), ..." for example.
+   std::string formatCounters( const Json::Value &counters )
+   {
+      std::string formatted;
+      for ( int counter = 0; counter < CppUT::perfCounterCount; ++counter )
+      {
+         const char *name = CppUT::perfCounterName( CppUT::PerfCounter(counter) );
+         if ( !counters.isMember( name ) )
+            continue;
+         char value[128];
+         sprintf( value, "%s%.3g %s", formatted.empty() ? "" : ", ", 
+                  counters[name].asDouble(), name );
+         formatted += value;
+         if ( counter == CppUT::perfInstructions  &&  counters.isMember( "ipc" ) )
+         {
+            sprintf( value, " (IPC %.2f)", counters["ipc"].asDouble() );
+            formatted += value;
+         }
+      }
+      // The statistics names use underscores.
+      for ( std::string::iterator it = formatted.begin(); it != formatted.end(); ++it )
+      {
+         if ( *it == '_' )
+            *it = ' ';
+      }
+      return formatted;
+   }
+
+} // end anonymous namespace
+
+
+namespace CppUT {
+
+// Class LightTestTimings
+// //////////////////////////////////////////////////////////////////
+
+std::string
+LightTestTimings::formatDuration( double seconds )
+{
+   char buffer[64];
+   if ( seconds < 1e-6 )
+      sprintf( buffer, "%.3gns", seconds * 1e9 );
+   else if ( seconds < 1e-3 )
+      sprintf( buffer, "%.3gus", seconds * 1e6 );
+   else if ( seconds < 1 )
+      sprintf( buffer, "%.3gms", seconds * 1e3 );
+   else
+      sprintf( buffer, "%.3gs", seconds );
+   return buffer;
+}
+
+
+double
+LightTestTimings::bucketUpperBound( unsigned int bucket )
+{
+   double bound = 1e-5;
+   for ( ; bucket > 0; --bucket )
+      bound *= 10;
+   return bound;
+}
+
+
+unsigned int
+LightTestTimings::bucketOf( double duration )
+{
+   unsigned int bucket = 0;
+   while ( bucket < histogramSize - 1  &&  duration >= bucketUpperBound( bucket ) )
+      ++bucket;
+   return bucket;
+}
+
+
+// Class LightTestReporter
+// //////////////////////////////////////////////////////////////////
+
+LightTestReporter::~LightTestReporter()
+{
+}
+
+
+void
+LightTestReporter::testStarting( const CppTL::ConstString & )
+{
+}
+
+
+void
+LightTestReporter::reportTimings( const LightTestTimings & )
+{
+}
+
+
+void
+LightTestReporter::reportBenchmarkDeltas( const LightBenchmarkDeltas & )
+{
+}
+
+
+// Class LightTextReporter
+// //////////////////////////////////////////////////////////////////
+
+LightTextReporter::LightTextReporter( FILE *output )
+   : output_( output )
+{
+   buffer_.reserve( bufferCapacity );
+}
+
+
+LightTextReporter::~LightTextReporter()
+{
+   flush();
+}
+
+
+void
+LightTextReporter::testStarting( const CppTL::ConstString &testPath )
+{
+   // Printed before running the test so that a crashing test can be identified.
+   write( "Testing " + std::string( testPath.c_str() ) + " : " );
+   flush();
+   startedTestPath_ = testPath;
+}
+
+
+void
+LightTextReporter::testCompleted( const CppTL::ConstString &testPath,
+                                  const TestStatus &testStatus,
+                                  const CppTL::ConstString &failureReport )
+{
+   if ( startedTestPath_ != testPath )
+      write( "Testing " + std::string( testPath.c_str() ) + " : " );
+   startedTestPath_ = CppTL::ConstString();
+
+   std::string status;
+   switch ( testStatus.status() )
+   {
+   case TestStatus::passed:
+      status = "OK";
+      break;
+   case TestStatus::skipped:
+      status = "SKIP";
+      break;
+   case TestStatus::failed:
+      status = "FAIL";
+      break;
+   default: status = "?"; break;
+   }
+
+   int assertionCount = testStatus.assertionCount();
+   status += " (";
+   unsigned int failedAssertionCount = testStatus.failedAssertionCount();
+   if ( failedAssertionCount > 0 )
+   {
+      std::string count = CppTL::toString( failedAssertionCount ).c_str();
+      status += count + (failedAssertionCount > 1 ? " assertions failed/"
+                                                    : " assertion failed/");
+   }
+
+   status += CppTL::toString( assertionCount ).c_str();
+   status += (assertionCount > 1 ? " assertions" : " assertion" );
+
+   if ( testStatus.ignoredFailureCount() > 0 )
+   {
+      std::string count = CppTL::toString( testStatus.ignoredFailureCount() ).c_str();
+      status += ", " + count + " ignored failures";
+   }
+   status += ")\n";
+
+   const Json::Value &benchmark = testStatus.statistics()["benchmark"];
+   if ( !benchmark.isNull() )
+   {
+      status += "  mean " + LightTestTimings::formatDuration( benchmark["mean_ns"].asDouble() * 1e-9 );
+      status += ", median " + LightTestTimings::formatDuration( benchmark["median_ns"].asDouble() * 1e-9 );
+      status += ", p99 " + LightTestTimings::formatDuration( benchmark["p99_ns"].asDouble() * 1e-9 );
+      char throughput[64];
+      sprintf( throughput, ", %.3g ops/s\n", benchmark["ops_per_second"].asDouble() );
+      status += throughput;
+      if ( benchmark.isMember( "counters_per_op" ) )
+         status += "  per op: " + formatCounters( benchmark["counters_per_op"] ) + "\n";
+   }
+
+   const Json::Value &counters = testStatus.statistics()["counters"];
+   if ( !counters.isNull()  &&  benchmark.isNull() )
+      status += "  " + formatCounters( counters ) + "\n";
+
+   const Json::Value &allocations = testStatus.statistics()["allocations"];
+   if ( !allocations.isNull() )
+   {
+      char line[256];
+      sprintf( line, "  %.0f allocations, %.0f bytes, peak %.0f bytes live\n",
+               allocations["count"].asDouble(), allocations["bytes"].asDouble(),
+               allocations["peak_bytes"].asDouble() );
+      status += line;
+   }
+
+   const Json::Value &sweep = testStatus.statistics()["sweep"];
+   if ( !sweep.isNull() )
+   {
+      const Json::Value &ranges = sweep["ranges"];
+      for ( unsigned int index = 0; index < ranges.size(); ++index )
+      {
+         char line[128];
+         sprintf( line, "  %10u: median %s\n", ranges[index].asUInt(),
+                  LightTestTimings::formatDuration( sweep["median_ns"][index].asDouble() * 1e-9 ).c_str() );
+         status += line;
+      }
+      char fit[256];
+      sprintf( fit, "  complexity %s, coefficient %s, rms %.1f%%",
+               sweep["complexity"].asString().c_str(),
+               LightTestTimings::formatDuration( sweep["coefficient_ns"].asDouble() * 1e-9 ).c_str(),
+               sweep["rms"].asDouble() * 100 );
+      status += fit;
+      if ( sweep.isMember( "expected" ) )
+         status += ", expected " + sweep["expected"].asString();
+      status += "\n";
+   }
+
+   const Json::Value &scaling = testStatus.statistics()["scaling"];
+   if ( !scaling.isNull() )
+   {
+      const Json::Value &threads = scaling["threads"];
+      for ( unsigned int index = 0; index < threads.size(); ++index )
+      {
+         char line[128];
+         sprintf( line, "  %4u threads: %.3g ops/s, efficiency %.0f%%\n", threads[index].asUInt(),
+                  scaling["ops_per_second"][index].asDouble(), 
+                  scaling["efficiency"][index].asDouble() * 100 );
+         status += line;
+      }
+   }
+
+   write( status );
+   write( failureReport.c_str(), failureReport.length() );
+   flush();
+}
+
+
+void
+LightTextReporter::reportTimings( const LightTestTimings &timings )
+{
+   static const char *phases[] = { "setUp", "run", "tearDown", "destruction" };
+   write( "Slowest tests:\n" );
+   LightTestTimings::SlowTests::const_iterator it = timings.slowest_.begin();
+   for ( ; it != timings.slowest_.end(); ++it )
+   {
+      write( "  " + LightTestTimings::formatDuration( it->duration_ ) + "  " + it->path_.c_str() + "\n" );
+      std::string details;
+      for ( unsigned int index = 0; index < sizeof(phases)/sizeof(phases[0]); ++index )
+      {
+         const Json::Value &times = it->timing_[ phases[index] ];
+         if ( times.isNull() )
+            continue;
+         details += details.empty() ? "    " : ", ";
+         details += std::string( phases[index] ) + " " + LightTestTimings::formatDuration( times["wall"].asDouble() );
+         details += " (cpu " + LightTestTimings::formatDuration( times["cpu"].asDouble() ) + ")";
+      }
+      if ( !details.empty() )
+         write( details + "\n" );
+   }
+
+   write( "Duration histogram:\n" );
+   unsigned int maxCount = 1;
+   for ( unsigned int bucket = 0; bucket < timings.histogram_.size(); ++bucket )
+      maxCount = CPPTL_MAX( maxCount, timings.histogram_[bucket] );
+   const unsigned int barWidth = 40;
+   for ( unsigned int bucket = 0; bucket < timings.histogram_.size(); ++bucket )
+   {
+      unsigned int count = timings.histogram_[bucket];
+      std::string label;
+      if ( bucket + 1 < timings.histogram_.size() )
+         label = "< " + LightTestTimings::formatDuration( LightTestTimings::bucketUpperBound( bucket ) );
+      else
+         label = ">= " + LightTestTimings::formatDuration( LightTestTimings::bucketUpperBound( bucket - 1 ) );
+      char line[128];
+      sprintf( line, "  %8s |", label.c_str() );
+      write( line );
+      unsigned int barLength = (count * barWidth + maxCount - 1) / maxCount;
+      write( std::string( barLength, '#' ) + std::string( barWidth - barLength, ' ' ) );
+      sprintf( line, "| %u\n", count );
+      write( line );
+   }
+   flush();
+}
+
+
+void
+LightTextReporter::reportBenchmarkDeltas( const LightBenchmarkDeltas &deltas )
+{
+   write( "Benchmarks compared to baseline (median per operation):\n" );
+   char header[256];
+   sprintf( header, "  %-12s %-12s %8s  %-9s %s\n", "baseline", "current", "change", "p-value", "benchmark" );
+   write( header );
+   for ( LightBenchmarkDeltas::const_iterator it = deltas.begin(); it != deltas.end(); ++it )
+   {
+      const BenchmarkComparison &comparison = it->comparison_;
+      char line[256];
+      sprintf( line, "  %-12s %-12s %+7.1f%%  %-9.2g %s%s\n",
+               LightTestTimings::formatDuration( comparison.baselineMedian_ * 1e-9 ).c_str(),
+               LightTestTimings::formatDuration( comparison.median_ * 1e-9 ).c_str(),
+               comparison.change_ * 100,
+               comparison.pValue_,
+               it->isRegression_ ? "REGRESSED " : "",
+               it->path_.c_str() );
+      write( line );
+   }
+   flush();
+}
+
+
+void
+LightTextReporter::runCompleted( const LightTestSummary &summary )
+{
+   char line[256];
+   if ( summary.testFailed_ > 0 )
+   {
+      sprintf( line, "%u/%u tests passed, %u tests failed",
+               summary.testRun_ - summary.testFailed_,
+               summary.testRun_,
+               summary.testFailed_ );
+   }
+   else
+   {
+      sprintf( line, "All %u tests passed", summary.testRun_ );
+   }
+   write( line );
+
+   if ( summary.ignoredFailureCount_ > 0 )
+   {
+      sprintf( line, ", %u ignored failures", summary.ignoredFailureCount_ );
+      write( line );
+   }
+   sprintf( line, " (%u %s).\n",
+            summary.assertionCount_,
+            summary.assertionCount_ > 1 ? "assertions" : "assertion" );
+   write( line );
+   if ( summary.testNotRun_ > 0 )
+   {
+      sprintf( line, "Stopped after the first failure, %u tests not run.\n",
+               summary.testNotRun_ );
+      write( line );
+   }
+   flush();
+}
+
+
+void
+LightTextReporter::write( const char *text, 
+                          size_t length )
+{
+   if ( buffer_.length() + length > bufferCapacity )
+   {
+      flush();
+      if ( length > bufferCapacity )
+      {
+         fwrite( text, 1, length, output_ );
+         return;
+      }
+   }
+   buffer_.append( text, length );
+}
+
+
+void
+LightTextReporter::write( const std::string &text )
+{
+   write( text.c_str(), text.length() );
+}
+
+
+void
+LightTextReporter::flush()
+{
+   if ( !buffer_.empty() )
+      fwrite( buffer_.c_str(), 1, buffer_.length(), output_ );
+   buffer_.erase();
+   fflush( output_ );
+}
+
+
+} // namespace CppUT
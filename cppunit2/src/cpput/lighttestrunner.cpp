@@ -1,8 +1,39 @@
 #include <cpput/lighttestrunner.h>
+#include <cpput/allocationtracker.h>
+#include <cpput/benchmark.h>
+#include <cpput/perfcounters.h>
+#include <cpput/resource.h>
 #include <cpput/testing.h>
+#include <cpptl/clock.h>
+#include <cpptl/scopedptr.h>
 #include <cpptl/sharedptr.h>
 #include <cpptl/stringtools.h>
+#include <cpptl/thread.h>
+#include <cpptl/workqueue.h>
+#include <json/reader.h>
+#include <json/writer.h>
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <set>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if CPPUT_HAS_FORK
+# include <errno.h>
+# include <poll.h>
+# include <signal.h>
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <unistd.h>
+#endif
+#if CPPUT_HAS_FORK  &&  defined(__GLIBC__)  &&  !defined(CPPUT_NO_BACKTRACE)
+# define CPPUT_HAS_BACKTRACE 1
+# include <execinfo.h>
+# if CPPTL_HAS_THREAD
+#  include <pthread.h>
+# endif
+#endif
 
 namespace {
    class Reindenter
@@ -39,296 +70,2822 @@ namespace {
       CppTL::StringBuffer &text_;
       CppTL::StringBuffer::size_type pos_;
    };
+
+
+   void
+   reportFailureDetail( CppTL::StringBuffer &report,
+                        const Json::Value &detail,
+                        int nestingLevel = 0 )
+   {
+      Reindenter reindenter( report );
+      // Predicate name if any
+      if ( !detail["name"].isNull() )
+      {
+         report += "predicate: " + detail["name"].asString() + "\n";
+      }
+      // Get assertion messages
+      const Json::Value &messages = detail["message"];
+      const int nbMessage = messages.size();
+      if ( nbMessage > 0 )
+      {
+         report += nbMessage > 1 ? "Messages:\n"
+                                 : "Message: ";
+         for ( int index = 0; index < nbMessage; ++index )
+            report += messages[index].asString() + "\n";
+      }
+      // Compute max data name length
+      const Json::Value &data = detail["data"];
+      int nbDetailData = data.size();
+      int maxNameLength = 0;
+      for ( int indexLength = 0; indexLength < nbDetailData; ++indexLength )
+      {
+         const int length = data[indexLength]["name"].asString().size();
+         maxNameLength = CPPTL_MAX( maxNameLength, length );
+      }
+      // Aligned result data values
+      for ( int index = 0; index < nbDetailData; ++index )
+      {
+         std::string name = data[index]["name"].asString();
+         report += name;
+         report += std::string( maxNameLength - name.size(), ' ');
+         report += ": ";
+         // @todo nice conversion to string
+         report += data[index]["value"].toStyledString();
+         if ( report[report.length()-1] != '\n' )
+            report += "\n";
+      }
+      // Reports composite assertions
+      const Json::Value &composites = detail["composite"];
+      const Json::Value::UInt nbComposite = composites.size();
+      for ( Json::Value::UInt indexComposite = 0; indexComposite < nbComposite; ++indexComposite )
+      {
+         const Json::Value &composite = composites[indexComposite];
+         CPPTL_ASSERT_MESSAGE( composite.size() == 1, "Composite must have a name" );
+         const char *compositeName = composite.begin().memberName();
+         const Json::Value &compositeDetail = *(composite.begin());
+         report += "context: ";
+         report += compositeName;
+         report += "\n";
+         reportFailureDetail( report, compositeDetail, nestingLevel + 1 );
+      }
+      if ( nestingLevel > 0 )
+      {
+         reindenter.apply( std::string( 2, ' ' ) );
+      }
+   }
+
+
+   /// Returns \c true if the failure was an ignored failure.
+   bool
+   reportFailure( CppTL::StringBuffer &report,
+                  const CppUT::Assertion &failure )
+   { // @todo duplicated in Assertion::toString().
+      if ( failure.location().isValid() )
+      {
+         report += failure.location().file_;
+         report += "(" + CppTL::toString( failure.location().line_ ) + ") : ";
+      }
+      else
+         report += "unknwon failure location : ";
+
+      CppTL::ConstString failureType = failure.kind() == CppUT::Assertion::fault ? "fault"
+                                                                                 : "assertion";
+      if ( failure.isIgnoredFailure() )
+      {
+         failureType = "*ignored* " + failureType;
+      }
+      report += "[failure type: " + failureType + "]\n";
+      reportFailureDetail( report, failure.detail() );
+      report += "\n";
+      return failure.isIgnoredFailure();
+   }
+
+
+   void
+   reportLog( CppTL::StringBuffer &report,
+              const Json::Value &log )
+   {
+      report += "Log:\n";
+      if ( log.isConvertibleTo( Json::stringValue ) )
+         report += log.asString();
+      else
+         report += log.toStyledString();
+      if ( report[ report.length() -1 ] != '\n' )
+         report += "\n\n";
+   }
+
+
+   /// Returns \c true if arg starts with the option name and extracts its value.
+   bool
+   getOptionValue( const char *arg,
+                   const char *optionName,
+                   const char *&value )
+   {
+      size_t length = strlen( optionName );
+      if ( strncmp( arg, optionName, length ) != 0 )
+         return false;
+      value = arg + length;
+      return true;
+   }
+
+
+   bool
+   parseUnsigned( const char *text,
+                  unsigned int &value )
+   {
+      char *end = 0;
+      long parsed = strtol( text, &end, 10 );
+      if ( end == text  ||  *end != 0  ||  parsed < 0 )
+         return false;
+      value = (unsigned int)parsed;
+      return true;
+   }
+
+
+   bool
+   parseSeconds( const char *text,
+                 double &value )
+   {
+      char *end = 0;
+      double parsed = strtod( text, &end );
+      if ( end == text  ||  *end != 0  ||  parsed < 0 )
+         return false;
+      value = parsed;
+      return true;
+   }
+
+
+   /// Returns \c false if the file could not be read or is not a valid JSON document.
+   bool
+   readJsonFile( const std::string &path,
+                 Json::Value &root )
+   {
+      FILE *file = fopen( path.c_str(), "rb" );
+      if ( !file )
+         return false;
+      std::string text;
+      char buffer[4096];
+      size_t readCount;
+      while ( (readCount = fread( buffer, 1, sizeof(buffer), file )) > 0 )
+         text.append( buffer, readCount );
+      fclose( file );
+      Json::Reader reader;
+      return reader.parse( text, root, false );
+   }
+
+
+   bool
+   writeJsonFile( const std::string &path,
+                  const Json::Value &root )
+   {
+      FILE *file = fopen( path.c_str(), "wb" );
+      if ( !file )
+         return false;
+      std::string text = Json::StyledWriter().write( root );
+      bool written = fwrite( text.c_str(), 1, text.length(), file ) == text.length();
+      return fclose( file ) == 0  &&  written;
+   }
+
+
+   /// A test with its predicted duration, ordered longest first.
+   struct TestCost
+   {
+      double duration_;
+      CppTL::ConstString path_;
+      unsigned int index_;
+
+      bool operator <( const TestCost &other ) const
+      {
+         if ( duration_ != other.duration_ )
+            return duration_ > other.duration_;
+         return path_ < other.path_;
+      }
+   };
+
+
+   /// Period of the watchdog checking the time-out of worker threads, in milliseconds.
+   const unsigned int watchdogPeriod = 10;
+
+
+#if CPPUT_HAS_BACKTRACE
+   /// Signal sent to a timed out thread or process to dump its backtrace.
+   const int backtraceSignal = SIGUSR2;
+
+   /// Time given to a timed out test to dump its backtrace, in milliseconds.
+   const int backtraceDelay = 200;
+
+   extern "C" void 
+   cpputDumpBacktraceHandler( int )
+   {
+      void *frames[64];
+      int frameCount = backtrace( frames, 64 );
+      backtrace_symbols_fd( frames, frameCount, 2 );
+   }
+
+
+   void
+   installBacktraceHandler()
+   {
+      // backtrace() loads libgcc on first use, which is not safe in a signal handler.
+      void *frame;
+      backtrace( &frame, 1 );
+      struct sigaction action;
+      memset( &action, 0, sizeof(action) );
+      action.sa_handler = &cpputDumpBacktraceHandler;
+      sigemptyset( &action.sa_mask );
+      action.sa_flags = SA_RESTART;
+      sigaction( backtraceSignal, &action, 0 );
+   }
+#endif // #if CPPUT_HAS_BACKTRACE
+
 } // end anonymous namespace
 
-namespace CppUT {
+namespace CppUT {
+
+
+// Class LightTestRunner::ResultCollector
+// //////////////////////////////////////////////////////////////////
+
+/* Captures the assertions and logs of the test running in a given thread.
+ * One instance exists per thread running tests.
+ */
+class LightTestRunner::ResultCollector : public TestResultUpdater
+{
+public:
+   void startTest()
+   {
+      assertions_.clear();
+      logs_.clear();
+      results_.clear();
+   }
+
+   /// Appends the failure report of the last test to \c report.
+   /// @returns Number of ignored failures reported.
+   unsigned int formatReport( const CppTL::ConstString &testPath,
+                              CppTL::StringBuffer &report ) const
+   {
+      unsigned int ignoredFailureCount = 0;
+      if ( assertions_.empty() )
+         return ignoredFailureCount;
+
+      CppTL::ConstString resultType = assertions_.back().kind() == Assertion::fault ? "fault"
+                                                                                    : "assertion";
+      report += "-> " + testPath + " : " + resultType + "\n";
+      ResultElements::const_iterator it = results_.begin();
+      for ( ; it != results_.end(); ++it )
+      {
+         const ResultElement &result = *it;
+         if ( result.isLog_ )
+            reportLog( report, logs_[result.index_] );
+         else if ( reportFailure( report, assertions_[ result.index_ ] ) )
+            ++ignoredFailureCount;
+      }
+      report += "\n";
+      return ignoredFailureCount;
+   }
+
+public: // overridden from TestResultUpdater
+   virtual void addResultLog( const Json::Value &log )
+   {
+      ResultElement element;
+      element.isLog_ = true;
+      element.index_ = int(logs_.size());
+      results_.push_back( element );
+      logs_.push_back( log );
+   }
+
+   virtual void addResultAssertion( const Assertion &assertion )
+   {
+      ResultElement element;
+      element.isLog_ = false;
+      element.index_ = int(assertions_.size());
+      results_.push_back( element );
+      assertions_.push_back( assertion );
+   }
+
+private:
+   struct ResultElement
+   {
+      int index_;
+      bool isLog_;
+   };
+
+   typedef std::deque<Json::Value> Logs;
+   Logs logs_;
+   typedef std::deque<Assertion> Assertions;
+   Assertions assertions_;
+   typedef std::deque<ResultElement> ResultElements;
+   ResultElements results_;
+};
+
+
+// Class LightTestRunner::RepeatedTest
+// //////////////////////////////////////////////////////////////////
+
+/* Runs a test several times in a row, possibly in several threads at the same
+ * time, and aggregates the outcomes of the runs into a single TestResult (see
+ * setRepeatCount() and setConcurrentCopies()).
+ *
+ * Each copy of the test runs in its own thread with its own TestInfo and
+ * ResultCollector, and TestMeta::runTest() creates a new TestCase for each run.
+ * The failure report of the first failed run is kept.
+ */
+class LightTestRunner::RepeatedTest
+{
+public:
+   RepeatedTest( const PlannedTest &planned,
+                 const RepeatSettings &settings )
+      : planned_( planned )
+      , settings_( settings )
+      , runCount_( 0 )
+      , failedCount_( 0 )
+      , skippedCount_( 0 )
+      , ignoredFailureCount_( 0 )
+      , minDuration_( 0 )
+      , maxDuration_( 0 )
+      , totalDuration_( 0 )
+      , totalSquaredDuration_( 0 )
+   {
+   }
+
+   void run( ResultCollector &collector,
+             TestResult &result )
+   {
+      // The test plan only reserved the resources of a single run.
+      for ( unsigned int copy = 1; copy < settings_.copyCount_; ++copy )
+         reserveResources();
+#if CPPTL_HAS_THREAD
+      std::vector<CppTL::Thread *> threads;
+      for ( unsigned int copy = 1; copy < settings_.copyCount_; ++copy )
+      {
+         CppTL::Thread *thread = new CppTL::Thread();
+         if ( !thread->start( CppTL::memfn0( this, &RepeatedTest::runCopyInThread ) ) )
+         {
+            delete thread;
+            cancelReservedResources();
+            continue;
+         }
+         threads.push_back( thread );
+      }
+#endif
+      runCopy( collector );
+#if CPPTL_HAS_THREAD
+      for ( std::vector<CppTL::Thread *>::iterator it = threads.begin(); it != threads.end(); ++it )
+      {
+         if ( (*it)->join() )
+            delete *it;
+         else
+            fprintf( stderr, "Failed to join a thread running a copy of %s.\n", planned_.path_.c_str() );
+      }
+#endif
+      makeResult( result );
+   }
+
+private:
+   void runCopyInThread()
+   {
+      ResultCollector collector;
+      runCopy( collector );
+   }
+
+   void runCopy( ResultCollector &collector )
+   {
+      TestInfo &testInfo = TestInfo::threadInstance();
+      testInfo.setTestResultUpdater( collector );
+      // The resources of the first run of the copy are already reserved.
+      bool isReserved = true;
+      for ( unsigned int run = 0; settings_.repeatCount_ == 0  ||  run < settings_.repeatCount_; ++run )
+      {
+         if ( settings_.untilFailure_  &&  hasFailed() )
+            break;
+         if ( !isReserved )
+            reserveResources();
+         isReserved = false;
+         collector.startTest();
+         double startTime = CppTL::Clock::monotonic();
+         planned_.test_->runTest();
+         recordRun( testInfo.testStatus(), CppTL::Clock::monotonic() - startTime, collector );
+      }
+      if ( isReserved )
+         cancelReservedResources();
+      testInfo.removeTestResultUpdater();
+   }
+
+   bool hasFailed() const
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      return failedCount_ > 0;
+   }
+
+   void recordRun( const TestStatus &status,
+                   double duration,
+                   const ResultCollector &collector )
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      if ( runCount_ == 0 )
+      {
+         status_ = status;
+         minDuration_ = duration;
+         maxDuration_ = duration;
+      }
+      ++runCount_;
+      minDuration_ = CPPTL_MIN( minDuration_, duration );
+      maxDuration_ = CPPTL_MAX( maxDuration_, duration );
+      totalDuration_ += duration;
+      totalSquaredDuration_ += duration * duration;
+      if ( status.hasFailed() )
+      {
+         if ( ++failedCount_ == 1 )
+         {
+            status_ = status;
+            ignoredFailureCount_ = collector.formatReport( planned_.path_, report_ );
+         }
+      }
+      else if ( status.wasSkipped() )
+         ++skippedCount_;
+   }
+
+   void makeResult( TestResult &result )
+   {
+      const double meanDuration = runCount_ > 0 ? totalDuration_ / runCount_ : 0;
+      const double variance = runCount_ > 0 ? totalSquaredDuration_ / runCount_ - meanDuration * meanDuration 
+                                            : 0;
+      const double deviation = sqrt( CPPTL_MAX( variance, 0.0 ) );
+      Json::Value statistics( Json::objectValue );
+      statistics["runs"] = runCount_;
+      statistics["failed"] = failedCount_;
+      statistics["skipped"] = skippedCount_;
+      statistics["min"] = minDuration_;
+      statistics["max"] = maxDuration_;
+      statistics["mean"] = meanDuration;
+      statistics["stddev"] = deviation;
+
+      result.status_ = status_;
+      result.status_.setStatistics( "duration", meanDuration );
+      result.status_.setStatistics( "repeat", statistics );
+      result.ignoredFailureCount_ = ignoredFailureCount_;
+
+      CppTL::StringBuffer report;
+      report += report_;
+      report += "-> " + planned_.path_ + " : ";
+      report += CppTL::toString( runCount_ ) + " runs";
+      if ( settings_.copyCount_ > 1 )
+         report += " on " + CppTL::toString( settings_.copyCount_ ) + " threads";
+      report += ", " + CppTL::toString( runCount_ - failedCount_ - skippedCount_ ) + " passed";
+      report += ", " + CppTL::toString( failedCount_ ) + " failed";
+      if ( skippedCount_ > 0 )
+         report += ", " + CppTL::toString( skippedCount_ ) + " skipped";
+      report += "\nDuration: min " + LightTestTimings::formatDuration( minDuration_ );
+      report += ", mean " + LightTestTimings::formatDuration( meanDuration );
+      report += ", max " + LightTestTimings::formatDuration( maxDuration_ );
+      report += ", stddev " + LightTestTimings::formatDuration( deviation ) + "\n\n";
+      result.report_ = report;
+   }
+
+   void reserveResources()
+   {
+      const TestMeta &test = *planned_.test_;
+      for ( int resource = 0; resource < test.resourceCount(); ++resource )
+         ResourceRegistry::reserve( test.resourceAt( resource ) );
+   }
+
+   void cancelReservedResources()
+   {
+      const TestMeta &test = *planned_.test_;
+      for ( int resource = 0; resource < test.resourceCount(); ++resource )
+         ResourceRegistry::cancelReservation( test.resourceAt( resource ) );
+   }
+
+   const PlannedTest &planned_;
+   const RepeatSettings settings_;
+   mutable CppTL::Mutex lock_;
+   TestStatus status_;
+   CppTL::StringBuffer report_;
+   unsigned int runCount_;
+   unsigned int failedCount_;
+   unsigned int skippedCount_;
+   unsigned int ignoredFailureCount_;
+   double minDuration_;
+   double maxDuration_;
+   double totalDuration_;
+   double totalSquaredDuration_;
+};
+
+
+// Class LightTestRunner::Worker
+// //////////////////////////////////////////////////////////////////
+
+#if CPPTL_HAS_THREAD
+/* A worker thread of the parallel mode.
+ * Each worker runs the tests of its own queue, then steals tests from the
+ * queues of the other workers until all queues are empty. Since TestInfo
+ * is per thread, each worker has its own TestInfo and ResultCollector.
+ *
+ * A worker running a test for longer than its time-out is abandoned by the
+ * watchdog: the result of the test is discarded and the thread exits as soon
+ * as the test returns, without touching the runner which may be gone by then.
+ */
+class LightTestRunner::Worker : public CppTL::NonCopyable
+{
+public:
+   typedef std::vector<Worker *> Workers;
+   typedef CppTL::WorkStealingQueue<PlanIndex> Queue;
+   typedef std::vector<Queue *> Queues;
+
+   Worker( LightTestRunner &runner,
+           Queues &queues,
+           unsigned int queueIndex )
+      : runner_( runner )
+      , queues_( queues )
+      , queueIndex_( queueIndex )
+      , currentTest_( 0 )
+      , deadline_( 0 )
+      , isRunning_( false )
+      , isAbandoned_( false )
+      , isFinished_( false )
+   {
+   }
+
+   bool start()
+   {
+      return thread_.start( CppTL::memfn0( this, &Worker::run ) );
+   }
+
+   bool join()
+   {
+      return thread_.join();
+   }
+
+   bool isFinished() const
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      return isFinished_;
+   }
+
+   /// Abandons the worker if its running test has exceeded its time-out.
+   /// @param index [out] Plan index of the timed out test.
+   /// @returns \c true if the worker was abandoned.
+   bool abandonIfTimedOut( double now,
+                           PlanIndex &index )
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      if ( !isRunning_  ||  deadline_ <= 0  ||  now < deadline_ )
+         return false;
+      isAbandoned_ = true;
+      index = currentTest_;
+      return true;
+   }
+
+# if CPPUT_HAS_BACKTRACE
+   void dumpBacktrace()
+   {
+      pthread_kill( threadId_, backtraceSignal );
+   }
+# endif
+
+private:
+   void run()
+   {
+# if CPPUT_HAS_BACKTRACE
+      threadId_ = pthread_self();
+# endif
+      PlanIndex index;
+      while ( nextTest( index ) )
+      {
+         if ( !runTest( index ) )
+            return;
+      }
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      isFinished_ = true;
+   }
+
+   /// @returns \c false if the worker was abandoned while running the test.
+   bool runTest( PlanIndex index )
+   {
+      PlannedTest planned = runner_.plan_[index];
+      double timeOut = runner_.timeOutOf( index );
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         currentTest_ = index;
+         deadline_ = timeOut > 0 ? CppTL::Clock::monotonic() + timeOut : 0;
+         isRunning_ = true;
+      }
+      TestResult result;
+      LightTestRunner::runTest( planned, runner_.repeat_, collector_, result );
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      if ( isAbandoned_ )
+         return false;
+      isRunning_ = false;
+      runner_.testCompleted( index, result );
+      return true;
+   }
+
+   bool nextTest( PlanIndex &index )
+   {
+      for ( ;; )
+      {
+         if ( runner_.isStopRequested() )
+            return false;
+         // Tests whose prerequisites just passed are started first.
+         if ( runner_.takeReadyTest( index ) )
+            return true;
+         if ( queues_[queueIndex_]->pop( index ) )
+            return true;
+         const unsigned int queueCount = (unsigned int)queues_.size();
+         for ( unsigned int offset = 1; offset < queueCount; ++offset )
+         {
+            Queue &victim = *queues_[ (queueIndex_ + offset) % queueCount ];
+            if ( victim.steal( index ) )
+               return true;
+         }
+         if ( !runner_.hasBlockedTests() )
+            return false;
+         // Waits for the prerequisites run by the other workers.
+         CppTL::Thread::sleep( 1 );
+      }
+   }
+
+   LightTestRunner &runner_;
+   Queues &queues_;
+   ResultCollector collector_;
+   CppTL::Thread thread_;
+   mutable CppTL::Mutex lock_;
+   unsigned int queueIndex_;
+   PlanIndex currentTest_;
+   double deadline_;
+   bool isRunning_;
+   bool isAbandoned_;
+   bool isFinished_;
+# if CPPUT_HAS_BACKTRACE
+   pthread_t threadId_;
+# endif
+};
+#endif // #if CPPTL_HAS_THREAD
+
+
+// Class LightTestRunner::ProcessWorker
+// //////////////////////////////////////////////////////////////////
+
+#if CPPUT_HAS_FORK
+/* A worker process of the process isolation mode.
+ * The parent sends the plan index of the test to run as a line of text on the
+ * command pipe. The child runs the test and sends back its result as a single
+ * line JSON document on the result pipe. The death of the child while running a
+ * test is detected by the end of file on the result pipe.
+ */
+class LightTestRunner::ProcessWorker : public CppTL::NonCopyable
+{
+public:
+   typedef std::vector<ProcessWorker *> Workers;
+
+   ProcessWorker( LightTestRunner &runner )
+      : runner_( runner )
+      , pid_( -1 )
+      , commandFd_( -1 )
+      , resultFd_( -1 )
+      , currentTest_( 0 )
+      , resourceGroup_( 0 )
+      , deadline_( 0 )
+      , isBusy_( false )
+   {
+   }
+
+   ~ProcessWorker()
+   {
+      shutdown();
+   }
+
+   /// Forks the worker process.
+   /// @param workers All the workers. The child closes the pipes of the other workers.
+   bool spawn( const Workers &workers )
+   {
+      int commandPipe[2];
+      int resultPipe[2];
+      if ( pipe( commandPipe ) != 0 )
+         return false;
+      if ( pipe( resultPipe ) != 0 )
+      {
+         close( commandPipe[0] );
+         close( commandPipe[1] );
+         return false;
+      }
+      pid_t pid = fork();
+      if ( pid < 0 )
+      {
+         close( commandPipe[0] );
+         close( commandPipe[1] );
+         close( resultPipe[0] );
+         close( resultPipe[1] );
+         return false;
+      }
+      if ( pid == 0 )
+      {
+         for ( Workers::const_iterator it = workers.begin(); it != workers.end(); ++it )
+            (*it)->closePipes();
+         close( commandPipe[1] );
+         close( resultPipe[0] );
+         runChild( commandPipe[0], resultPipe[1] );
+      }
+      close( commandPipe[0] );
+      close( resultPipe[1] );
+      pid_ = pid;
+      commandFd_ = commandPipe[1];
+      resultFd_ = resultPipe[0];
+      pending_.erase();
+      isBusy_ = false;
+      resourceGroup_ = 0;
+      return true;
+   }
+
+   bool isAlive() const
+   {
+      return pid_ > 0;
+   }
+
+   bool isIdle() const
+   {
+      return isAlive()  &&  !isBusy_;
+   }
+
+   bool isBusy() const
+   {
+      return isBusy_;
+   }
+
+   int resultFd() const
+   {
+      return resultFd_;
+   }
+
+   /// Returns the resources required by the last test sent to the worker process.
+   /// They are likely still alive in the worker process.
+   unsigned int resourceGroup() const
+   {
+      return resourceGroup_;
+   }
+
+   /// Sends the test to run to the worker process.
+   /// @returns \c false if the worker process died.
+   bool sendTest( PlanIndex index )
+   {
+      std::string command = CppTL::toString( index ).c_str();
+      command += "\n";
+      if ( !writeAll( commandFd_, command ) )
+      {
+         handleDeath();
+         return false;
+      }
+      currentTest_ = index;
+      resourceGroup_ = runner_.resourceGroups_[index];
+      double timeOut = runner_.timeOutOf( index );
+      deadline_ = timeOut > 0 ? CppTL::Clock::monotonic() + timeOut : 0;
+      isBusy_ = true;
+      return true;
+   }
+
+   /// Returns the time remaining before the running test times out, in milliseconds.
+   /// @returns -1 if no test is running or the test has no time-out.
+   int remainingTime( double now ) const
+   {
+      if ( !isBusy_  ||  deadline_ <= 0 )
+         return -1;
+      if ( now >= deadline_ )
+         return 0;
+      return int( (deadline_ - now) * 1000 ) + 1;
+   }
+
+   /// Kills the worker process if its running test has exceeded its time-out,
+   /// and reports the test as a fault.
+   /// @returns Number of tests completed (1 if the test timed out, 0 otherwise).
+   unsigned int killIfTimedOut( double now )
+   {
+      if ( remainingTime( now ) != 0 )
+         return 0;
+# if CPPUT_HAS_BACKTRACE
+      if ( runner_.dumpBacktrace_ )
+      {
+         fprintf( stderr, "Backtrace of timed out test %s:\n",
+                  runner_.plan_[currentTest_].path_.c_str() );
+         fflush( stderr );
+         kill( pid_, backtraceSignal );
+         poll( 0, 0, backtraceDelay );
+      }
+# endif
+      kill( pid_, SIGKILL );
+      closePipes();
+      while ( waitpid( pid_, 0, 0 ) < 0  &&  errno == EINTR )
+         ;
+      pid_ = -1;
+      isBusy_ = false;
+      runner_.recordTimeOut( currentTest_ );
+      return 1;
+   }
+
+   /// Reads the results sent by the worker process.
+   /// isAlive() returns \c false after this call if the worker process died.
+   /// @returns Number of tests completed.
+   unsigned int readResults()
+   {
+      char buffer[4096];
+      ssize_t readCount = read( resultFd_, buffer, sizeof(buffer) );
+      if ( readCount < 0  &&  errno == EINTR )
+         return 0;
+      if ( readCount <= 0 )
+         return handleDeath();
+
+      pending_.append( buffer, readCount );
+      unsigned int completedCount = 0;
+      std::string::size_type endOfLine;
+      while ( (endOfLine = pending_.find( '\n' )) != std::string::npos )
+      {
+         std::string line = pending_.substr( 0, endOfLine );
+         pending_.erase( 0, endOfLine + 1 );
+         Json::Value result;
+         Json::Reader reader;
+         if ( !isBusy_  ||  !reader.parse( line, result, false )
+              ||  result["index"].asUInt() != currentTest_ )
+         {
+            continue; // Garbage: can only be caused by a corrupted worker
+         }
+         runner_.testCompleted( currentTest_, resultFromJson( result ) );
+         isBusy_ = false;
+         ++completedCount;
+      }
+      return completedCount;
+   }
+
+   /// Reaps the dead worker process and reports the test it was running as a fault.
+   /// @returns Number of tests completed (1 if a test was running, 0 otherwise).
+   unsigned int handleDeath()
+   {
+      closePipes();
+      int status = 0;
+      while ( waitpid( pid_, &status, 0 ) < 0  &&  errno == EINTR )
+         ;
+      pid_ = -1;
+      if ( !isBusy_ )
+         return 0;
+      isBusy_ = false;
+
+      std::string cause;
+      if ( WIFSIGNALED( status ) )
+      {
+         int signalNumber = WTERMSIG( status );
+         cause = "Test process crashed (signal ";
+         cause += CppTL::toString( signalNumber ).c_str();
+         cause += std::string( ": " ) + strsignal( signalNumber ) + ").";
+      }
+      else
+      {
+         cause = "Test process exited unexpectedly (exit code ";
+         cause += CppTL::toString( WEXITSTATUS( status ) ).c_str();
+         cause += ").";
+      }
+      runner_.recordFault( currentTest_, cause );
+      return 1;
+   }
+
+   /// Closes the command pipe, causing the worker process to exit, and waits for it.
+   void shutdown()
+   {
+      if ( !isAlive() )
+         return;
+      closePipes();
+      while ( waitpid( pid_, 0, 0 ) < 0  &&  errno == EINTR )
+         ;
+      pid_ = -1;
+   }
+
+private:
+   void closePipes()
+   {
+      if ( commandFd_ >= 0 )
+         close( commandFd_ );
+      if ( resultFd_ >= 0 )
+         close( resultFd_ );
+      commandFd_ = -1;
+      resultFd_ = -1;
+   }
+
+   void runChild( int commandFd, int resultFd )
+   {
+      ResultCollector collector;
+      std::string pending;
+      char buffer[256];
+      for (;;)
+      {
+         ssize_t readCount = read( commandFd, buffer, sizeof(buffer) );
+         if ( readCount < 0  &&  errno == EINTR )
+            continue;
+         if ( readCount <= 0 ) // parent closed the command pipe
+            break;
+         pending.append( buffer, readCount );
+         std::string::size_type endOfLine;
+         while ( (endOfLine = pending.find( '\n' )) != std::string::npos )
+         {
+            PlanIndex index = PlanIndex( strtoul( pending.c_str(), 0, 10 ) );
+            pending.erase( 0, endOfLine + 1 );
+            // The parent process completes the test when it reads the result.
+            LightTestRunner::runTest( runner_.plan_[index], runner_.repeat_,
+                                      collector, runner_.results_[index] );
+            Json::Value result = resultToJson( runner_.results_[index] );
+            result["index"] = index;
+            fflush( stdout );
+            if ( !writeAll( resultFd, Json::FastWriter().write( result ) ) )
+               _exit( 1 );
+         }
+      }
+      // The resources created by this process are destroyed.
+      ResourceRegistry::cancelReservations();
+      fflush( stdout );
+      fflush( stderr );
+      // Skips static destructors: they belong to the parent process.
+      _exit( 0 );
+   }
+
+   static bool writeAll( int fd, const std::string &data )
+   {
+      const char *current = data.c_str();
+      size_t remaining = data.length();
+      while ( remaining > 0 )
+      {
+         ssize_t written = write( fd, current, remaining );
+         if ( written < 0  &&  errno == EINTR )
+            continue;
+         if ( written <= 0 )
+            return false;
+         current += written;
+         remaining -= written;
+      }
+      return true;
+   }
+
+   static Json::Value resultToJson( const TestResult &result )
+   {
+      Json::Value value;
+      const TestStatus &status = result.status_;
+      value["status"] = int( status.status() );
+      value["assertionCount"] = status.assertionCount();
+      value["failedAssertionCount"] = status.failedAssertionCount();
+      value["ignoredFailureCount"] = status.ignoredFailureCount();
+      value["statistics"] = status.statistics();
+      value["report"] = result.report_;
+      value["reportedIgnoredFailureCount"] = result.ignoredFailureCount_;
+      return value;
+   }
+
+   static TestResult resultFromJson( const Json::Value &value )
+   {
+      TestResult result;
+      TestStatus &status = result.status_;
+      status.increaseAssertionCount( value["assertionCount"].asInt() );
+      status.increaseFailedAssertionCount( value["failedAssertionCount"].asInt() );
+      status.increaseIgnoredFailureCount( value["ignoredFailureCount"].asInt() );
+      status.setStatus( TestStatus::Status( value["status"].asInt() ) );
+      const Json::Value &statistics = value["statistics"];
+      if ( statistics.isObject() )
+      {
+         Json::Value::Members names = statistics.getMemberNames();
+         for ( Json::Value::Members::const_iterator it = names.begin(); it != names.end(); ++it )
+            status.setStatistics( *it, statistics[*it] );
+      }
+      result.report_ = value["report"].asString();
+      result.ignoredFailureCount_ = value["reportedIgnoredFailureCount"].asUInt();
+      return result;
+   }
+
+   LightTestRunner &runner_;
+   std::string pending_;
+   pid_t pid_;
+   int commandFd_;
+   int resultFd_;
+   PlanIndex currentTest_;
+   unsigned int resourceGroup_;
+   double deadline_;
+   bool isBusy_;
+};
+#endif // #if CPPUT_HAS_FORK
+
+
+// Class LightTestRunner
+// //////////////////////////////////////////////////////////////////
+
+LightTestRunner::LightTestRunner()
+   : blockedCount_( 0 )
+   , reporter_( &defaultReporter_ )
+   , reportCursor_( 0 )
+   , threadCount_( 1 )
+   , processCount_( 0 )
+   , slowestCount_( 0 )
+   , shardIndex_( 0 )
+   , shardCount_( 1 )
+   , listShards_( false )
+   , defaultTimeOut_( 0 )
+   , dumpBacktrace_( false )
+   , meanDuration_( 0 )
+   , benchmarkThreshold_( 0.05 )
+   , benchmarkSignificance_( 0.05 )
+   , failedFirst_( false )
+   , failuresOnly_( false )
+   , stopOnFailure_( false )
+   , isStopRequested_( false )
+{
+}
+
+
+LightTestRunner::~LightTestRunner()
+{
+}
+
+
+void
+LightTestRunner::addSuite( const Suite &suite )
+{
+   suitesToRun_.push_back( suite );
+}
+
+
+void
+LightTestRunner::setReporter( LightTestReporter &reporter )
+{
+   reporter_ = &reporter;
+}
+
+
+void
+LightTestRunner::addFilter( const std::string &pattern )
+{
+   filter_.addInclude( pattern );
+}
+
+
+void
+LightTestRunner::addExclude( const std::string &pattern )
+{
+   filter_.addExclude( pattern );
+}
+
+
+void
+LightTestRunner::setGroupFilter( const TestGroupFilter &filter )
+{
+   groupFilter_ = filter;
+}
+
+
+void
+LightTestRunner::setThreadCount( unsigned int threadCount )
+{
+   threadCount_ = threadCount;
+}
+
+
+void
+LightTestRunner::setProcessCount( unsigned int processCount )
+{
+   processCount_ = processCount;
+}
+
+
+void
+LightTestRunner::setShard( unsigned int shardIndex,
+                           unsigned int shardCount )
+{
+   shardIndex_ = shardIndex;
+   shardCount_ = shardCount;
+}
+
+
+void
+LightTestRunner::setListShards( bool listShards )
+{
+   listShards_ = listShards;
+}
+
+
+void
+LightTestRunner::setDefaultTimeOut( double timeOutInSeconds )
+{
+   defaultTimeOut_ = timeOutInSeconds;
+}
+
+
+void
+LightTestRunner::setDumpBacktraceOnTimeOut( bool dumpBacktrace )
+{
+   dumpBacktrace_ = dumpBacktrace;
+}
+
+
+void
+LightTestRunner::setTimingCacheFile( const std::string &path )
+{
+   timingCachePath_ = path;
+}
+
+
+void
+LightTestRunner::setLastRunFile( const std::string &path )
+{
+   lastRunPath_ = path;
+}
+
+
+void
+LightTestRunner::setFailedFirst( bool failedFirst )
+{
+   failedFirst_ = failedFirst;
+}
+
+
+void
+LightTestRunner::setFailuresOnly( bool failuresOnly )
+{
+   failuresOnly_ = failuresOnly;
+}
+
+
+void
+LightTestRunner::setStopOnFailure( bool stopOnFailure )
+{
+   stopOnFailure_ = stopOnFailure;
+}
+
+
+void
+LightTestRunner::setRepeatCount( unsigned int repeatCount )
+{
+   repeat_.repeatCount_ = repeatCount;
+   if ( repeatCount == 0 )
+      repeat_.untilFailure_ = true;
+}
+
+
+void
+LightTestRunner::setRepeatUntilFailure( bool untilFailure )
+{
+   repeat_.untilFailure_ = untilFailure;
+}
+
+
+void
+LightTestRunner::setConcurrentCopies( unsigned int copyCount )
+{
+   repeat_.copyCount_ = CPPTL_MAX( copyCount, 1u );
+}
+
+
+void
+LightTestRunner::setBenchmarkSaveFile( const std::string &path )
+{
+   benchmarkSavePath_ = path;
+}
+
+
+void
+LightTestRunner::setBenchmarkBaselineFile( const std::string &path )
+{
+   benchmarkBaselinePath_ = path;
+}
+
+
+void
+LightTestRunner::setBenchmarkRegressionThreshold( double threshold,
+                                                  double significance )
+{
+   benchmarkThreshold_ = threshold;
+   benchmarkSignificance_ = significance;
+}
+
+
+void
+LightTestRunner::setTimingReport( unsigned int slowestCount )
+{
+   slowestCount_ = slowestCount;
+}
+
+
+bool
+LightTestRunner::parseCommandLine( int argc, const char *argv[] )
+{
+   unsigned int shardIndex = shardIndex_;
+   unsigned int shardCount = shardCount_;
+   bool hasRepeatCount = false;
+   bool untilFailure = false;
+   bool hasLastRunFile = !lastRunPath_.empty();
+   BenchmarkSettings benchmark = benchmarkSettings();
+   const char *environmentValue = getenv( "CPPUT_SHARD_INDEX" );
+   if ( environmentValue != 0  &&  !parseUnsigned( environmentValue, shardIndex ) )
+   {
+      printf( "Invalid CPPUT_SHARD_INDEX: %s\n", environmentValue );
+      return false;
+   }
+   environmentValue = getenv( "CPPUT_SHARD_COUNT" );
+   if ( environmentValue != 0  &&  !parseUnsigned( environmentValue, shardCount ) )
+   {
+      printf( "Invalid CPPUT_SHARD_COUNT: %s\n", environmentValue );
+      return false;
+   }
+
+   for ( int index = 1; index < argc; ++index )
+   {
+      const char *arg = argv[index];
+      const char *value = 0;
+      unsigned int count;
+      if ( strcmp( arg, "-j" ) == 0  &&  index + 1 < argc )
+         value = argv[++index];
+      if ( value != 0  
+           ||  getOptionValue( arg, "--jobs=", value ) 
+           ||  getOptionValue( arg, "-j", value ) )
+      {
+         if ( !parseUnsigned( value, count ) )
+         {
+            printf( "Invalid thread count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setThreadCount( count );
+      }
+      else if ( getOptionValue( arg, "--filter=", value ) )
+      {
+         addFilter( value );
+      }
+      else if ( getOptionValue( arg, "--exclude=", value ) )
+      {
+         addExclude( value );
+      }
+      else if ( strcmp( arg, "--groups" ) == 0  ||  getOptionValue( arg, "--groups=", value ) )
+      {
+         if ( value == 0 )
+         {
+            if ( index + 1 >= argc )
+            {
+               printf( "Missing group expression: %s\n", arg );
+               printUsage( argv[0] );
+               return false;
+            }
+            value = argv[++index];
+         }
+         TestGroupFilter groupFilter;
+         std::string error;
+         if ( !groupFilter.setExpression( value, error ) )
+         {
+            printf( "Invalid group expression: %s (%s)\n", value, error.c_str() );
+            printUsage( argv[0] );
+            return false;
+         }
+         setGroupFilter( groupFilter );
+      }
+      else if ( getOptionValue( arg, "--fork=", value ) )
+      {
+#if CPPUT_HAS_FORK
+         if ( !parseUnsigned( value, count ) )
+         {
+            printf( "Invalid process count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setProcessCount( count );
+#else
+         printf( "Process isolation is not supported on this platform: %s\n", arg );
+         return false;
+#endif
+      }
+      else if ( getOptionValue( arg, "--shard-index=", value ) )
+      {
+         if ( !parseUnsigned( value, shardIndex ) )
+         {
+            printf( "Invalid shard index: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+      }
+      else if ( getOptionValue( arg, "--shard-count=", value ) )
+      {
+         if ( !parseUnsigned( value, shardCount ) )
+         {
+            printf( "Invalid shard count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+      }
+      else if ( strcmp( arg, "--list-shards" ) == 0 )
+      {
+         setListShards( true );
+      }
+      else if ( getOptionValue( arg, "--timeout=", value ) )
+      {
+         double timeOut;
+         if ( !parseSeconds( value, timeOut ) )
+         {
+            printf( "Invalid time-out: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setDefaultTimeOut( timeOut );
+      }
+      else if ( strcmp( arg, "--timeout-backtrace" ) == 0 )
+      {
+         setDumpBacktraceOnTimeOut( true );
+      }
+      else if ( getOptionValue( arg, "--timing-cache=", value ) )
+      {
+         setTimingCacheFile( value );
+      }
+      else if ( getOptionValue( arg, "--last-run=", value ) )
+      {
+         setLastRunFile( value );
+         hasLastRunFile = true;
+      }
+      else if ( strcmp( arg, "--failed-first" ) == 0 )
+      {
+         setFailedFirst( true );
+      }
+      else if ( strcmp( arg, "--failures-only" ) == 0 )
+      {
+         setFailuresOnly( true );
+      }
+      else if ( strcmp( arg, "-x" ) == 0  ||  strcmp( arg, "--stop-on-failure" ) == 0 )
+      {
+         setStopOnFailure( true );
+      }
+      else if ( strcmp( arg, "--timing-report" ) == 0 )
+      {
+         setTimingReport( 10 );
+      }
+      else if ( getOptionValue( arg, "--timing-report=", value ) )
+      {
+         if ( !parseUnsigned( value, count ) )
+         {
+            printf( "Invalid slowest test count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setTimingReport( count );
+      }
+      else if ( getOptionValue( arg, "--repeat=", value ) )
+      {
+         if ( !parseUnsigned( value, count )  ||  count == 0 )
+         {
+            printf( "Invalid repeat count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setRepeatCount( count );
+         hasRepeatCount = true;
+      }
+      else if ( strcmp( arg, "--until-failure" ) == 0 )
+      {
+         untilFailure = true;
+      }
+      else if ( getOptionValue( arg, "--concurrent-copies=", value ) )
+      {
+#if CPPTL_HAS_THREAD
+         if ( !parseUnsigned( value, count )  ||  count == 0 )
+         {
+            printf( "Invalid concurrent copy count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setConcurrentCopies( count );
+#else
+         printf( "Threads are not supported on this platform: %s\n", arg );
+         return false;
+#endif
+      }
+      else if ( strcmp( arg, "--track-allocations" ) == 0 )
+      {
+         if ( !areAllocationHooksInstalled() )
+         {
+            printf( "Allocation tracking requires linking with the cpput_allocationhooks library: %s\n", 
+                    arg );
+            return false;
+         }
+         setAllocationTracking( true );
+      }
+      else if ( strcmp( arg, "--perf-counters" ) == 0 )
+      {
+         setPerfCounters( true );
+      }
+      else if ( getOptionValue( arg, "--benchmark-time=", value ) )
+      {
+         if ( !parseSeconds( value, benchmark.sampleTime_ )  ||  benchmark.sampleTime_ <= 0 )
+         {
+            printf( "Invalid benchmark sample time: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+      }
+      else if ( getOptionValue( arg, "--benchmark-warmup=", value ) )
+      {
+         if ( !parseSeconds( value, benchmark.warmUpTime_ ) )
+         {
+            printf( "Invalid benchmark warm-up time: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+      }
+      else if ( getOptionValue( arg, "--benchmark-samples=", value ) )
+      {
+         if ( !parseUnsigned( value, benchmark.sampleCount_ )  ||  benchmark.sampleCount_ == 0 )
+         {
+            printf( "Invalid benchmark sample count: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+      }
+      else if ( getOptionValue( arg, "--benchmark-save=", value ) )
+      {
+         setBenchmarkSaveFile( value );
+      }
+      else if ( getOptionValue( arg, "--benchmark-baseline=", value ) )
+      {
+         setBenchmarkBaselineFile( value );
+      }
+      else if ( getOptionValue( arg, "--benchmark-threshold=", value ) )
+      {
+         double threshold;
+         if ( !parseSeconds( value, threshold ) )
+         {
+            printf( "Invalid benchmark regression threshold: %s\n", arg );
+            printUsage( argv[0] );
+            return false;
+         }
+         setBenchmarkRegressionThreshold( threshold / 100, benchmarkSignificance_ );
+      }
+      else
+      {
+         printf( "Unknown option: %s\n", arg );
+         printUsage( argv[0] );
+         return false;
+      }
+   }
+
+   setBenchmarkSettings( benchmark );
+   // The outcomes are only remembered when they are used.
+   if ( !hasLastRunFile  &&  (failedFirst_  ||  failuresOnly_)  &&  argc > 0 )
+      setLastRunFile( std::string( argv[0] ) + ".lastrun" );
+   if ( untilFailure )
+   {
+      setRepeatUntilFailure( true );
+      if ( !hasRepeatCount )
+         setRepeatCount( 0 );
+   }
+   if ( shardCount == 0  ||  shardIndex >= shardCount )
+   {
+      printf( "Invalid shard: index %u must be less than shard count %u.\n",
+              shardIndex, shardCount );
+      return false;
+   }
+   setShard( shardIndex, shardCount );
+   return true;
+}
+
+
+void
+LightTestRunner::printUsage( const char *programName )
+{
+   printf( "Usage: %s [options]\n"
+           "  --filter=PATTERN   Only runs the tests whose path matches PATTERN.\n"
+           "                     '*' matches any sequence, '?' any character.\n"
+           "                     May be repeated to select several patterns.\n"
+           "  --exclude=PATTERN  Does not run the tests whose path matches PATTERN.\n"
+           "  --groups EXPRESSION\n"
+           "                     Only runs the tests whose groups match EXPRESSION,\n"
+           "                     combining group names with &, |, ! and parentheses.\n"
+           "                     Example: --groups \"fast & !db | smoke\"\n"
+           "  -j N, --jobs=N     Runs the tests using N worker threads.\n"
+           "                     0 uses one thread per processor.\n"
+           "  --fork=N           Runs the tests in N worker processes forked once\n"
+           "                     after registration. A crashing test is reported\n"
+           "                     as a fault and its worker process is replaced.\n"
+           "  --shard-index=I    Only runs the tests of shard I (default 0).\n"
+           "  --shard-count=N    Partitions the tests into N shards (default 1).\n"
+           "                     Defaults to CPPUT_SHARD_INDEX and CPPUT_SHARD_COUNT.\n"
+           "  --list-shards      Lists the tests of each shard without running them.\n"
+           "  --timeout=S        Time-out in seconds of the tests that do not have one.\n"
+           "                     Only enforced with worker threads or processes.\n"
+           "  --timeout-backtrace\n"
+           "                     Dumps the backtrace of timed out tests to stderr.\n"
+           "  --timing-cache=FILE\n"
+           "                     Remembers the duration of the tests in FILE. Used to\n"
+           "                     run the longest tests first.\n"
+           "  --last-run=FILE    Remembers the outcome of the tests in FILE. Defaults\n"
+           "                     to the program path followed by .lastrun with\n"
+           "                     --failed-first or --failures-only, and to none\n"
+           "                     otherwise. An empty FILE disables it.\n"
+           "  --failed-first     Runs the tests that failed in the last run first,\n"
+           "                     then the new tests, then the other tests.\n"
+           "  --failures-only    Only runs the tests that failed in the last run.\n"
+           "  -x, --stop-on-failure\n"
+           "                     Stops running tests after the first failure.\n"
+           "  --timing-report[=N]\n"
+           "                     Reports the N slowest tests (default 10) and a\n"
+           "                     histogram of the test durations.\n"
+           "  --repeat=N         Runs each test N times in a row, and reports the\n"
+           "                     number of failed runs and the spread of durations.\n"
+           "  --until-failure    Stops repeating a test after its first failure.\n"
+           "                     Repeats it until it fails if --repeat is not given.\n"
+           "  --concurrent-copies=K\n"
+           "                     Runs K copies of each test at the same time, each\n"
+           "                     in its own thread, to expose race conditions.\n"
+           "  --track-allocations\n"
+           "                     Counts the heap allocations of each test, and fails\n"
+           "                     the tests leaking memory. Requires linking with the\n"
+           "                     cpput_allocationhooks library.\n"
+           "  --perf-counters    Counts the cycles, instructions, cache misses and\n"
+           "                     branch misses of each test and benchmark, or its\n"
+           "                     page faults and context switches if the hardware\n"
+           "                     counters are not available.\n"
+           "  --benchmark-time=S Calibrates the benchmark samples to last S seconds\n"
+           "                     (default 0.01).\n"
+           "  --benchmark-warmup=S\n"
+           "                     Runs each benchmark for S seconds before sampling\n"
+           "                     it (default 0.1).\n"
+           "  --benchmark-samples=N\n"
+           "                     Measures N samples of each benchmark (default 20).\n"
+           "                     Use --groups benchmark or --groups \"!benchmark\"\n"
+           "                     to only run or to skip the benchmarks.\n"
+           "  --benchmark-save=FILE\n"
+           "                     Saves the benchmark results to the baseline FILE.\n"
+           "  --benchmark-baseline=FILE\n"
+           "                     Compares the benchmarks to the baseline FILE, and\n"
+           "                     fails the ones significantly slower.\n"
+           "  --benchmark-threshold=PERCENT\n"
+           "                     Slow down tolerated before failing (default 5).\n",
+           programName );
+}
+
+
+bool
+LightTestRunner::runTests()
+{
+   plan_.clear();
+   const FrozenRegistry &registry = Registry::freeze();
+   for ( SuitesToRun::iterator it = suitesToRun_.begin(); it != suitesToRun_.end(); ++it )
+   {
+      int suiteIndex = registry.indexOf( *it );
+      if ( suiteIndex >= 0 )
+         collectTests( registry, suiteIndex, filter_.start() );
+      else if ( it->isValid() ) // suite not nested in the registry root suite
+      {
+         FrozenRegistry suiteRegistry( *it );
+         collectTests( suiteRegistry, 0, filter_.start() );
+      }
+   }
+   loadTimingCache();
+   if ( listShards_ )
+   {
+      listShards();
+      return true;
+   }
+   selectShard();
+   loadLastRun();
+   applyLastRunOrder();
+   groupByResources();
+   reserveResources();
+   isStopRequested_ = false;
+   results_.clear();
+   results_.resize( plan_.size() );
+   summary_ = LightTestSummary();
+   timings_ = LightTestTimings();
+   loadBenchmarkBaseline();
+   reportCursor_ = 0;
+   resolveDependencies();
+#if CPPUT_HAS_BACKTRACE
+   if ( dumpBacktrace_ )
+      installBacktraceHandler();
+#endif
+
+   unsigned int threadCount = effectiveThreadCount();
+#if CPPUT_HAS_FORK
+   if ( processCount_ > 0 )
+      runTestsInProcesses( processCount_ );
+   else
+#endif
+   if ( threadCount > 1 )
+      runTestsInParallel( threadCount );
+   else
+      runTestsSerially();
+   saveTimingCache();
+   saveLastRun();
+   saveBenchmarkResults();
+   ResourceRegistry::cancelReservations();
+
+   if ( slowestCount_ > 0 )
+      reporter_->reportTimings( timings_ );
+   if ( !benchmarkDeltas_.empty() )
+   {
+      LightBenchmarkDeltas deltas;
+      for ( BenchmarkDeltas::const_iterator it = benchmarkDeltas_.begin(); it != benchmarkDeltas_.end(); ++it )
+         deltas.push_back( it->second );
+      reporter_->reportBenchmarkDeltas( deltas );
+   }
+   reporter_->runCompleted( summary_ );
+   return summary_.testFailed_ == 0;
+}
+
+
+unsigned int
+LightTestRunner::effectiveThreadCount() const
+{
+#if CPPTL_HAS_THREAD
+   unsigned int threadCount = threadCount_;
+   if ( threadCount == 0 )
+      threadCount = CppTL::Thread::hardwareConcurrency();
+   if ( threadCount > plan_.size() )
+      threadCount = (unsigned int)plan_.size();
+   return threadCount;
+#else
+   return 1;
+#endif
+}
+
+
+/// Adds the tests of the suite selected by the filter to the plan.
+/// The test paths start with the name of the first suite traversed.
+/// \param filterState State of the filter after matching the parent suite path.
+void
+LightTestRunner::collectTests( const FrozenRegistry &registry,
+                               int suiteIndex,
+                               TestPathFilter::State filterState )
+{
+   const FrozenRegistry::SuiteEntry &startSuite = registry.suiteAt( suiteIndex );
+   CppTL::ConstString::size_type prefixLength = 0;
+   if ( startSuite.parent_ >= 0 )
+      prefixLength = registry.suiteAt( startSuite.parent_ ).path_.length();
+   collectTests( registry, suiteIndex, prefixLength, filterState );
+}
+
+
+void
+LightTestRunner::collectTests( const FrozenRegistry &registry,
+                               int suiteIndex,
+                               CppTL::ConstString::size_type prefixLength,
+                               TestPathFilter::State filterState )
+{
+   const FrozenRegistry::SuiteEntry &suite = registry.suiteAt( suiteIndex );
+   filterState = filter_.advance( filterState, "/" + suite.name_.str() );
+   if ( filter_.isPruned( filterState ) )
+      return;
+
+   for ( int nestedIndex = suite.firstNestedSuite_; nestedIndex < suite.endNestedSuite_; ++nestedIndex )
+   {
+      collectTests( registry, nestedIndex, prefixLength, filterState );
+   }
+   for ( int index = suite.firstTest_; index < suite.endTest_; ++index )
+   {
+      const FrozenRegistry::TestEntry &test = registry.testAt( index );
+      if ( !filter_.isSelected( filter_.advance( filterState, "/" + test.name_.str() ) ) )
+         continue;
+      // Creates the TestMeta of the tests registered with a TestDescriptor.
+      const TestMeta &testMeta = registry.testMetaAt( index );
+      if ( !groupFilter_.isSelected( testMeta.groupSet() ) )
+         continue;
+      PlannedTest planned;
+      planned.test_ = &testMeta;
+      planned.path_ = prefixLength == 0 ? test.path_ : test.path_.substr( prefixLength );
+      plan_.push_back( planned );
+   }
+}
+
+
+/// Assigns each test to a shard by a stable hash of its path. The partition only
+/// depends on the test paths and the shard count, never on the timing history,
+/// which may differ between the shards and changes after each run.
+void
+LightTestRunner::assignShards( std::vector<unsigned int> &shards ) const
+{
+   shards.assign( plan_.size(), 0 );
+   if ( shardCount_ <= 1 )
+      return;
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+      shards[index] = CppTL::stableHash( plan_[index].path_ ) % shardCount_;
+}
+
+
+void
+LightTestRunner::selectShard()
+{
+   if ( shardCount_ <= 1 )
+      return;
+   std::vector<unsigned int> shards;
+   assignShards( shards );
+   TestPlan shardPlan;
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+   {
+      if ( shards[index] == shardIndex_ )
+         shardPlan.push_back( plan_[index] );
+   }
+   plan_.swap( shardPlan );
+}
+
+
+void
+LightTestRunner::listShards() const
+{
+   const unsigned int shardCount = CPPTL_MAX( shardCount_, 1u );
+   std::vector<unsigned int> shards;
+   assignShards( shards );
+   std::vector<unsigned int> testCounts( shardCount, 0 );
+   std::vector<double> durations( shardCount, 0.0 );
+   for ( unsigned int shard = 0; shard < shardCount; ++shard )
+   {
+      fprintf( stdout, "Shard %u/%u:\n", shard, shardCount );
+      for ( PlanIndex index = 0; index < plan_.size(); ++index )
+      {
+         if ( shards[index] == shard )
+         {
+            fprintf( stdout, "  %s\n", plan_[index].path_.c_str() );
+            ++testCounts[shard];
+            durations[shard] += predictedDuration( index );
+         }
+      }
+   }
+
+   unsigned int minCount = testCounts[0];
+   unsigned int maxCount = testCounts[0];
+   fprintf( stdout, "Shard sizes:" );
+   for ( unsigned int shard = 0; shard < shardCount; ++shard )
+   {
+      fprintf( stdout, " %u", testCounts[shard] );
+      minCount = CPPTL_MIN( minCount, testCounts[shard] );
+      maxCount = CPPTL_MAX( maxCount, testCounts[shard] );
+   }
+   if ( hasTimingHistory() )
+   {
+      fprintf( stdout, "\nPredicted shard durations (s):" );
+      for ( unsigned int shard = 0; shard < shardCount; ++shard )
+         fprintf( stdout, " %.3f", durations[shard] );
+   }
+   fprintf( stdout, "\n%u tests in %u shards (min %u, max %u).\n",
+            (unsigned int)plan_.size(), shardCount, minCount, maxCount );
+   fflush( stdout );
+}
+
 
-LightTestRunner::LightTestRunner()
-   : testRun_( 0 )
-   , testFailed_( 0 )
-   , testSkipped_( 0 )
-   , ignoredFailureCount_( 0 )
-   , totalAssertionCount_( 0 )
+void
+LightTestRunner::loadTimingCache()
 {
+   timingCache_ = Json::Value();
+   meanDuration_ = 0;
+   if ( timingCachePath_.empty() )
+      return;
+   Json::Value cache;
+   if ( !readJsonFile( timingCachePath_, cache )  ||  !cache.isObject() )
+      return;
+   timingCache_ = cache;
+   unsigned int knownCount = 0;
+   double totalDuration = 0;
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+   {
+      const Json::Value &duration = timingCache_[ plan_[index].path_ ];
+      if ( !duration.isNull()  &&  duration.isConvertibleTo( Json::realValue ) )
+      {
+         totalDuration += duration.asDouble();
+         ++knownCount;
+      }
+   }
+   if ( knownCount > 0 )
+      meanDuration_ = totalDuration / knownCount;
 }
 
 
-LightTestRunner::~LightTestRunner()
+void
+LightTestRunner::saveTimingCache()
 {
+   if ( timingCachePath_.empty() )
+      return;
+   // Durations of the tests not run (other shards...) are preserved.
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+   {
+      const Json::Value &duration = results_[index].status_.statistics()["duration"];
+      if ( !duration.isNull() )
+         timingCache_[ plan_[index].path_ ] = duration;
+   }
+   if ( !writeJsonFile( timingCachePath_, timingCache_ ) )
+      fprintf( stderr, "Failed to write timing cache: %s\n", timingCachePath_.c_str() );
 }
 
 
-void 
-LightTestRunner::addSuite( const Suite &suite )
+void
+LightTestRunner::loadBenchmarkBaseline()
 {
-   suitesToRun_.push_back( suite );
+   benchmarkBaseline_ = Json::Value();
+   benchmarkDeltas_.clear();
+   if ( benchmarkBaselinePath_.empty() )
+      return;
+   Json::Value baseline;
+   if ( !readJsonFile( benchmarkBaselinePath_, baseline )  ||  !baseline.isObject() )
+   {
+      fprintf( stderr, "Failed to read benchmark baseline: %s\n", benchmarkBaselinePath_.c_str() );
+      return;
+   }
+   benchmarkBaseline_ = baseline;
 }
 
 
-bool 
-LightTestRunner::runTests()
+/// Compares the benchmark samples of the test to its baseline samples, and fails
+/// the test if it regressed. resultLock_ must be held.
+void
+LightTestRunner::compareToBaseline( PlanIndex index )
 {
-   TestInfo::threadInstance().setTestResultUpdater( *this );
-   for ( SuitesToRun::iterator it = suitesToRun_.begin(); it != suitesToRun_.end(); ++it )
-      runTestSuite( *it );
-   if ( testFailed_ > 0 )
+   TestResult &result = results_[index];
+   const Json::Value &samples = result.status_.statistics()["benchmark"]["samples_ns"];
+   const Json::Value &baselineSamples = benchmarkBaseline_[ plan_[index].path_ ]["samples_ns"];
+   if ( samples.size() == 0  ||  baselineSamples.size() == 0 )
+      return;
+   std::vector<double> current;
+   for ( unsigned int sample = 0; sample < samples.size(); ++sample )
+      current.push_back( samples[sample].asDouble() );
+   std::vector<double> baseline;
+   for ( unsigned int sample = 0; sample < baselineSamples.size(); ++sample )
+      baseline.push_back( baselineSamples[sample].asDouble() );
+
+   LightBenchmarkDelta delta;
+   delta.path_ = plan_[index].path_;
+   delta.comparison_ = BenchmarkComparison::compare( baseline, current );
+   delta.isRegression_ = delta.comparison_.change_ > benchmarkThreshold_  
+                         &&  delta.comparison_.pValue_ < benchmarkSignificance_;
+   benchmarkDeltas_[index] = delta;
+   if ( !delta.isRegression_ )
+      return;
+
+   result.status_.setStatus( TestStatus::failed );
+   char message[256];
+   sprintf( message, "Benchmark regressed: median %s -> %s (%+.1f%%, p-value %.2g), "
+                     "tolerated slow down is %.1f%%.\n\n",
+            LightTestTimings::formatDuration( delta.comparison_.baselineMedian_ * 1e-9 ).c_str(),
+            LightTestTimings::formatDuration( delta.comparison_.median_ * 1e-9 ).c_str(),
+            delta.comparison_.change_ * 100,
+            delta.comparison_.pValue_,
+            benchmarkThreshold_ * 100 );
+   CppTL::StringBuffer report;
+   report += result.report_;
+   report += "-> " + plan_[index].path_ + " : benchmark\n";
+   report += message;
+   result.report_ = report;
+}
+
+
+void
+LightTestRunner::saveBenchmarkResults()
+{
+   if ( benchmarkSavePath_.empty() )
+      return;
+   // The results of the benchmarks not run are preserved.
+   Json::Value results;
+   if ( !readJsonFile( benchmarkSavePath_, results )  ||  !results.isObject() )
+      results = Json::Value( Json::objectValue );
+   bool hasBenchmark = false;
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
    {
-      fprintf( stdout, "Failure report:\n%s", report_.c_str() );
-      fflush( stdout );
-      fprintf( stdout, "%d/%d tests passed, %d tests failed", 
-              testRun_ - testFailed_,
-              testRun_,
-              testFailed_ );
+      const Json::Value &benchmark = results_[index].status_.statistics()["benchmark"];
+      if ( benchmark.isNull() )
+         continue;
+      results[ plan_[index].path_ ] = benchmark;
+      hasBenchmark = true;
    }
-   else
+   if ( hasBenchmark  &&  !writeJsonFile( benchmarkSavePath_, results ) )
+      fprintf( stderr, "Failed to write benchmark results: %s\n", benchmarkSavePath_.c_str() );
+}
+
+
+bool
+LightTestRunner::hasTimingHistory() const
+{
+   return timingCache_.size() > 0;
+}
+
+
+/// Returns the duration of the test measured by a previous run. The mean duration
+/// of the known tests is used for the tests that were never run.
+double
+LightTestRunner::predictedDuration( PlanIndex index ) const
+{
+   const Json::Value &duration = timingCache_[ plan_[index].path_ ];
+   if ( duration.isNull()  ||  !duration.isConvertibleTo( Json::realValue ) )
+      return meanDuration_;
+   return duration.asDouble();
+}
+
+
+void
+LightTestRunner::orderLongestFirst( PlanOrder &order ) const
+{
+   std::vector<TestCost> costs( plan_.size() );
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
    {
-      fprintf( stdout, "All %d tests passed", testRun_ );
-      fflush( stdout );
+      costs[index].duration_ = predictedDuration( index );
+      costs[index].path_ = plan_[index].path_;
+      costs[index].index_ = index;
    }
+   std::sort( costs.begin(), costs.end() );
+   order.clear();
+   for ( std::vector<TestCost>::const_iterator it = costs.begin(); it != costs.end(); ++it )
+      order.push_back( it->index_ );
+}
+
+
+void
+LightTestRunner::loadLastRun()
+{
+   lastRun_ = Json::Value();
+   Json::Value lastRun;
+   if ( !lastRunPath_.empty()  &&  readJsonFile( lastRunPath_, lastRun )  &&  lastRun.isObject() )
+      lastRun_ = lastRun;
+}
 
-   if ( ignoredFailureCount_ > 0 )
-      fprintf( stdout, ", %d ignored failures", ignoredFailureCount_ );
-   fprintf( stdout, " (%d %s).\n", 
-            totalAssertionCount_, 
-            totalAssertionCount_ > 1 ? "assertions" : "assertion" );
-   fflush( stdout );
 
-   return testFailed_ == 0;
+void
+LightTestRunner::saveLastRun()
+{
+   if ( lastRunPath_.empty() )
+      return;
+   // Outcomes of the tests not run (other shards...) are preserved.
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+   {
+      const TestResult &result = results_[index];
+      if ( !result.hasRun_ )
+         continue;
+      const char *outcome = "passed";
+      if ( result.status_.hasFailed() )
+         outcome = "failed";
+      else if ( result.status_.wasSkipped() )
+         outcome = "skipped";
+      lastRun_[ plan_[index].path_ ] = outcome;
+   }
+   if ( !writeJsonFile( lastRunPath_, lastRun_ ) )
+      fprintf( stderr, "Failed to write last run outcomes: %s\n", lastRunPath_.c_str() );
 }
 
 
-void 
-LightTestRunner::runTestSuite( const Suite &suite )
+void
+LightTestRunner::applyLastRunOrder()
 {
-   if ( !suite.isValid() )
+   if ( !failedFirst_  &&  !failuresOnly_ )
+      return;
+   TestPlan failedTests;
+   TestPlan newTests;
+   TestPlan otherTests;
+   for ( TestPlan::const_iterator it = plan_.begin(); it != plan_.end(); ++it )
+   {
+      const Json::Value &outcome = lastRun_[ it->path_ ];
+      if ( outcome.isNull() )
+         newTests.push_back( *it );
+      else if ( outcome.asString() == "failed" )
+         failedTests.push_back( *it );
+      else
+         otherTests.push_back( *it );
+   }
+   if ( failuresOnly_  &&  !failedTests.empty() )
    {
+      plan_.swap( failedTests );
       return;
    }
+   if ( failuresOnly_ )
+      fprintf( stdout, "No test failed in the last run, running all the tests.\n" );
+   plan_.swap( failedTests );
+   plan_.insert( plan_.end(), newTests.begin(), newTests.end() );
+   plan_.insert( plan_.end(), otherTests.begin(), otherTests.end() );
+}
 
-   testPath_.push_back( suite.name() );
-   for ( int suiteIndex =0; suiteIndex < suite.nestedSuiteCount(); ++suiteIndex )
+
+/// Moves the tests requiring the same resources next to the first of them, and
+/// numbers the distinct sets of required resources.
+void
+LightTestRunner::groupByResources()
+{
+   const PlanIndex testCount = PlanIndex( plan_.size() );
+   typedef std::map<std::string, unsigned int> Groups;
+   Groups groups;
+   std::vector<unsigned int> groupOf( testCount, 0 );
+   for ( PlanIndex index = 0; index < testCount; ++index )
    {
-      runTestSuite( suite.nestedSuiteAt( suiteIndex ) );
+      const TestMeta &test = *plan_[index].test_;
+      if ( test.resourceCount() == 0 )
+         continue;
+      std::vector<std::string> names;
+      for ( int resource = 0; resource < test.resourceCount(); ++resource )
+         names.push_back( test.resourceAt( resource ) );
+      std::sort( names.begin(), names.end() );
+      std::string key;
+      for ( std::vector<std::string>::const_iterator it = names.begin(); it != names.end(); ++it )
+         key += *it + "\n";
+      unsigned int &group = groups[key];
+      if ( group == 0 )
+         group = (unsigned int)groups.size();
+      groupOf[index] = group;
    }
-   for ( int index =0; index < suite.testCaseCount(); ++index )
+   resourceGroups_.swap( groupOf );
+   // The failing tests come first in the failed first mode, whatever their resources.
+   if ( groups.empty()  ||  failedFirst_ )
+      return;
+
+   // Sorts by (rank, index), the rank of a test being the index of the first test
+   // of its group.
+   std::vector<unsigned int> groupRanks( groups.size() + 1, testCount );
+   std::vector< std::pair<PlanIndex, PlanIndex> > ranks;
+   for ( PlanIndex index = 0; index < testCount; ++index )
    {
-      const TestMeta *test = suite.testCaseAt( index );
-      if ( test != 0 )
+      unsigned int group = resourceGroups_[index];
+      PlanIndex rank = index;
+      if ( group != 0 )
       {
-         testPath_.push_back( test->name() );
-         runTestCase( *test );
-         testPath_.pop_back();
+         groupRanks[group] = CPPTL_MIN( groupRanks[group], index );
+         rank = groupRanks[group];
       }
+      ranks.push_back( std::make_pair( rank, index ) );
+   }
+   std::sort( ranks.begin(), ranks.end() );
+   TestPlan groupedPlan;
+   std::vector<unsigned int> groupedResourceGroups;
+   for ( PlanIndex index = 0; index < testCount; ++index )
+   {
+      groupedPlan.push_back( plan_[ ranks[index].second ] );
+      groupedResourceGroups.push_back( resourceGroups_[ ranks[index].second ] );
    }
-   testPath_.pop_back();
+   plan_.swap( groupedPlan );
+   resourceGroups_.swap( groupedResourceGroups );
 }
 
 
-void 
-LightTestRunner::runTestCase( const TestMeta &testCase )
+/// Reserves the resources of the planned tests, so that they are only
+/// destroyed once the last test requiring them has run.
+void
+LightTestRunner::reserveResources()
 {
-   fprintf( stdout, "Testing %s : ", getTestPath().c_str() );
-   fflush( stdout );
-   assertions_.clear();
-   logs_.clear();
-   results_.clear();
-   ++testRun_;
-   testCase.runTest();
-   
-   TestStatus &testStatus = TestInfo::threadInstance().testStatus();
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+   {
+      const TestMeta &test = *plan_[index].test_;
+      for ( int resource = 0; resource < test.resourceCount(); ++resource )
+         ResourceRegistry::reserve( test.resourceAt( resource ) );
+   }
+}
+
+
+/// Cancels the resource reservations of a test that will not run, so that the
+/// resources are destroyed as soon as the other tests are done with them.
+void
+LightTestRunner::cancelReservedResources( PlanIndex index )
+{
+   const TestMeta &test = *plan_[index].test_;
+   for ( int resource = 0; resource < test.resourceCount(); ++resource )
+      ResourceRegistry::cancelReservation( test.resourceAt( resource ) );
+}
+
+
+/// Builds the dependency graph of the planned tests.
+void
+LightTestRunner::resolveDependencies()
+{
+   const PlanIndex testCount = PlanIndex( plan_.size() );
+   dependents_.assign( testCount, PlanOrder() );
+   pendingPrerequisites_.assign( testCount, 0 );
+   readyTests_.clear();
+   blockedCount_ = 0;
+   typedef std::map<CppTL::ConstString, PlanIndex> IndexesByPath;
+   IndexesByPath indexesByPath;
+   for ( PlanIndex index = 0; index < testCount; ++index )
+      indexesByPath[ plan_[index].path_ ] = index;
 
-   std::string status;
-   switch ( testStatus.status() )
+   for ( PlanIndex index = 0; index < testCount; ++index )
    {
-   case TestStatus::passed: 
-      status = "OK"; 
-      break;
-   case TestStatus::skipped: 
-      status = "SKIP"; 
-      ++testSkipped_;
-      break;
-   case TestStatus::failed: 
-      status = "FAIL"; 
-      ++testFailed_;
-      break;
-   default: status = "?"; break;
+      const TestMeta &test = *plan_[index].test_;
+      const std::string path = plan_[index].path_.c_str();
+      const std::string suitePath = path.substr( 0, path.rfind( '/' ) );
+      for ( int dependency = 0; dependency < test.dependencyCount(); ++dependency )
+      {
+         std::string name = test.dependencyAt( dependency );
+         if ( name.empty() )
+            continue;
+         if ( name[0] != '/' )
+            name = suitePath + "/" + name;
+         IndexesByPath::const_iterator it = indexesByPath.find( name.c_str() );
+         if ( it == indexesByPath.end() )
+            continue;
+         dependents_[it->second].push_back( index );
+         if ( pendingPrerequisites_[index]++ == 0 )
+            ++blockedCount_;
+      }
    }
+   if ( blockedCount_ == 0 )
+      return;
 
-   int assertionCount = testStatus.assertionCount();
-   status += " (";
-   unsigned int failedAssertionCount = testStatus.failedAssertionCount();
-   if ( failedAssertionCount > 0 )
+   std::vector<bool> isInCycle;
+   findDependencyCycles( isInCycle );
+   // Marked first, so that the fault of a test does not skip the other tests of its
+   // cycle. The tests depending on a cycle are skipped when its tests are faulted.
+   for ( PlanIndex index = 0; index < testCount; ++index )
+   {
+      if ( isInCycle[index] )
+         results_[index].hasRun_ = true;
+   }
+   for ( PlanIndex index = 0; index < testCount; ++index )
    {
-      std::string count = CppTL::toString( failedAssertionCount ).c_str();
-      status += count + (failedAssertionCount > 1 ? " assertions failed/" 
-                                                    : " assertion failed/");
+      if ( isInCycle[index] )
+      {
+         recordFault( index, "Circular dependency between the prerequisites of the test." );
+         cancelReservedResources( index );
+      }
    }
+}
 
-   status += CppTL::toString( assertionCount ).c_str();
-   status += (assertionCount > 1 ? " assertions" : " assertion" );
-   totalAssertionCount_ += assertionCount;
 
-   if ( testStatus.ignoredFailureCount() > 0 )
+/// Finds the tests in a dependency cycle: the strongly connected components of
+/// the dependency graph with several tests, and the tests depending on themselves.
+/// Tarjan's algorithm, without recursion as dependency chains may be long.
+void
+LightTestRunner::findDependencyCycles( std::vector<bool> &isInCycle ) const
+{
+   const PlanIndex testCount = PlanIndex( plan_.size() );
+   const PlanIndex notVisited = PlanIndex( -1 );
+   isInCycle.assign( testCount, false );
+   std::vector<PlanIndex> visitOrder( testCount, notVisited );
+   std::vector<PlanIndex> lowLinks( testCount, 0 );
+   std::vector<bool> isOnStack( testCount, false );
+   PlanOrder stack;
+   // The visited tests, with the index of the next dependent to visit.
+   std::vector< std::pair<PlanIndex, unsigned int> > path;
+   PlanIndex visitCount = 0;
+   for ( PlanIndex root = 0; root < testCount; ++root )
    {
-      std::string count = CppTL::toString( testStatus.ignoredFailureCount() ).c_str();
-      status += ", " + count + " ignored failures";
+      if ( visitOrder[root] != notVisited )
+         continue;
+      path.push_back( std::make_pair( root, 0u ) );
+      visitOrder[root] = lowLinks[root] = visitCount++;
+      stack.push_back( root );
+      isOnStack[root] = true;
+      while ( !path.empty() )
+      {
+         const PlanIndex index = path.back().first;
+         const PlanOrder &dependents = dependents_[index];
+         if ( path.back().second < dependents.size() )
+         {
+            const PlanIndex dependent = dependents[ path.back().second++ ];
+            if ( dependent == index )
+               isInCycle[index] = true;
+            if ( visitOrder[dependent] == notVisited )
+            {
+               path.push_back( std::make_pair( dependent, 0u ) );
+               visitOrder[dependent] = lowLinks[dependent] = visitCount++;
+               stack.push_back( dependent );
+               isOnStack[dependent] = true;
+            }
+            else if ( isOnStack[dependent] )
+               lowLinks[index] = CPPTL_MIN( lowLinks[index], visitOrder[dependent] );
+            continue;
+         }
+
+         path.pop_back();
+         if ( !path.empty() )
+         {
+            const PlanIndex parent = path.back().first;
+            lowLinks[parent] = CPPTL_MIN( lowLinks[parent], lowLinks[index] );
+         }
+         if ( lowLinks[index] != visitOrder[index] )
+            continue;
+         // All its dependencies visited, the test is the root of a component.
+         PlanOrder::size_type first = stack.size();
+         do
+         {
+            isOnStack[ stack[--first] ] = false;
+         }
+         while ( stack[first] != index );
+         if ( stack.size() - first > 1 )
+         {
+            for ( PlanOrder::size_type member = first; member < stack.size(); ++member )
+               isInCycle[ stack[member] ] = true;
+         }
+         stack.resize( first );
+      }
    }
-   status += ")";
+}
 
-   fprintf( stdout, "%s\n", status.c_str() );
-   fflush( stdout );
-   if ( !assertions_.empty() )
+
+/// Appends the tests of \a order that have no pending prerequisite to \a readyTests.
+void
+LightTestRunner::selectReadyTests( const PlanOrder &order,
+                                   PlanOrder &readyTests ) const
+{
+   for ( PlanOrder::const_iterator it = order.begin(); it != order.end(); ++it )
    {
+      if ( pendingPrerequisites_[*it] == 0  &&  !results_[*it].hasRun_ )
+         readyTests.push_back( *it );
+   }
+}
 
-      CppTL::ConstString resultType = assertions_.back().kind() == Assertion::fault ? "fault" 
-                                                                                    : "assertion";
-      report_ += "-> " + getTestPath() + " : " + resultType + "\n";
-      //Assertions::const_iterator it = assertions_.begin();
-      //for ( ; it != assertions_.end(); ++it )
-      //   reportFailure( *it );
-      ResultElements::const_iterator it = results_.begin();
-      for ( ; it != results_.end(); ++it )
+
+/// Takes the next test whose prerequisites have all passed.
+/// @returns \c false if no such test is waiting to be run.
+bool
+LightTestRunner::takeReadyTest( PlanIndex &index )
+{
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   if ( readyTests_.empty() )
+      return false;
+   index = readyTests_.front();
+   readyTests_.pop_front();
+   return true;
+}
+
+
+/// Takes the next test to run in a worker process, preferring the tests requiring
+/// the same resources as its last test, then the tests whose resources were not
+/// used last by another worker process.
+bool
+LightTestRunner::takeReadyTest( PlanIndex &index,
+                                unsigned int resourceGroup,
+                                const std::vector<unsigned int> &claimedGroups )
+{
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   if ( readyTests_.empty() )
+      return false;
+   std::deque<PlanIndex>::iterator selected = readyTests_.end();
+   for ( std::deque<PlanIndex>::iterator it = readyTests_.begin(); it != readyTests_.end(); ++it )
+   {
+      unsigned int group = resourceGroups_[*it];
+      if ( group != 0  &&  group == resourceGroup )
       {
-         const ResultElement &result = *it;
-         if ( result.isLog_ )
-            reportLog( logs_[result.index_] );
-         else
-            reportFailure( assertions_[ result.index_ ] );
+         selected = it;
+         break;
+      }
+      if ( selected == readyTests_.end()  &&  (group == 0  ||
+           std::find( claimedGroups.begin(), claimedGroups.end(), group ) == claimedGroups.end()) )
+      {
+         selected = it;
+         if ( resourceGroup == 0 )
+            break;
       }
-      report_ += "\n";
    }
+   if ( selected == readyTests_.end() )
+      selected = readyTests_.begin();
+   index = *selected;
+   readyTests_.erase( selected );
+   return true;
+}
+
+
+bool
+LightTestRunner::hasReadyTests() const
+{
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   return !readyTests_.empty();
 }
 
-void 
-LightTestRunner::addResultLog( const Json::Value &log )
+
+/// Puts back a test that could not be started. It is the next test taken.
+void
+LightTestRunner::pushReadyTest( PlanIndex index )
 {
-   ResultElement element;
-   element.isLog_ = true;
-   element.index_ = int(logs_.size());
-   results_.push_back( element );
-   logs_.push_back( log );
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   readyTests_.push_front( index );
 }
 
 
-void 
-LightTestRunner::addResultAssertion( const Assertion &assertion )
+/// Returns \c true if some tests are waiting for the completion of their prerequisites.
+bool
+LightTestRunner::hasBlockedTests() const
 {
-   ResultElement element;
-   element.isLog_ = false;
-   element.index_ = int(assertions_.size());
-   results_.push_back( element );
-   assertions_.push_back( assertion );
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   return blockedCount_ > 0;
 }
 
 
-CppTL::ConstString
-LightTestRunner::getTestPath() const
+/// Stores the result of the test, then resolves it. The results are only
+/// written with resultLock_ held, as they are read by the other workers.
+void
+LightTestRunner::testCompleted( PlanIndex index,
+                                const TestResult &result )
 {
-   CppTL::StringBuffer buffer;
-   for ( TestPath::const_iterator it = testPath_.begin(); it != testPath_.end(); ++it )
-      buffer += "/" + *it;
-   return buffer;
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   results_[index] = result;
+   // Before resolving the test: a regressed benchmark skips its dependents.
+   if ( !benchmarkBaseline_.isNull() )
+      compareToBaseline( index );
+   resolveTest( index );
 }
 
 
-void 
-LightTestRunner::reportFailure( const Assertion &failure )
-{ // @todo duplicated in Assertion::toString().
-   if ( failure.location().isValid() )
+/// Marks the test as completed, then starts or skips its dependents depending
+/// on its outcome. resultLock_ must be held.
+void
+LightTestRunner::resolveTest( PlanIndex index )
+{
+   TestResult &result = results_[index];
+   result.hasRun_ = true;
+   if ( pendingPrerequisites_[index] > 0 ) // skipped or in a dependency cycle
    {
-      report_ += failure.location().file_;
-      report_ += "(" + CppTL::toString( failure.location().line_ ) + ") : ";
+      pendingPrerequisites_[index] = 0;
+      --blockedCount_;
    }
-   else
-      report_ += "unknwon failure location : ";
+   if ( stopOnFailure_  &&  result.status_.hasFailed() )
+      isStopRequested_ = true;
+
+   const bool hasPassed = !result.status_.hasFailed()  &&  !result.status_.wasSkipped();
+   const PlanOrder &dependents = dependents_[index];
+   for ( PlanOrder::const_iterator it = dependents.begin(); it != dependents.end(); ++it )
+   {
+      if ( results_[*it].hasRun_ )
+         continue;
+      if ( !hasPassed )
+         skipDependent( *it, index );
+      else if ( --pendingPrerequisites_[*it] == 0 )
+      {
+         --blockedCount_;
+         // Started before the other ready tests, while its prerequisites are fresh.
+         readyTests_.push_front( *it );
+      }
+   }
+}
+
+
+/// Skips a test whose prerequisite did not pass. resultLock_ must be held.
+void
+LightTestRunner::skipDependent( PlanIndex index,
+                                PlanIndex prerequisite )
+{
+   TestResult &result = results_[index];
+   result.status_.setStatus( TestStatus::skipped );
+   CppTL::StringBuffer report;
+   report += "-> " + plan_[index].path_ + " : skipped\n";
+   report += "Prerequisite " + plan_[prerequisite].path_ + " did not pass.\n\n";
+   result.report_ = report;
+   cancelReservedResources( index );
+   resolveTest( index );
+}
+
+
+bool
+LightTestRunner::isStopRequested() const
+{
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   return isStopRequested_;
+}
+
+
+bool
+LightTestRunner::hasRun( PlanIndex index ) const
+{
+   CppTL::Mutex::ScopedLockGuard guard( resultLock_ );
+   return results_[index].hasRun_;
+}
 
-   CppTL::ConstString failureType = failure.kind() == Assertion::fault ? "fault" 
-                                                                       : "assertion";
-   if ( failure.isIgnoredFailure() )
+
+void
+LightTestRunner::runTestsSerially()
+{
+   // The ready tests are run in the plan order.
+   PlanOrder order;
+   for ( PlanIndex index = 0; index < plan_.size(); ++index )
+      order.push_back( index );
+   PlanOrder initialTests;
+   selectReadyTests( order, initialTests );
+   std::set<PlanIndex> readyTests( initialTests.begin(), initialTests.end() );
+
+   ResultCollector collector;
+   PlanIndex index;
+   while ( !isStopRequested() )
    {
-      failureType = "*ignored* " + failureType;
-      ++ignoredFailureCount_;
+      while ( takeReadyTest( index ) )
+         readyTests.insert( index );
+      if ( readyTests.empty() )
+         break;
+      index = *readyTests.begin();
+      readyTests.erase( readyTests.begin() );
+      // Tests run ahead of their turn are only reported once their turn comes.
+      if ( index == reportCursor_ )
+         reporter_->testStarting( plan_[index].path_ );
+      runPlannedTest( index, collector );
+      reportCompletedResults();
    }
-   report_ += "[failure type: " + failureType + "]\n";
-   reportFailureDetail( failure.detail() );
-   report_ += "\n";
+   reportRemainingResults();
 }
 
 
-void 
-LightTestRunner::reportFailureDetail( const Json::Value &detail, 
-                                      int nestingLevel )
+void
+LightTestRunner::runTestsInParallel( unsigned int threadCount )
 {
-   Reindenter reindenter( report_ );
-   // Predicate name if any
-   if ( !detail["name"].isNull() )
+#if CPPTL_HAS_THREAD
+   // The queues only receive the tests without pending prerequisite. The other
+   // tests are handed to the workers as their prerequisites pass.
+   PlanOrder order;
+   const bool isLongestFirst = hasTimingHistory()  &&  !failedFirst_;
+   if ( isLongestFirst )
+      orderLongestFirst( order );
+   else
+   {
+      for ( PlanIndex index = 0; index < plan_.size(); ++index )
+         order.push_back( index );
+   }
+   PlanOrder readyTests;
+   selectReadyTests( order, readyTests );
+   const PlanIndex testCount = PlanIndex( readyTests.size() );
+
+   Worker::Queues queues;
+   for ( unsigned int queueIndex = 0; queueIndex < threadCount; ++queueIndex )
+      queues.push_back( new Worker::Queue() );
+   if ( failedFirst_ )
+   {
+      // Spreads the tests round-robin so that the first tests of the plan,
+      // the ones that failed in the last run, are started first.
+      for ( PlanIndex index = 0; index < testCount; ++index )
+         queues[ index % threadCount ]->push( readyTests[index] );
+   }
+   else if ( isLongestFirst )
    {
-      report_ += "predicate: " + detail["name"].asString() + "\n";
+      // Longest processing time first: each test goes to the queue with the lowest
+      // predicted duration so far. Workers run their longest tests first, while
+      // thieves steal the shortest ones.
+      std::vector<double> loads( threadCount, 0.0 );
+      for ( PlanOrder::const_iterator it = readyTests.begin(); it != readyTests.end(); ++it )
+      {
+         unsigned int queueIndex = 
+            (unsigned int)( std::min_element( loads.begin(), loads.end() ) - loads.begin() );
+         queues[queueIndex]->push( *it );
+         loads[queueIndex] += predictedDuration( *it );
+      }
    }
-   // Get assertion messages
-   const Json::Value &messages = detail["message"];
-   const int nbMessage = messages.size();
-   if ( nbMessage > 0 )
+   else
    {
-      report_ += nbMessage > 1 ? "Messages:\n"
-                               : "Message: ";
-      for ( int index = 0; index < nbMessage; ++index )
-         report_ += messages[index].asString() + "\n";
+      // Each worker starts with a contiguous slice of the plan, so that tests of
+      // the same suite tend to run in the same thread.
+      for ( PlanIndex index = 0; index < testCount; ++index )
+      {
+         unsigned int queueIndex = (unsigned int)( (unsigned long)index * threadCount / testCount );
+         queues[queueIndex]->push( readyTests[index] );
+      }
    }
-   // Compute max data name length
-   const Json::Value &data = detail["data"];
-   int nbDetailData = data.size();
-   int maxNameLength = 0;
-   for ( int indexLength = 0; indexLength < nbDetailData; ++indexLength )
+
+   Worker::Workers workers;
+   for ( unsigned int queueIndex = 0; queueIndex < threadCount; ++queueIndex )
    {
-      const int length = data[indexLength]["name"].asString().size();
-      maxNameLength = CPPTL_MAX( maxNameLength, length );
+      Worker *worker = new Worker( *this, queues, queueIndex );
+      if ( !worker->start() )
+      {
+         delete worker;
+         worker = 0;
+      }
+      workers.push_back( worker );
    }
-   // Aligned result data values
-   for ( int index = 0; index < nbDetailData; ++index )
+
+   // Watchdog: reports the completed tests, abandons the workers running a test
+   // past its time-out, and starts a new worker in their place to run the
+   // remaining tests.
+   for ( bool isRunning = true; isRunning; )
    {
-      std::string name = data[index]["name"].asString();
-      report_ += name;
-      report_ += std::string( maxNameLength - name.size(), ' ');
-      report_ += ": ";
-      // @todo nice conversion to string
-      report_ += data[index]["value"].toStyledString();
-      if ( report_[report_.length()-1] != '\n' )
-         report_ += "\n";
+      reportCompletedResults();
+      CppTL::Thread::sleep( watchdogPeriod );
+      isRunning = false;
+      const double now = CppTL::Clock::monotonic();
+      for ( unsigned int queueIndex = 0; queueIndex < threadCount; ++queueIndex )
+      {
+         Worker *worker = workers[queueIndex];
+         if ( worker == 0  ||  worker->isFinished() )
+            continue;
+         isRunning = true;
+         PlanIndex index;
+         if ( worker->abandonIfTimedOut( now, index ) )
+         {
+# if CPPUT_HAS_BACKTRACE
+            if ( dumpBacktrace_ )
+            {
+               fprintf( stderr, "Backtrace of timed out test %s:\n", plan_[index].path_.c_str() );
+               fflush( stderr );
+               worker->dumpBacktrace();
+               CppTL::Thread::sleep( backtraceDelay );
+            }
+# endif
+            recordTimeOut( index );
+            // The abandoned worker is leaked: its thread may never return.
+            worker = new Worker( *this, queues, queueIndex );
+            if ( !worker->start() )
+            {
+               delete worker;
+               worker = 0;
+            }
+            workers[queueIndex] = worker;
+         }
+      }
    }
-   // Reports composite assertions
-   const Json::Value &composites = detail["composite"];
-   const Json::Value::UInt nbComposite = composites.size();
-   for ( Json::Value::UInt indexComposite = 0; indexComposite < nbComposite; ++indexComposite )
+
+   for ( unsigned int queueIndex = 0; queueIndex < threadCount; ++queueIndex )
    {
-      const Json::Value &composite = composites[indexComposite];
-      CPPTL_ASSERT_MESSAGE( composite.size() == 1, "Composite must have a name" );
-      const char *compositeName = composite.begin().memberName();
-      const Json::Value &compositeDetail = *(composite.begin());
-      report_ += "context: ";
-      report_ += compositeName;
-      report_ += "\n";
-      reportFailureDetail( compositeDetail, nestingLevel + 1 );
+      if ( workers[queueIndex] != 0 )
+      {
+         // A worker whose thread can not be joined may still use its state.
+         if ( workers[queueIndex]->join() )
+            delete workers[queueIndex];
+         else
+            fprintf( stderr, "Failed to join worker thread %u.\n", queueIndex );
+      }
    }
-   if ( nestingLevel > 0 )
+
+   // Runs the tests left by the workers that could not be started.
+   ResultCollector collector;
+   for ( bool hasTest = true; hasTest  &&  !isStopRequested(); )
    {
-      reindenter.apply( std::string( 2, ' ' ) );
+      PlanIndex index;
+      hasTest = takeReadyTest( index );
+      for ( unsigned int queueIndex = 0; !hasTest  &&  queueIndex < threadCount; ++queueIndex )
+         hasTest = queues[queueIndex]->pop( index );
+      if ( hasTest )
+         runPlannedTest( index, collector );
    }
+   for ( unsigned int queueIndex = 0; queueIndex < threadCount; ++queueIndex )
+      delete queues[queueIndex];
+
+   reportRemainingResults();
+#else
+   runTestsSerially();
+#endif
 }
 
 
-void 
-LightTestRunner::reportLog( const Json::Value &log )
+void
+LightTestRunner::runTestsInProcesses( unsigned int processCount )
 {
-   report_ += "Log:\n";
-   if ( log.isConvertibleTo( Json::stringValue ) )
-      report_ += log.asString();
+#if CPPUT_HAS_FORK
+   const PlanIndex testCount = PlanIndex( plan_.size() );
+   if ( processCount > testCount )
+      processCount = testCount;
+
+   // A worker dying while the parent writes to its command pipe must not kill the parent.
+   void (*previousSigPipeHandler)(int) = signal( SIGPIPE, SIG_IGN );
+   // Pending output would otherwise be flushed by each child process.
+   fflush( stdout );
+   fflush( stderr );
+
+   // Tests are dispatched longest first if their duration is known. The tests
+   // with pending prerequisites are queued as the prerequisites pass.
+   PlanOrder order;
+   if ( hasTimingHistory()  &&  !failedFirst_ )
+      orderLongestFirst( order );
    else
-      report_ += log.toStyledString();
-   if ( report_[ report_.length() -1 ] != '\n' )
-      report_ += "\n\n";
+   {
+      for ( PlanIndex index = 0; index < testCount; ++index )
+         order.push_back( index );
+   }
+   PlanOrder readyTests;
+   selectReadyTests( order, readyTests );
+   for ( PlanOrder::const_iterator it = readyTests.begin(); it != readyTests.end(); ++it )
+      readyTests_.push_back( *it );
+
+   ProcessWorker::Workers workers;
+   for ( unsigned int workerIndex = 0; workerIndex < processCount; ++workerIndex )
+   {
+      ProcessWorker *worker = new ProcessWorker( *this );
+      workers.push_back( worker );
+      worker->spawn( workers );
+   }
+
+   std::vector<struct pollfd> pollFds;
+   std::vector<ProcessWorker *> polledWorkers;
+   for ( ;; )
+   {
+      // When stopping, only waits for the running tests.
+      const bool isStopped = isStopRequested();
+      bool hasBusyWorker = false;
+      std::vector<unsigned int> claimedGroups;
+      for ( ProcessWorker::Workers::iterator it = workers.begin(); it != workers.end(); ++it )
+      {
+         hasBusyWorker = hasBusyWorker  ||  (*it)->isBusy();
+         if ( (*it)->isAlive()  &&  (*it)->resourceGroup() != 0 )
+            claimedGroups.push_back( (*it)->resourceGroup() );
+      }
+      const bool hasTest = !isStopped  &&  hasReadyTests();
+      if ( !hasTest  &&  !hasBusyWorker )
+         break;
+      pollFds.clear();
+      polledWorkers.clear();
+      for ( ProcessWorker::Workers::iterator it = workers.begin(); it != workers.end(); ++it )
+      {
+         ProcessWorker &worker = **it;
+         if ( !worker.isAlive()  &&  hasTest )
+            worker.spawn( workers );   // replaces a dead worker
+         PlanIndex nextTest;
+         if ( worker.isIdle()  &&  !isStopped  
+              &&  takeReadyTest( nextTest, worker.resourceGroup(), claimedGroups ) )
+         {
+            if ( worker.sendTest( nextTest ) )
+               claimedGroups.push_back( worker.resourceGroup() );
+            else
+               pushReadyTest( nextTest );
+         }
+         if ( worker.isAlive() )
+         {
+            struct pollfd pollFd;
+            pollFd.fd = worker.resultFd();
+            pollFd.events = POLLIN;
+            pollFd.revents = 0;
+            pollFds.push_back( pollFd );
+            polledWorkers.push_back( &worker );
+         }
+      }
+
+      if ( pollFds.empty() ) // Failed to fork any worker, runs the remaining tests here
+      {
+         ResultCollector collector;
+         PlanIndex nextTest;
+         while ( !isStopRequested()  &&  takeReadyTest( nextTest ) )
+            runPlannedTest( nextTest, collector );
+         break;
+      }
+
+      int pollTimeOut = -1;
+      double now = CppTL::Clock::monotonic();
+      for ( unsigned int index = 0; index < polledWorkers.size(); ++index )
+      {
+         int remaining = polledWorkers[index]->remainingTime( now );
+         if ( remaining >= 0  &&  (pollTimeOut < 0  ||  remaining < pollTimeOut) )
+            pollTimeOut = remaining;
+      }
+      if ( poll( &pollFds[0], pollFds.size(), pollTimeOut ) < 0 )
+         continue;   // EINTR
+      for ( unsigned int index = 0; index < pollFds.size(); ++index )
+      {
+         if ( pollFds[index].revents != 0 )
+            polledWorkers[index]->readResults();
+      }
+      now = CppTL::Clock::monotonic();
+      for ( unsigned int index = 0; index < polledWorkers.size(); ++index )
+         polledWorkers[index]->killIfTimedOut( now );
+      reportCompletedResults();
+   }
+
+   for ( ProcessWorker::Workers::iterator it = workers.begin(); it != workers.end(); ++it )
+      delete *it;
+   signal( SIGPIPE, previousSigPipeHandler );
+
+   reportRemainingResults();
+#else
+   runTestsSerially();
+#endif
+}
+
+
+/// Reports the results of the tests completed since the last call, up to the
+/// first test of the plan still running.
+void
+LightTestRunner::reportCompletedResults()
+{
+   while ( reportCursor_ < plan_.size()  &&  hasRun( reportCursor_ ) )
+      reportTestResult( reportCursor_++ );
+}
+
+
+/// Reports the results of the remaining tests once all the workers are done.
+void
+LightTestRunner::reportRemainingResults()
+{
+   for ( ; reportCursor_ < plan_.size(); ++reportCursor_ )
+   {
+      if ( hasRun( reportCursor_ ) )
+         reportTestResult( reportCursor_ );
+      else
+         ++summary_.testNotRun_;
+   }
+}
+
+
+void
+LightTestRunner::runPlannedTest( PlanIndex index,
+                                 ResultCollector &collector )
+{
+   TestResult result;
+   runTest( plan_[index], repeat_, collector, result );
+   testCompleted( index, result );
+}
+
+
+void
+LightTestRunner::runTest( const PlannedTest &planned,
+                          const RepeatSettings &repeat,
+                          ResultCollector &collector,
+                          TestResult &result )
+{
+   if ( repeat.isEnabled() )
+   {
+      RepeatedTest repeatedTest( planned, repeat );
+      repeatedTest.run( collector, result );
+      return;
+   }
+   TestInfo &testInfo = TestInfo::threadInstance();
+   testInfo.setTestResultUpdater( collector );
+   collector.startTest();
+   double startTime = CppTL::Clock::monotonic();
+   planned.test_->runTest();
+
+   result.status_ = testInfo.testStatus();
+   result.status_.setStatistics( "duration", CppTL::Clock::monotonic() - startTime );
+   CppTL::StringBuffer report;
+   result.ignoredFailureCount_ = collector.formatReport( planned.path_, report );
+   result.report_ = report;
+   testInfo.removeTestResultUpdater();
+}
+
+
+void
+LightTestRunner::recordFault( PlanIndex index,
+                              const std::string &message )
+{
+   TestResult result;
+   makeFaultResult( index, message, result );
+   testCompleted( index, result );
+}
+
+
+/// Fills the result of a test failed by the runner rather than by its own code.
+void
+LightTestRunner::makeFaultResult( PlanIndex index,
+                                  const std::string &message,
+                                  TestResult &result ) const
+{
+   CheckerResult detail;
+   detail.setFailed();
+   detail.appendMessage( message );
+   Assertion fault( Assertion::fault );
+   fault.setDetail( detail );
+
+   ResultCollector collector;
+   collector.startTest();
+   collector.addResultAssertion( fault );
+
+   result.status_.setStatus( TestStatus::failed );
+   CppTL::StringBuffer report;
+   result.ignoredFailureCount_ = collector.formatReport( plan_[index].path_, report );
+   result.report_ = report;
+}
+
+
+double
+LightTestRunner::timeOutOf( PlanIndex index ) const
+{
+   double timeOut = plan_[index].test_->timeOut();
+   return timeOut > 0 ? timeOut : defaultTimeOut_;
+}
+
+
+void
+LightTestRunner::recordTimeOut( PlanIndex index )
+{
+   std::string message = "Test timed out after ";
+   message += CppTL::toString( timeOutOf( index ) ).c_str();
+   message += " seconds.";
+   TestResult result;
+   makeFaultResult( index, message, result );
+   // Remembered as a lower bound of the duration of the test.
+   result.status_.setStatistics( "duration", timeOutOf( index ) );
+   testCompleted( index, result );
+}
+
+
+void
+LightTestRunner::reportTestResult( PlanIndex index )
+{
+   TestResult &result = results_[index];
+   const TestStatus &testStatus = result.status_;
+   ++summary_.testRun_;
+   if ( testStatus.hasFailed() )
+      ++summary_.testFailed_;
+   else if ( testStatus.wasSkipped() )
+      ++summary_.testSkipped_;
+   summary_.assertionCount_ += testStatus.assertionCount();
+   summary_.ignoredFailureCount_ += result.ignoredFailureCount_;
+
+   reporter_->testCompleted( plan_[index].path_, testStatus, result.report_ );
+   // Only the counters are kept once the result has been reported.
+   result.report_ = CppTL::ConstString();
+   if ( slowestCount_ > 0 )
+      recordTiming( index );
 }
 
 
+/// Adds the test to the duration histogram, and to the slowest tests if it is
+/// slower than the ones already retained.
+void
+LightTestRunner::recordTiming( PlanIndex index )
+{
+   const Json::Value &statistics = results_[index].status_.statistics();
+   const Json::Value &duration = statistics["duration"];
+   if ( duration.isNull() )
+      return;
+   LightTestTimings::SlowTest test;
+   test.path_ = plan_[index].path_;
+   test.duration_ = duration.asDouble();
+   ++timings_.histogram_[ LightTestTimings::bucketOf( test.duration_ ) ];
+
+   LightTestTimings::SlowTests &slowest = timings_.slowest_;
+   if ( slowest.size() >= slowestCount_  &&  test.duration_ <= slowest.back().duration_ )
+      return;
+   test.timing_ = statistics["timing"];
+   LightTestTimings::SlowTests::iterator it = slowest.begin();
+   while ( it != slowest.end()  &&  it->duration_ >= test.duration_ )
+      ++it;
+   slowest.insert( it, test );
+   if ( slowest.size() > slowestCount_ )
+      slowest.pop_back();
+}
+
 
 } // namespace CppUT
@@ -0,0 +1,277 @@
+#include <cpput/perfcounters.h>
+#include <string.h>
+
+#if defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# define CPPUT_HAS_PERF_EVENT 1
+#endif
+
+#if defined(__unix__)  ||  defined(__APPLE__)
+# include <sys/resource.h>
+# include <sys/time.h>
+# define CPPUT_HAS_GETRUSAGE 1
+#endif
+
+namespace {
+
+   bool perfCountersEnabled = false;
+
+#if CPPUT_HAS_PERF_EVENT
+   /// Opens a disabled counter of the calling thread, in user space.
+   /// @returns -1 if the counter is not permitted or not supported.
+   int openCounter( CppUT::PerfCounter counter )
+   {
+      static const unsigned long long configs[CppUT::perfPageFaults] = {
+         PERF_COUNT_HW_CPU_CYCLES,
+         PERF_COUNT_HW_INSTRUCTIONS,
+         PERF_COUNT_HW_CACHE_MISSES,
+         PERF_COUNT_HW_BRANCH_MISSES
+      };
+      struct perf_event_attr attributes;
+      memset( &attributes, 0, sizeof(attributes) );
+      attributes.size = sizeof(attributes);
+      attributes.type = PERF_TYPE_HARDWARE;
+      attributes.config = configs[counter];
+      attributes.disabled = 1;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return int( syscall( __NR_perf_event_open, &attributes, 0, -1, -1, 0 ) );
+   }
+
+
+   /// Reads a counter, scaled up if the kernel multiplexed it with others.
+   bool readCounter( int descriptor,
+                     double &value )
+   {
+      unsigned long long data[3];   // value, time enabled, time running
+      if ( read( descriptor, data, sizeof(data) ) != sizeof(data) )
+         return false;
+      value = double( data[0] );
+      if ( data[2] != 0  &&  data[2] < data[1] )
+         value *= double( data[1] ) / double( data[2] );
+      return true;
+   }
+#endif
+
+} // end anonymous namespace
+
+
+namespace CppUT {
+
+const char *
+perfCounterName( PerfCounter counter )
+{
+   switch ( counter )
+   {
+   case perfCycles:
+      return "cycles";
+   case perfInstructions:
+      return "instructions";
+   case perfCacheMisses:
+      return "cache_misses";
+   case perfBranchMisses:
+      return "branch_misses";
+   case perfPageFaults:
+      return "page_faults";
+   case perfContextSwitches:
+      return "context_switches";
+   default:
+      return "unknown";
+   }
+}
+
+
+void
+setPerfCounters( bool enabled )
+{
+   perfCountersEnabled = enabled;
+}
+
+
+bool
+arePerfCountersEnabled()
+{
+   return perfCountersEnabled;
+}
+
+
+// Class PerfCounterValues
+// //////////////////////////////////////////////////////////////////
+
+PerfCounterValues::PerfCounterValues()
+   : isEmpty_( true )
+{
+   for ( int counter = 0; counter < perfCounterCount; ++counter )
+   {
+      values_[counter] = 0;
+      available_[counter] = false;
+   }
+}
+
+
+bool
+PerfCounterValues::isAvailable( PerfCounter counter ) const
+{
+   return available_[counter];
+}
+
+
+double
+PerfCounterValues::value( PerfCounter counter ) const
+{
+   return values_[counter];
+}
+
+
+void
+PerfCounterValues::set( PerfCounter counter,
+                        double value )
+{
+   values_[counter] = value;
+   available_[counter] = true;
+   isEmpty_ = false;
+}
+
+
+void
+PerfCounterValues::add( const PerfCounterValues &other )
+{
+   if ( isEmpty_ )
+   {
+      *this = other;
+      return;
+   }
+   for ( int counter = 0; counter < perfCounterCount; ++counter )
+   {
+      available_[counter] = available_[counter]  &&  other.available_[counter];
+      values_[counter] += other.values_[counter];
+   }
+}
+
+
+Json::Value
+PerfCounterValues::toJson( double divisor ) const
+{
+   Json::Value result( Json::objectValue );
+   for ( int counter = 0; counter < perfCounterCount; ++counter )
+   {
+      if ( available_[counter] )
+         result[perfCounterName( PerfCounter(counter) )] = values_[counter] / divisor;
+   }
+   if ( available_[perfCycles]  &&  available_[perfInstructions]  &&  values_[perfCycles] > 0 )
+      result["ipc"] = values_[perfInstructions] / values_[perfCycles];
+   return result;
+}
+
+
+// Class PerfCounters
+// //////////////////////////////////////////////////////////////////
+
+PerfCounters::PerfCounters()
+{
+   for ( int counter = 0; counter < perfPageFaults; ++counter )
+   {
+#if CPPUT_HAS_PERF_EVENT
+      descriptors_[counter] = openCounter( PerfCounter(counter) );
+#else
+      descriptors_[counter] = -1;
+#endif
+   }
+}
+
+
+PerfCounters::~PerfCounters()
+{
+#if CPPUT_HAS_PERF_EVENT
+   for ( int counter = 0; counter < perfPageFaults; ++counter )
+   {
+      if ( descriptors_[counter] >= 0 )
+         close( descriptors_[counter] );
+   }
+#endif
+}
+
+
+bool
+PerfCounters::hasHardwareCounters() const
+{
+   for ( int counter = 0; counter < perfPageFaults; ++counter )
+   {
+      if ( descriptors_[counter] >= 0 )
+         return true;
+   }
+   return false;
+}
+
+
+void
+PerfCounters::start()
+{
+   startUsage_ = readUsage();
+#if CPPUT_HAS_PERF_EVENT
+   for ( int counter = 0; counter < perfPageFaults; ++counter )
+   {
+      if ( descriptors_[counter] >= 0 )
+      {
+         ioctl( descriptors_[counter], PERF_EVENT_IOC_RESET, 0 );
+         ioctl( descriptors_[counter], PERF_EVENT_IOC_ENABLE, 0 );
+      }
+   }
+#endif
+}
+
+
+PerfCounterValues
+PerfCounters::stop()
+{
+   PerfCounterValues values;
+#if CPPUT_HAS_PERF_EVENT
+   for ( int counter = 0; counter < perfPageFaults; ++counter )
+   {
+      if ( descriptors_[counter] >= 0 )
+         ioctl( descriptors_[counter], PERF_EVENT_IOC_DISABLE, 0 );
+   }
+   for ( int counter = 0; counter < perfPageFaults; ++counter )
+   {
+      double value;
+      if ( descriptors_[counter] >= 0  &&  readCounter( descriptors_[counter], value ) )
+         values.set( PerfCounter(counter), value );
+   }
+#endif
+   PerfCounterValues usage = readUsage();
+   for ( int counter = perfPageFaults; counter < perfCounterCount; ++counter )
+   {
+      if ( usage.isAvailable( PerfCounter(counter) ) )
+         values.set( PerfCounter(counter), usage.value( PerfCounter(counter) )
+                                           - startUsage_.value( PerfCounter(counter) ) );
+   }
+   return values;
+}
+
+
+PerfCounterValues
+PerfCounters::readUsage() const
+{
+   PerfCounterValues usage;
+#if CPPUT_HAS_GETRUSAGE
+   struct rusage resources;
+# if defined(RUSAGE_THREAD)
+   const int who = RUSAGE_THREAD;
+# else
+   const int who = RUSAGE_SELF;
+# endif
+   if ( getrusage( who, &resources ) == 0 )
+   {
+      usage.set( perfPageFaults, double( resources.ru_minflt + resources.ru_majflt ) );
+      usage.set( perfContextSwitches, double( resources.ru_nvcsw + resources.ru_nivcsw ) );
+   }
+#endif
+   return usage;
+}
+
+
+} // namespace CppUT
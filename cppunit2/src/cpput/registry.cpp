@@ -1,8 +1,16 @@
 #include <cpput/testing.h>
+#include <cpput/allocationtracker.h>
 #include <cpput/translate.h>
+#include <cpptl/clock.h>
 #include <cpptl/scopedptr.h>
+#include <cpptl/stringtools.h>
 #include <cpptl/thread.h>
+#include <algorithm>
 #include <deque>
+#include <map>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
 
 
 
@@ -12,6 +20,78 @@ namespace CppUT {
 namespace Impl {
    //typedef volatile unsigned int ReferenceCounter;
 
+   // Head of the list of TestDescriptorLink. Zero-initialized before any
+   // static constructor runs.
+   static TestDescriptor *testDescriptors;
+
+
+// class RegistrationProfiler
+// //////////////////////////////////////////////////////////////////
+
+   /* Measures the static initialization of the tests, when the environment
+    * variable CPPUT_PROFILE_REGISTRATION is set or when enabled by
+    * Registry::setRegistrationProfiling().
+    * The time elapsed and the allocations made since the previous registration
+    * are attributed to the suite of each registration. They include the
+    * construction of the registered tests by the static initializers of the
+    * translation unit.
+    */
+   class RegistrationProfiler
+   {
+   public:
+      RegistrationProfiler();
+
+      bool isEnabled() const;
+
+      // Returns the previous state.
+      bool setEnabled( bool enabled );
+
+      // Returns true if the environment variable asks for the profile to be printed.
+      bool isPrinted() const;
+
+      // Records the registration of tests, the creation or the reparenting of
+      // a suite. testName is the name of the test if only one is registered.
+      void record( SuiteImpl *suite,
+                   unsigned int testCount,
+                   unsigned int createdSuiteCount,
+                   unsigned int reparentCount,
+                   const std::string &testName = std::string() );
+
+      // Prints the slowest suites to register.
+      void print() const;
+
+      const RegistrationProfile &entries() const;
+
+   private:
+      struct SuiteProfile
+      {
+         SuiteProfile();
+
+         double duration_;
+         double allocationCount_;
+         double allocatedBytes_;
+         unsigned int testCount_;
+         unsigned int createdSuiteCount_;
+         unsigned int reparentCount_;
+      };
+
+      typedef std::map<SuiteImpl *,SuiteProfile> SuiteProfiles;
+      typedef std::pair<double,SuiteImpl *> SuiteByDuration;
+
+      static std::string suitePath( const SuiteImpl *suite );
+
+      SuiteProfiles profiles_;
+      SuiteProfile total_;
+      RegistrationProfile entries_;
+      double lastTime_;
+      AllocationCounters lastAllocations_;
+      unsigned int printedSuiteCount_;
+      bool isEnabled_;
+      bool isPrinted_;
+   };
+
+
+
 // class RegistryImpl
 // //////////////////////////////////////////////////////////////////
 
@@ -63,6 +143,10 @@ namespace Impl {
       std::string suiteName( SuiteImpl *suite ) const;
       void addSuiteTestCase( SuiteImpl *suite, 
                              const TestMeta &testCase );
+      void addSuiteTestCases( SuiteImpl *suite,
+                              const std::vector<TestMeta> &testCases );
+      void addSuiteFixture( SuiteImpl *suite,
+                            const std::string &resourceName );
       int nestedSuiteCount( SuiteImpl *suite ) const;
       Suite nestedSuiteAt( SuiteImpl *suite, 
                            int index ) const;
@@ -76,9 +160,37 @@ namespace Impl {
       TestMeta *suiteTestCaseAt( SuiteImpl *suite, int index ) const;
       Suite getParentSuite( SuiteImpl *suite ) const;
 
+      void snapshot( const Suite &rootSuite,
+                     FrozenRegistry &registry ) const;
+      void requireSuiteFixtures( const Suite &suite,
+                                 TestMeta &testCase ) const;
+      const FrozenRegistry &freeze();
+      bool isFrozen() const;
+
+      bool setRegistrationProfiling( bool enabled );
+      RegistrationProfile registrationProfile() const;
+
       std::string dump() const;
 
    private:
+      // Returns the suite of the packed path relative to parentSuite, creating
+      // the missing suites. Must be called with lock_ held.
+      SuiteImpl *makeNestedSuites( SuiteImpl *parentSuite,
+                                   const std::string &packedName,
+                                   unsigned int &createdSuiteCount );
+
+      // Adds the tests described by the TestDescriptor list to their suite.
+      // Must be called with lock_ held.
+      void addDescribedTests();
+
+      // Must be called with lock_ held.
+      void fillSnapshot( SuiteImpl *rootSuite,
+                         FrozenRegistry &registry ) const;
+
+      // Asserts that the suite is not part of the frozen snapshot.
+      // Must be called with lock_ held.
+      void checkNotFrozen( SuiteImpl *suite ) const;
+
       mutable CppTL::Mutex lock_;
       typedef std::set<SuiteImpl *> OrphanedSuites;
       OrphanedSuites orphanedSuites_;
@@ -88,6 +200,8 @@ namespace Impl {
       SuiteMeta rootSuiteMeta_;
       SuiteImpl *defaultRootSuite_;
       SuiteImpl *currentParentSuite_;
+      CppTL::ScopedPtr<FrozenRegistry> frozen_;
+      RegistrationProfiler profiler_;
    };
 
 
@@ -99,28 +213,61 @@ namespace Impl {
    {
       // Notes: all access must go through RegistryImpl to guaranty thread-safety
       friend class RegistryImpl;
+      friend class RegistrationProfiler;
    public:
       ~SuiteImpl();
    private:
       typedef std::deque<TestMeta> TestCases;
       typedef std::vector<SuiteImpl *> NestedSuites;
+      typedef std::vector<const TestDescriptor *> TestDescriptors;
+
+      enum {
+         // The nested suites are looked up by name in a hash table once
+         // there are that many, in a linear search otherwise.
+         minIndexedNestedSuiteCount = 8
+      };
 
       explicit SuiteImpl( const std::string &name,
                           SuiteImpl *parentSuite );
 
       // Returns the matching nested suite if found, NULL otherwise.
       SuiteImpl *nestedSuiteByName( const std::string &name ) const;
+      SuiteImpl *nestedSuiteByName( const char *name,
+                                    size_t length ) const;
+
+      bool hasName( const char *name,
+                    size_t length ) const;
+
+      void addNestedSuite( SuiteImpl *nestedSuite );
 
       void removeNestedSuite( SuiteImpl *suiteToRemove );
 
+      void indexNestedSuite( SuiteImpl *nestedSuite );
+
+      void rebuildNestedSuiteIndex();
+
       // Remove childSuite from its current parent and adds it to this suite.
       void reparent( SuiteImpl *childSuite );
 
+      // Makes the test cases of this suite and of its nested suites require the resource.
+      void requireFixture( const std::string &resourceName );
+
+      // Makes the test case require the fixtures of this suite and of its parent suites.
+      void requireFixtures( TestMeta &testCase ) const;
+
       void dump() const;
 
       NestedSuites nestedSuites_;
+      /// Hash table of the nested suites by name, using open addressing.
+      /// Its size is a power of 2, and 0 below minIndexedNestedSuiteCount.
+      NestedSuites nestedSuitesByName_;
       TestCases testCases_;
+      /// Tests whose TestMeta is created by FrozenRegistry::testMetaAt().
+      TestDescriptors testDescriptors_;
+      /// Names of the resources shared by all the tests of the suite.
+      std::vector<std::string> fixtures_;
       const CppTL::ConstString name_;
+      const unsigned int nameHash_;
       SuiteImpl *parentSuite_;
       //ReferenceCounter refCount_;
    };
@@ -208,9 +355,6 @@ namespace Impl {
    RegistryImpl::addRootSuite( const std::string &packedName )
    {
       CPPUT_CHECK_REGISTRY_VALID();
-      Slices slices;
-      splitPackedName( packedName, slices );
-
       SuiteImpl *parentSuite = 0;
       {
          CppTL::Mutex::ScopedLockGuard guard( lock_ );
@@ -224,30 +368,50 @@ namespace Impl {
             printf( "Creating suite rooted to top root: %s\n", packedName.c_str() );
             parentSuite = rootSuite_.get();
          }
-         Slices::iterator itEnd = slices.end();
-         for ( Slices::iterator it = slices.begin(); it != itEnd; ++it )
+         unsigned int createdSuiteCount = 0;
+         parentSuite = makeNestedSuites( parentSuite, packedName, createdSuiteCount );
+         if ( profiler_.isEnabled() )
+            profiler_.record( parentSuite, 0, createdSuiteCount, 0 );
+      }
+      return SuiteMeta( parentSuite );
+   }
+
+
+   SuiteImpl *
+   RegistryImpl::makeNestedSuites( SuiteImpl *parentSuite,
+                                   const std::string &packedName,
+                                   unsigned int &createdSuiteCount )
+   {
+      Slices slices;
+      splitPackedName( packedName, slices );
+      Slices::iterator itEnd = slices.end();
+      for ( Slices::iterator it = slices.begin(); it != itEnd; ++it )
+      {
+         SuiteImpl *nestedSuite = parentSuite->nestedSuiteByName( 
+            packedName.c_str() + it->first, it->second );
+         if ( nestedSuite != 0 )
+         {
+            parentSuite = nestedSuite;
+         }
+         else
          {
-            std::string name = packedName.substr( it->first, it->second );
-            SuiteImpl *nestedSuite = parentSuite->nestedSuiteByName( name );
-            if ( nestedSuite != 0 )
-            {
-               parentSuite = nestedSuite;
-            }
-            else
-            {
-               // Parent takes the ownership of the created suite
-               parentSuite = new SuiteImpl( name, parentSuite );
-            }
+            checkNotFrozen( parentSuite );
+            // Parent takes the ownership of the created suite
+            parentSuite = new SuiteImpl( packedName.substr( it->first, it->second ), 
+                                         parentSuite );
+            ++createdSuiteCount;
          }
       }
-      return SuiteMeta( parentSuite );
+      return parentSuite;
    }
 
+
    SuiteImpl *
    RegistryImpl::createOrphanedSuite( const std::string &name )
    {
       CPPUT_CHECK_REGISTRY_VALID();
       SuiteImpl *suite = new SuiteImpl( name, 0 );
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
       orphanedSuites_.insert( suite );
       return suite;
    }
@@ -274,7 +438,41 @@ namespace Impl {
    {
       CPPUT_CHECK_REGISTRY_VALID();
       CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      checkNotFrozen( suite );
       suite->testCases_.push_back( testCase );
+      suite->requireFixtures( suite->testCases_.back() );
+      if ( profiler_.isEnabled() )
+         profiler_.record( suite, 1, 0, 0, testCase.name() );
+   }
+
+
+   void
+   RegistryImpl::addSuiteTestCases( SuiteImpl *suite,
+                                    const std::vector<TestMeta> &testCases )
+   {
+      CPPUT_CHECK_REGISTRY_VALID();
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      checkNotFrozen( suite );
+      std::vector<TestMeta>::const_iterator itEnd = testCases.end();
+      for ( std::vector<TestMeta>::const_iterator it = testCases.begin(); it != itEnd; ++it )
+      {
+         suite->testCases_.push_back( *it );
+         suite->requireFixtures( suite->testCases_.back() );
+      }
+      if ( profiler_.isEnabled() )
+         profiler_.record( suite, (unsigned int)testCases.size(), 0, 0 );
+   }
+
+
+   void 
+   RegistryImpl::addSuiteFixture( SuiteImpl *suite,
+                                  const std::string &resourceName )
+   {
+      CPPUT_CHECK_REGISTRY_VALID();
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      checkNotFrozen( suite );
+      suite->fixtures_.push_back( resourceName );
+      suite->requireFixture( resourceName );
    }
 
 
@@ -327,7 +525,10 @@ namespace Impl {
          nestedSuite = suite->nestedSuiteByName( name );
          if ( nestedSuite == 0 ) // create the suite
          {
+            checkNotFrozen( suite );
             nestedSuite = new SuiteImpl( name, suite );
+            if ( profiler_.isEnabled() )
+               profiler_.record( nestedSuite, 0, 1, 0 );
          }
       }
       return Suite( nestedSuite );
@@ -341,6 +542,9 @@ namespace Impl {
       CPPUT_CHECK_REGISTRY_VALID();
       CPPTL_ASSERT_MESSAGE( parentSuite.impl_ != 0  &&  suite.impl_ != 0, 
          "Attempting to reparent invalid suites." );
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      checkNotFrozen( parentSuite.impl_ );
+      checkNotFrozen( suite.impl_ );
       if ( suite.impl_->parentSuite_ == 0 )  // if orphan, remove from orphan list
       {
          orphanedSuites_.erase( suite.impl_ );
@@ -350,6 +554,8 @@ namespace Impl {
       {
          orphanedSuites_.insert( suite.impl_ );
       }
+      if ( profiler_.isEnabled() )
+         profiler_.record( suite.impl_, 0, 0, 1 );
    }
 
 
@@ -383,6 +589,176 @@ namespace Impl {
    }
 
 
+   void
+   RegistryImpl::snapshot( const Suite &rootSuite,
+                           FrozenRegistry &registry ) const
+   {
+      CPPUT_CHECK_REGISTRY_VALID();
+      if ( rootSuite.impl_ == 0 )
+         return;
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      fillSnapshot( rootSuite.impl_, registry );
+   }
+
+
+   const FrozenRegistry &
+   RegistryImpl::freeze()
+   {
+      CPPUT_CHECK_REGISTRY_VALID();
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      if ( frozen_.get() == 0 )
+      {
+         // Static initialization is over.
+         addDescribedTests();
+         if ( profiler_.isPrinted() )
+            profiler_.print();
+         frozen_.reset( new FrozenRegistry() );
+         fillSnapshot( rootSuite_.get(), *frozen_ );
+      }
+      return *frozen_;
+   }
+
+
+   void
+   RegistryImpl::requireSuiteFixtures( const Suite &suite,
+                                       TestMeta &testCase ) const
+   {
+      CPPUT_CHECK_REGISTRY_VALID();
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      suite.impl_->requireFixtures( testCase );
+   }
+
+
+   void
+   RegistryImpl::addDescribedTests()
+   {
+      // The list is in the reverse order of the static initialization.
+      std::vector<const TestDescriptor *> descriptors;
+      for ( const TestDescriptor *descriptor = testDescriptors; descriptor != 0; descriptor = descriptor->next_ )
+         descriptors.push_back( descriptor );
+      SuiteImpl *suite = 0;
+      const char *suitePath = 0;
+      std::vector<const TestDescriptor *>::reverse_iterator itEnd = descriptors.rend();
+      for ( std::vector<const TestDescriptor *>::reverse_iterator it = descriptors.rbegin(); it != itEnd; ++it )
+      {
+         // Consecutive tests usually share their suite.
+         if ( suitePath == 0  ||  strcmp( suitePath, (*it)->suitePath_ ) != 0 )
+         {
+            unsigned int createdSuiteCount = 0;
+            suitePath = (*it)->suitePath_;
+            suite = makeNestedSuites( rootSuite_.get(), suitePath, createdSuiteCount );
+         }
+         suite->testDescriptors_.push_back( *it );
+      }
+   }
+
+
+   bool
+   RegistryImpl::isFrozen() const
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      return frozen_.get() != 0;
+   }
+
+
+   bool
+   RegistryImpl::setRegistrationProfiling( bool enabled )
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      return profiler_.setEnabled( enabled );
+   }
+
+
+   RegistrationProfile
+   RegistryImpl::registrationProfile() const
+   {
+      CppTL::Mutex::ScopedLockGuard guard( lock_ );
+      return profiler_.entries();
+   }
+
+
+   void
+   RegistryImpl::fillSnapshot( SuiteImpl *rootSuite,
+                               FrozenRegistry &registry ) const
+   {
+      std::string rootPath;
+      for ( SuiteImpl *suite = rootSuite; suite != 0; suite = suite->parentSuite_ )
+         rootPath = "/" + suite->name_.str() + rootPath;
+
+      FrozenRegistry::SuiteEntry root;
+      root.suite_ = Suite( rootSuite );
+      root.name_ = rootSuite->name_;
+      root.path_ = rootPath;
+      root.parent_ = -1;
+      registry.suites_.push_back( root );
+      // Breadth-first, the nested suites of each suite are appended in turn.
+      std::vector<SuiteImpl *> suites( 1, rootSuite );
+      for ( int index = 0; index < int(suites.size()); ++index )
+      {
+         SuiteImpl *suite = suites[index];
+         registry.indexes_[ Suite( suite ) ] = index;
+         const std::string path = registry.suites_[index].path_.str();
+
+         const int firstNestedSuite = int(registry.suites_.size());
+         SuiteImpl::NestedSuites::const_iterator itEnd = suite->nestedSuites_.end();
+         for ( SuiteImpl::NestedSuites::const_iterator it = suite->nestedSuites_.begin();
+               it != itEnd;
+               ++it )
+         {
+            FrozenRegistry::SuiteEntry entry;
+            entry.suite_ = Suite( *it );
+            entry.name_ = (*it)->name_;
+            entry.path_ = path + "/" + (*it)->name_.str();
+            entry.parent_ = index;
+            registry.suites_.push_back( entry );
+            suites.push_back( *it );
+         }
+
+         const int firstTest = int(registry.tests_.size());
+         SuiteImpl::TestCases::const_iterator itTestEnd = suite->testCases_.end();
+         for ( SuiteImpl::TestCases::const_iterator itTest = suite->testCases_.begin();
+               itTest != itTestEnd;
+               ++itTest )
+         {
+            FrozenRegistry::TestEntry entry;
+            entry.test_ = &*itTest;
+            entry.descriptor_ = 0;
+            entry.name_ = itTest->internedName();
+            entry.path_ = path + "/" + entry.name_.str();
+            entry.suite_ = index;
+            registry.tests_.push_back( entry );
+         }
+         SuiteImpl::TestDescriptors::const_iterator itDescriptorEnd = suite->testDescriptors_.end();
+         for ( SuiteImpl::TestDescriptors::const_iterator itDescriptor = suite->testDescriptors_.begin();
+               itDescriptor != itDescriptorEnd;
+               ++itDescriptor )
+         {
+            FrozenRegistry::TestEntry entry;
+            entry.test_ = 0;
+            entry.descriptor_ = *itDescriptor;
+            entry.name_ = (*itDescriptor)->name_;
+            entry.path_ = path + "/" + (*itDescriptor)->name_;
+            entry.suite_ = index;
+            registry.tests_.push_back( entry );
+         }
+
+         FrozenRegistry::SuiteEntry &entry = registry.suites_[index];
+         entry.firstNestedSuite_ = firstNestedSuite;
+         entry.endNestedSuite_ = int(registry.suites_.size());
+         entry.firstTest_ = firstTest;
+         entry.endTest_ = int(registry.tests_.size());
+      }
+   }
+
+
+   void
+   RegistryImpl::checkNotFrozen( SuiteImpl *suite ) const
+   {
+      CPPTL_ASSERT_MESSAGE( frozen_.get() == 0  ||  frozen_->indexOf( Suite( suite ) ) < 0,
+         "Attempting to modify a suite after Registry::freeze()!" );
+   }
+
+
    //void 
    //RegistryImpl::addMetaReference( Impl::SuiteId suiteId )
    //{
@@ -506,19 +882,175 @@ namespace Impl {
 
 
 
+// implementation of class RegistrationProfiler
+// //////////////////////////////////////////////////////////////////
+
+   RegistrationProfiler::SuiteProfile::SuiteProfile()
+      : duration_( 0 )
+      , allocationCount_( 0 )
+      , allocatedBytes_( 0 )
+      , testCount_( 0 )
+      , createdSuiteCount_( 0 )
+      , reparentCount_( 0 )
+   {
+   }
+
+
+   RegistrationProfiler::RegistrationProfiler()
+      : lastTime_( 0 )
+      , printedSuiteCount_( 20 )
+      , isEnabled_( false )
+      , isPrinted_( false )
+   {
+      const char *value = getenv( "CPPUT_PROFILE_REGISTRATION" );
+      if ( value != 0  &&  *value != 0 )
+      {
+         isPrinted_ = true;
+         if ( atoi( value ) > 1 )
+            printedSuiteCount_ = atoi( value );
+         setEnabled( true );
+      }
+   }
+
+
+   bool
+   RegistrationProfiler::isEnabled() const
+   {
+      return isEnabled_;
+   }
+
+
+   bool
+   RegistrationProfiler::setEnabled( bool enabled )
+   {
+      const bool wasEnabled = isEnabled_;
+      isEnabled_ = enabled;
+      if ( enabled  &&  !wasEnabled )
+      {
+         lastTime_ = CppTL::Clock::monotonic();
+         lastAllocations_ = threadAllocationCounters();
+      }
+      return wasEnabled;
+   }
+
+
+   bool
+   RegistrationProfiler::isPrinted() const
+   {
+      return isPrinted_;
+   }
+
+
+   const RegistrationProfile &
+   RegistrationProfiler::entries() const
+   {
+      return entries_;
+   }
+
+
+   void
+   RegistrationProfiler::record( SuiteImpl *suite,
+                                 unsigned int testCount,
+                                 unsigned int createdSuiteCount,
+                                 unsigned int reparentCount,
+                                 const std::string &testName )
+   {
+      const double now = CppTL::Clock::monotonic();
+      const AllocationCounters allocations = threadAllocationCounters();
+      SuiteProfile delta;
+      delta.duration_ = now - lastTime_;
+      delta.allocationCount_ = double( allocations.allocationCount_ - lastAllocations_.allocationCount_ );
+      delta.allocatedBytes_ = double( allocations.allocatedBytes_ - lastAllocations_.allocatedBytes_ );
+      delta.testCount_ = testCount;
+      delta.createdSuiteCount_ = createdSuiteCount;
+      delta.reparentCount_ = reparentCount;
+      {
+         AllocationTrackingPause pause;
+         SuiteProfile *profiles[2] = { &profiles_[suite], &total_ };
+         for ( int index = 0; index < 2; ++index )
+         {
+            SuiteProfile &profile = *profiles[index];
+            profile.duration_ += delta.duration_;
+            profile.allocationCount_ += delta.allocationCount_;
+            profile.allocatedBytes_ += delta.allocatedBytes_;
+            profile.testCount_ += delta.testCount_;
+            profile.createdSuiteCount_ += delta.createdSuiteCount_;
+            profile.reparentCount_ += delta.reparentCount_;
+         }
+         RegistrationProfileEntry entry;
+         entry.suitePath_ = suitePath( suite );
+         entry.testName_ = testName;
+         entry.testCount_ = delta.testCount_;
+         entry.createdSuiteCount_ = delta.createdSuiteCount_;
+         entry.reparentCount_ = delta.reparentCount_;
+         entry.duration_ = delta.duration_;
+         entry.allocationCount_ = delta.allocationCount_;
+         entry.allocatedBytes_ = delta.allocatedBytes_;
+         entries_.push_back( entry );
+      }
+      // The time spent recording is not attributed to any registration.
+      lastTime_ = CppTL::Clock::monotonic();
+      lastAllocations_ = allocations;
+   }
+
+
+   void
+   RegistrationProfiler::print() const
+   {
+      printf( "Registration profile: %u tests and %u suites registered in %.3fms",
+              total_.testCount_, total_.createdSuiteCount_, total_.duration_ * 1e3 );
+      if ( areAllocationHooksInstalled() )
+         printf( ", %.0f allocations of %.0f bytes.\n", total_.allocationCount_, total_.allocatedBytes_ );
+      else
+         printf( " (link with cpput_allocationhooks to count the allocations).\n" );
+
+      std::vector<SuiteByDuration> suites;
+      for ( SuiteProfiles::const_iterator it = profiles_.begin(); it != profiles_.end(); ++it )
+         suites.push_back( SuiteByDuration( it->second.duration_, it->first ) );
+      std::sort( suites.begin(), suites.end() );
+      std::reverse( suites.begin(), suites.end() );
+      if ( suites.size() > printedSuiteCount_ )
+         suites.resize( printedSuiteCount_ );
+
+      printf( "  %10s %8s %7s %12s %12s  %s\n", 
+              "time", "tests", "suites", "allocations", "bytes", "suite" );
+      for ( std::vector<SuiteByDuration>::const_iterator it = suites.begin(); it != suites.end(); ++it )
+      {
+         const SuiteProfile &profile = profiles_.find( it->second )->second;
+         printf( "  %8.3fms %8u %7u %12.0f %12.0f  %s%s\n",
+                 profile.duration_ * 1e3, profile.testCount_, profile.createdSuiteCount_,
+                 profile.allocationCount_, profile.allocatedBytes_,
+                 suitePath( it->second ).c_str(),
+                 profile.reparentCount_ > 0 ? " (reparented)" : "" );
+      }
+   }
+
+
+   std::string
+   RegistrationProfiler::suitePath( const SuiteImpl *suite )
+   {
+      std::string path;
+      for ( ; suite != 0; suite = suite->parentSuite_ )
+         path = "/" + suite->name_.str() + path;
+      return path;
+   }
+
+
+
 // implementation of class SuiteImpl
 // //////////////////////////////////////////////////////////////////
 
    SuiteImpl::SuiteImpl( const std::string &name,
                          SuiteImpl *parentSuite )
       : name_( name )
+      , nameHash_( CppTL::stableHash( name_ ) )
       , parentSuite_( parentSuite )
    {
       if ( parentSuite != 0 )
       {
          CPPTL_ASSERT_MESSAGE( parentSuite != this,
                                "Suite can not parent itself." );
-         parentSuite->nestedSuites_.push_back( this );
+         parentSuite->addNestedSuite( this );
       }
    }
 
@@ -538,13 +1070,38 @@ namespace Impl {
    SuiteImpl *
    SuiteImpl::nestedSuiteByName( const std::string &name ) const
    {
-      NestedSuites::const_iterator itEnd = nestedSuites_.end();
-      for ( NestedSuites::const_iterator it = nestedSuites_.begin();
-            it != itEnd;
-            ++it )
+      return nestedSuiteByName( name.c_str(), name.length() );
+   }
+
+
+   SuiteImpl *
+   SuiteImpl::nestedSuiteByName( const char *name,
+                                 size_t length ) const
+   {
+      if ( nestedSuitesByName_.empty() )
       {
-         SuiteImpl *nestedSuite = *it;
-         if ( nestedSuite->name_ == name )
+         NestedSuites::const_iterator itEnd = nestedSuites_.end();
+         for ( NestedSuites::const_iterator it = nestedSuites_.begin();
+               it != itEnd;
+               ++it )
+         {
+            SuiteImpl *nestedSuite = *it;
+            if ( nestedSuite->hasName( name, length ) )
+            {
+               return nestedSuite;
+            }
+         }
+         return 0;
+      }
+
+      const unsigned int hash = CppTL::stableHash( name, name + length );
+      const unsigned int mask = (unsigned int)(nestedSuitesByName_.size() - 1);
+      for ( unsigned int slot = hash & mask; 
+            nestedSuitesByName_[slot] != 0; 
+            slot = (slot + 1) & mask )
+      {
+         SuiteImpl *nestedSuite = nestedSuitesByName_[slot];
+         if ( nestedSuite->nameHash_ == hash  &&  nestedSuite->hasName( name, length ) )
          {
             return nestedSuite;
          }
@@ -553,6 +1110,30 @@ namespace Impl {
    }
 
 
+   bool
+   SuiteImpl::hasName( const char *name,
+                       size_t length ) const
+   {
+      return name_.length() == length  &&  memcmp( name_.c_str(), name, length ) == 0;
+   }
+
+
+   void
+   SuiteImpl::addNestedSuite( SuiteImpl *nestedSuite )
+   {
+      nestedSuites_.push_back( nestedSuite );
+      // Keeps the table at most half full.
+      if ( nestedSuites_.size() * 2 > nestedSuitesByName_.size() )
+      {
+         rebuildNestedSuiteIndex();
+      }
+      else
+      {
+         indexNestedSuite( nestedSuite );
+      }
+   }
+
+
    void 
    SuiteImpl::removeNestedSuite( SuiteImpl *suiteToRemove )
    {
@@ -565,6 +1146,7 @@ namespace Impl {
          if ( nestedSuite == suiteToRemove )
          {
             nestedSuites_.erase( it );
+            rebuildNestedSuiteIndex();
             return;
          }
       }
@@ -573,6 +1155,43 @@ namespace Impl {
    }
 
 
+   void
+   SuiteImpl::indexNestedSuite( SuiteImpl *nestedSuite )
+   {
+      const unsigned int mask = (unsigned int)(nestedSuitesByName_.size() - 1);
+      unsigned int slot = nestedSuite->nameHash_ & mask;
+      while ( nestedSuitesByName_[slot] != 0 )
+      {
+         slot = (slot + 1) & mask;
+      }
+      nestedSuitesByName_[slot] = nestedSuite;
+   }
+
+
+   void
+   SuiteImpl::rebuildNestedSuiteIndex()
+   {
+      nestedSuitesByName_.clear();
+      if ( nestedSuites_.size() < minIndexedNestedSuiteCount )
+      {
+         return;
+      }
+      NestedSuites::size_type tableSize = 4 * minIndexedNestedSuiteCount;
+      while ( tableSize < 4 * nestedSuites_.size() )
+      {
+         tableSize *= 2;
+      }
+      nestedSuitesByName_.resize( tableSize, 0 );
+      NestedSuites::const_iterator itEnd = nestedSuites_.end();
+      for ( NestedSuites::const_iterator it = nestedSuites_.begin();
+            it != itEnd;
+            ++it )
+      {
+         indexNestedSuite( *it );
+      }
+   }
+
+
    void 
    SuiteImpl::reparent( SuiteImpl *childSuite )
    {
@@ -589,7 +1208,55 @@ namespace Impl {
          childSuite->parentSuite_->removeNestedSuite( childSuite );
       }
       childSuite->parentSuite_ = this;
-      nestedSuites_.push_back( childSuite );
+      addNestedSuite( childSuite );
+      // The tests of the child suite now also depend on the fixtures of its new parents.
+      for ( const SuiteImpl *suite = this; suite != 0; suite = suite->parentSuite_ )
+      {
+         std::vector<std::string>::const_iterator itEnd = suite->fixtures_.end();
+         for ( std::vector<std::string>::const_iterator it = suite->fixtures_.begin();
+               it != itEnd;
+               ++it )
+         {
+            childSuite->requireFixture( *it );
+         }
+      }
+   }
+
+
+   void
+   SuiteImpl::requireFixture( const std::string &resourceName )
+   {
+      TestCases::iterator itTestEnd = testCases_.end();
+      for ( TestCases::iterator itTest = testCases_.begin(); itTest != itTestEnd; ++itTest )
+      {
+         itTest->requireResource( resourceName );
+      }
+      NestedSuites::iterator itEnd = nestedSuites_.end();
+      for ( NestedSuites::iterator it = nestedSuites_.begin(); it != itEnd; ++it )
+      {
+         (*it)->requireFixture( resourceName );
+      }
+   }
+
+
+   void
+   SuiteImpl::requireFixtures( TestMeta &testCase ) const
+   {
+      // The fixtures of the outer suites are acquired first.
+      std::vector<const SuiteImpl *> suites;
+      for ( const SuiteImpl *suite = this; suite != 0; suite = suite->parentSuite_ )
+      {
+         suites.push_back( suite );
+      }
+      std::vector<const SuiteImpl *>::reverse_iterator itEnd = suites.rend();
+      for ( std::vector<const SuiteImpl *>::reverse_iterator it = suites.rbegin(); it != itEnd; ++it )
+      {
+         const std::vector<std::string> &fixtures = (*it)->fixtures_;
+         for ( unsigned int index = 0; index < fixtures.size(); ++index )
+         {
+            testCase.requireResource( fixtures[index] );
+         }
+      }
    }
 
    void
@@ -830,6 +1497,18 @@ Suite::testCaseAt( int index ) const
 }
 
 
+void 
+Suite::addFixture( const std::string &resourceName )
+{
+   CPPTL_ASSERT_MESSAGE( impl_ != 0, 
+      "Attempting to add a fixture to an invalid suite!" );
+   if ( impl_ != 0 )
+   {
+      Impl::registryInstance().addSuiteFixture( impl_, resourceName );
+   }
+}
+
+
 void 
 Suite::add( const TestMeta &testCase )
 {
@@ -842,6 +1521,18 @@ Suite::add( const TestMeta &testCase )
 }
 
 
+void 
+Suite::add( const std::vector<TestMeta> &testCases )
+{
+   CPPTL_ASSERT_MESSAGE( impl_ != 0, 
+      "Attempting to add test cases to an invalid suite!" );
+   if ( impl_ != 0 )
+   {
+      Impl::registryInstance().addSuiteTestCases( impl_, testCases );
+   }
+}
+
+
 bool 
 Suite::operator <( const Suite &other ) const
 {
@@ -864,6 +1555,107 @@ Suite::hash() const
 
 
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class TestDescriptorLink
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+TestDescriptorLink::TestDescriptorLink( TestDescriptor &descriptor )
+{
+   descriptor.next_ = Impl::testDescriptors;
+   Impl::testDescriptors = &descriptor;
+}
+
+
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class FrozenRegistry
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+FrozenRegistry::FrozenRegistry()
+{
+}
+
+
+FrozenRegistry::FrozenRegistry( const Suite &rootSuite )
+{
+   Impl::registryInstance().snapshot( rootSuite, *this );
+}
+
+
+int
+FrozenRegistry::suiteCount() const
+{
+   return int(suites_.size());
+}
+
+
+const FrozenRegistry::SuiteEntry &
+FrozenRegistry::suiteAt( int index ) const
+{
+   return suites_[index];
+}
+
+
+int
+FrozenRegistry::testCount() const
+{
+   return int(tests_.size());
+}
+
+
+const FrozenRegistry::TestEntry &
+FrozenRegistry::testAt( int index ) const
+{
+   return tests_[index];
+}
+
+
+const TestMeta &
+FrozenRegistry::testMetaAt( int index ) const
+{
+   const TestEntry &entry = tests_[index];
+   if ( entry.descriptor_ == 0 )
+      return *entry.test_;
+   CppTL::Mutex::ScopedLockGuard guard( lock_ );
+   if ( entry.test_ == 0 )
+   {
+      const TestDescriptor &descriptor = *entry.descriptor_;
+      MetaData metaData( descriptor.name_ );
+      if ( descriptor.description_ != 0 )
+         metaData.setDescription( descriptor.description_ );
+      if ( descriptor.timeOut_ > 0 )
+         metaData.setTimeOut( descriptor.timeOut_ );
+      for ( const char *group = descriptor.groups_; group != 0  &&  *group != 0; )
+      {
+         const char *groupEnd = group + strcspn( group, " " );
+         if ( groupEnd != group )
+            metaData.addToGroup( std::string( group, groupEnd ) );
+         group = groupEnd + strspn( groupEnd, " " );
+      }
+      createdTests_.push_back( makeTestCase( descriptor.run_, metaData ) );
+      Impl::registryInstance().requireSuiteFixtures( suites_[entry.suite_].suite_, 
+                                                     createdTests_.back() );
+      entry.test_ = &createdTests_.back();
+   }
+   return *entry.test_;
+}
+
+
+int
+FrozenRegistry::indexOf( const Suite &suite ) const
+{
+   SuiteIndexes::const_iterator it = indexes_.find( suite );
+   if ( it == indexes_.end() )
+      return -1;
+   return it->second;
+}
+
+
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // class Registry
@@ -878,6 +1670,34 @@ Registry::getRootSuite()
 }
 
 
+const FrozenRegistry &
+Registry::freeze()
+{
+   return Impl::registryInstance().freeze();
+}
+
+
+bool
+Registry::isFrozen()
+{
+   return Impl::registryInstance().isFrozen();
+}
+
+
+bool
+Registry::setRegistrationProfiling( bool enabled )
+{
+   return Impl::registryInstance().setRegistrationProfiling( enabled );
+}
+
+
+RegistrationProfile
+Registry::registrationProfile()
+{
+   return Impl::registryInstance().registrationProfile();
+}
+
+
 std::string 
 Registry::dump()
 {
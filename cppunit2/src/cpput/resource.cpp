@@ -0,0 +1,220 @@
+#include <cpput/resource.h>
+#include <cpput/allocationtracker.h>
+#include <cpput/testing.h>
+#include <cpptl/thread.h>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+   struct ResourceEntry
+   {
+      ResourceEntry()
+         : instance_( 0 )
+         , reservedCount_( 0 )
+         , activeCount_( 0 )
+      {
+      }
+
+      /// Destroys the instance if no test is using it or expected to use it.
+      /// lock_ must be held.
+      void destroyIfUnused()
+      {
+         if ( activeCount_ > 0  ||  reservedCount_ > 0  ||  instance_ == 0 )
+            return;
+         CppUT::Resource *instance = instance_;
+         instance_ = 0;
+         delete instance;
+      }
+
+      CppUT::ResourceFactory factory_;
+      CppUT::Resource *instance_;
+      unsigned int reservedCount_;
+      unsigned int activeCount_;
+      /// Also held while the factory runs, so that the resource is only created once.
+      CppTL::Mutex lock_;
+   };
+
+
+   class Resources
+   {
+   public:
+      ~Resources()
+      {
+         // The instances still alive are leaked: they may depend on static objects
+         // already destroyed.
+         for ( Entries::iterator it = entries_.begin(); it != entries_.end(); ++it )
+            delete it->second;
+      }
+
+      ResourceEntry &entry( const std::string &name )
+      {
+         ResourceEntry *entry = find( name );
+         if ( entry == 0 )
+            throw std::logic_error( "Resource '" + name + "' is not registered." );
+         return *entry;
+      }
+
+      ResourceEntry *find( const std::string &name )
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         Entries::iterator it = entries_.find( name );
+         return it == entries_.end() ? 0 : it->second;
+      }
+
+      void add( const std::string &name,
+                const CppUT::ResourceFactory &factory )
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         ResourceEntry *&entry = entries_[name];
+         if ( entry == 0 )
+            entry = new ResourceEntry();
+         entry->factory_ = factory;
+      }
+
+      void cancelReservations()
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         for ( Entries::iterator it = entries_.begin(); it != entries_.end(); ++it )
+         {
+            ResourceEntry &entry = *(it->second);
+            CppTL::Mutex::ScopedLockGuard entryGuard( entry.lock_ );
+            entry.reservedCount_ = 0;
+            entry.destroyIfUnused();
+         }
+      }
+
+   private:
+      typedef std::map<std::string, ResourceEntry *> Entries;
+      Entries entries_;
+      CppTL::Mutex lock_;
+   };
+
+
+   Resources &resources()
+   {
+      static Resources instance;
+      return instance;
+   }
+
+} // end anonymous namespace
+
+
+namespace CppUT {
+
+// Class Resource
+// //////////////////////////////////////////////////////////////////
+
+Resource::~Resource()
+{
+}
+
+
+// Class ResourceRegistry
+// //////////////////////////////////////////////////////////////////
+
+void
+ResourceRegistry::add( const std::string &name,
+                       const ResourceFactory &factory )
+{
+   resources().add( name, factory );
+}
+
+
+bool
+ResourceRegistry::has( const std::string &name )
+{
+   return resources().find( name ) != 0;
+}
+
+
+void
+ResourceRegistry::reserve( const std::string &name )
+{
+   ResourceEntry *entry = resources().find( name );
+   if ( entry == 0 )
+      return;  // reported when the test acquires it
+   CppTL::Mutex::ScopedLockGuard guard( entry->lock_ );
+   ++entry->reservedCount_;
+}
+
+
+void
+ResourceRegistry::cancelReservation( const std::string &name )
+{
+   ResourceEntry *entry = resources().find( name );
+   if ( entry == 0 )
+      return;
+   CppTL::Mutex::ScopedLockGuard guard( entry->lock_ );
+   if ( entry->reservedCount_ > 0 )
+      --entry->reservedCount_;
+   entry->destroyIfUnused();
+}
+
+
+void
+ResourceRegistry::cancelReservations()
+{
+   resources().cancelReservations();
+}
+
+
+void
+ResourceRegistry::acquire( const std::string &name )
+{
+   // The resource outlives the test creating it.
+   AllocationTrackingPause pause;
+   ResourceEntry &entry = resources().entry( name );
+   CppTL::Mutex::ScopedLockGuard guard( entry.lock_ );
+   if ( entry.instance_ == 0 )
+   {
+      entry.instance_ = entry.factory_();
+      if ( entry.instance_ == 0 )
+         throw std::logic_error( "Factory of resource '" + name + "' returned a NULL pointer." );
+   }
+   ++entry.activeCount_;
+}
+
+
+void
+ResourceRegistry::release( const std::string &name )
+{
+   AllocationTrackingPause pause;
+   ResourceEntry &entry = resources().entry( name );
+   CppTL::Mutex::ScopedLockGuard guard( entry.lock_ );
+   if ( entry.activeCount_ > 0 )
+      --entry.activeCount_;
+   if ( entry.reservedCount_ > 0 )
+      --entry.reservedCount_;
+   entry.destroyIfUnused();
+}
+
+
+Resource &
+ResourceRegistry::get( const std::string &name )
+{
+   ResourceEntry &entry = resources().entry( name );
+   CppTL::Mutex::ScopedLockGuard guard( entry.lock_ );
+   if ( entry.instance_ == 0  ||  entry.activeCount_ == 0 )
+      throw std::logic_error( "Resource '" + name + "' is not required by the running test." );
+   return *entry.instance_;
+}
+
+
+namespace Impl {
+
+// Class SuiteFixtureRegisterer
+// //////////////////////////////////////////////////////////////////
+
+SuiteFixtureRegisterer::SuiteFixtureRegisterer( Suite suite,
+                                                const std::string &name,
+                                                const ResourceFactory &factory )
+{
+   ResourceRegistry::add( name, factory );
+   suite.addFixture( name );
+}
+
+} // namespace Impl
+
+
+} // namespace CppUT
@@ -1,6 +1,10 @@
 #include <cpput/testing.h>
+#include <cpput/allocationtracker.h>
 #include <cpput/assertcommon.h>
 #include <cpput/message.h>
+#include <cpput/perfcounters.h>
+#include <cpput/resource.h>
+#include <cpptl/clock.h>
 #include <cpptl/functor.h>
 #include <cpptl/scopedptr.h>
 
@@ -111,6 +115,159 @@ TestMeta::runTest() const
 }
 
 
+/// Measures the wall-clock and thread CPU time of the successive phases of a test.
+class TestPhaseTimer
+{
+public:
+   TestPhaseTimer()
+      : wallStart_( CppTL::Clock::monotonic() )
+      , cpuStart_( CppTL::Clock::threadCpu() )
+   {
+   }
+
+   /// Records the time elapsed since the end of the previous phase.
+   void endPhase( const char *phase )
+   {
+      double wall = CppTL::Clock::monotonic();
+      double cpu = CppTL::Clock::threadCpu();
+      AllocationTrackingPause pause;
+      Json::Value &times = timing_[phase];
+      times["wall"] = wall - wallStart_;
+      times["cpu"] = cpu - cpuStart_;
+      wallStart_ = wall;
+      cpuStart_ = cpu;
+   }
+
+   /// Stores the recorded phases in the "timing" statistics of the test.
+   void store( TestStatus &status ) const
+   {
+      status.setStatistics( "timing", timing_ );
+   }
+
+private:
+   Json::Value timing_;
+   double wallStart_;
+   double cpuStart_;
+};
+
+
+/* Counts the heap allocations of the successive phases of a test, when
+ * allocation tracking is enabled (see setAllocationTracking()).
+ */
+class TestAllocationRecorder
+{
+public:
+   TestAllocationRecorder()
+      : region_( 0 )
+      , phaseStart_( 0 )
+      , phaseBytesStart_( 0 )
+   {
+      if ( isAllocationTrackingEnabled() )
+      {
+         AllocationTrackingPause pause;
+         phases_ = Json::Value( Json::objectValue );
+         region_ = new AllocationRegion();
+      }
+   }
+
+   ~TestAllocationRecorder()
+   {
+      delete region_;
+   }
+
+   /// Records the allocations made since the end of the previous phase.
+   void endPhase( const char *phase )
+   {
+      if ( region_ == 0 )
+         return;
+      const CppTL::LargestUnsignedInt allocationCount = region_->allocationCount();
+      const CppTL::LargestUnsignedInt allocatedBytes = region_->allocatedBytes();
+      AllocationTrackingPause pause;
+      Json::Value &allocations = phases_[phase];
+      allocations["count"] = double( allocationCount - phaseStart_ );
+      allocations["bytes"] = double( allocatedBytes - phaseBytesStart_ );
+      phaseStart_ = allocationCount;
+      phaseBytesStart_ = allocatedBytes;
+   }
+
+   /// Stores the recorded allocations in the "allocations" statistics of the
+   /// test, and fails the test if some of them are still live.
+   void store( TestStatus &status ) const
+   {
+      if ( region_ == 0 )
+         return;
+      const CppTL::LargestInt liveCount = region_->liveAllocationCount();
+      const CppTL::LargestInt liveBytes = region_->liveBytes();
+      AllocationTrackingPause pause;
+      Json::Value allocations( Json::objectValue );
+      allocations["count"] = double( region_->allocationCount() );
+      allocations["bytes"] = double( region_->allocatedBytes() );
+      allocations["peak_bytes"] = double( region_->peakLiveBytes() );
+      allocations["live_count"] = double( liveCount );
+      allocations["live_bytes"] = double( liveBytes );
+      allocations["phases"] = phases_;
+      status.setStatistics( "allocations", allocations );
+      // The frees of blocks allocated before the test, by a cache for example,
+      // are counted too: each of them hides one leaked allocation.
+      if ( liveCount > 0 )
+      {
+         char message[256];
+         sprintf( message, "Memory leak: %.0f allocations (%.0f bytes) made by the test "
+                  "are still live after the destruction of the test case.", 
+                  double( liveCount ), double( liveBytes ) );
+         CPPUT_CHECKING_FAIL( message );
+      }
+   }
+
+private:
+   AllocationRegion *region_;
+   Json::Value phases_;
+   CppTL::LargestUnsignedInt phaseStart_;
+   CppTL::LargestUnsignedInt phaseBytesStart_;
+};
+
+
+/* Counts the events of the run phase of a test, when enabled (see
+ * setPerfCounters()).
+ */
+class TestPerfRecorder
+{
+public:
+   TestPerfRecorder()
+      : counters_( arePerfCountersEnabled() ? new PerfCounters() : 0 )
+   {
+   }
+
+   ~TestPerfRecorder()
+   {
+      delete counters_;
+   }
+
+   void start()
+   {
+      if ( counters_ != 0 )
+         counters_->start();
+   }
+
+   void stop()
+   {
+      if ( counters_ != 0 )
+         values_ = counters_->stop();
+   }
+
+   /// Stores the counted events in the "counters" statistics of the test.
+   void store( TestStatus &status ) const
+   {
+      if ( counters_ != 0 )
+         status.setStatistics( "counters", values_.toJson() );
+   }
+
+private:
+   PerfCounters *counters_;
+   PerfCounterValues values_;
+};
+
+
 /// @todo move this implementation
 class TestCaseHandle
 {
@@ -170,6 +327,77 @@ private:
 
 
 
+/// Acquires the resources required by a test, and releases them using the
+/// given exception guards.
+class TestResourcesHandle
+{
+public:
+   TestResourcesHandle( const MetaData &test,
+                        const ExceptionGuard &guardsChain )
+       : test_( test )
+       , guardsChain_( guardsChain )
+       , acquiredCount_( 0 )
+   {
+   }
+
+   /// Also cancels the reservations of the resources that were not acquired,
+   /// if the test case could not be created or a resource failed to be created.
+   ~TestResourcesHandle()
+   {
+      release();
+      guardsChain_.protect( CppTL::memfn0( this, &TestResourcesHandle::cancelNotAcquired ) );
+   }
+
+   /// @returns \c false if a resource could not be created.
+   bool acquire()
+   {
+      return guardsChain_.protect( 
+               CppTL::memfn0( this, &TestResourcesHandle::acquireAll ) );
+   }
+
+   void release()
+   {
+      while ( !acquired_.empty() )
+         guardsChain_.protect( CppTL::memfn0( this, &TestResourcesHandle::releaseLast ) );
+   }
+
+private:
+   // The acquired resources are not counted as allocations of the test.
+   void acquireAll()
+   {
+      AllocationTrackingPause pause;
+      for ( int index = 0; index < test_.resourceCount(); ++index )
+      {
+         std::string name = test_.resourceAt( index );
+         ResourceRegistry::acquire( name );
+         acquired_.push_back( name );
+         ++acquiredCount_;
+      }
+   }
+
+   void cancelNotAcquired()
+   {
+      AllocationTrackingPause pause;
+      for ( ; acquiredCount_ < test_.resourceCount(); ++acquiredCount_ )
+         ResourceRegistry::cancelReservation( test_.resourceAt( acquiredCount_ ) );
+   }
+
+   void releaseLast()
+   {
+      AllocationTrackingPause pause;
+      std::string name = acquired_.back();
+      acquired_.pop_back();
+      ResourceRegistry::release( name );
+   }
+
+private:
+   const MetaData &test_;
+   const ExceptionGuard &guardsChain_;
+   std::vector<std::string> acquired_;
+   int acquiredCount_;
+};
+
+
 static void safeCreateTestCase( const TestCaseFactory &factory,
                                 CppTL::ScopedPtr<TestCase> &instance )
 {
@@ -188,6 +416,11 @@ TestMeta::runTest( const ExceptionGuard &guardsChain ) const
 {
    TestInfo &testInfo = TestInfo::threadInstance();
    testInfo.startNewTest();
+   TestPhaseTimer timer;
+   TestPerfRecorder counters;
+   TestAllocationRecorder allocations;
+   // Resources are created by the first test requiring them, as part of its setUp.
+   TestResourcesHandle resources( *this, guardsChain );
    TestCaseHandle testCase( factory_, guardsChain );
    if ( !testCase.get() )
    {
@@ -196,16 +429,27 @@ TestMeta::runTest( const ExceptionGuard &guardsChain ) const
          testInfo.log( "Failed to instantiate TestCase." );
          testInfo.testStatus().setStatus( TestStatus::failed );
       }
+      timer.endPhase( "setUp" );
+      timer.store( testInfo.testStatus() );
       return false;
    }
 
-   bool initialized = guardsChain.protect( 
-      CppTL::memfn0( testCase.get(), &TestCase::setUp ) );
+   bool initialized = resources.acquire()  
+                      &&  guardsChain.protect( 
+                             CppTL::memfn0( testCase.get(), &TestCase::setUp ) );
+   timer.endPhase( "setUp" );
+   allocations.endPhase( "setUp" );
 
    if ( initialized )
    {
+      counters.start();
       guardsChain.protect( CppTL::memfn0( testCase.get(), &TestCase::run ) );
+      counters.stop();
+      timer.endPhase( "run" );
+      allocations.endPhase( "run" );
       guardsChain.protect( CppTL::memfn0( testCase.get(), &TestCase::tearDown) );
+      timer.endPhase( "tearDown" );
+      allocations.endPhase( "tearDown" );
    }
 
    // The C++ run-time will call terminate() if an exception is thrown while 
@@ -216,6 +460,12 @@ TestMeta::runTest( const ExceptionGuard &guardsChain ) const
    // While the situation is somewhat recovered, it likely means that some memory was 
    // leaked by the delete operator.
    testCase.release();
+   resources.release();
+   timer.endPhase( "destruction" );
+   allocations.endPhase( "destruction" );
+   allocations.store( testInfo.testStatus() );
+   counters.store( testInfo.testStatus() );
+   timer.store( testInfo.testStatus() );
 
    return !testInfo.testStatus().hasFailed();
 }
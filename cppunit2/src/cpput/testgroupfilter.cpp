@@ -0,0 +1,302 @@
+#include <cpput/testgroupfilter.h>
+#include <cpptl/stringtools.h>
+#include <cpptl/thread.h>
+#include <map>
+
+namespace CppUT {
+
+
+// Class TestGroupSet
+// //////////////////////////////////////////////////////////////////
+
+unsigned int
+TestGroupSet::intern( const std::string &groupName )
+{
+   typedef std::map<std::string, unsigned int> Bits;
+   static CppTL::Mutex lock;
+   static Bits bits;
+   CppTL::Mutex::ScopedLockGuard guard( lock );
+   Bits::const_iterator it = bits.find( groupName );
+   if ( it != bits.end() )
+      return it->second;
+   unsigned int bit = (unsigned int)bits.size();
+   bits[groupName] = bit;
+   return bit;
+}
+
+
+void
+TestGroupSet::add( unsigned int bit )
+{
+   unsigned int index = bit / bitsPerWord;
+   if ( index >= words_.size() )
+      words_.resize( index + 1, 0 );
+   words_[index] |= Word(1) << (bit % bitsPerWord);
+}
+
+
+bool
+TestGroupSet::isEmpty() const
+{
+   for ( unsigned int index = 0; index < words_.size(); ++index )
+   {
+      if ( words_[index] != 0 )
+         return false;
+   }
+   return true;
+}
+
+
+unsigned int
+TestGroupSet::bitCapacity() const
+{
+   return (unsigned int)words_.size() * bitsPerWord;
+}
+
+
+bool
+TestGroupSet::contains( unsigned int bit ) const
+{
+   unsigned int index = bit / bitsPerWord;
+   return index < words_.size()
+          &&  (words_[index] & (Word(1) << (bit % bitsPerWord))) != 0;
+}
+
+
+void
+TestGroupSet::insert( const TestGroupSet &other )
+{
+   if ( other.words_.size() > words_.size() )
+      words_.resize( other.words_.size(), 0 );
+   for ( unsigned int index = 0; index < other.words_.size(); ++index )
+      words_[index] |= other.words_[index];
+}
+
+
+// Class TestGroupFilter::Parser
+// //////////////////////////////////////////////////////////////////
+
+/* Recursive descent parser building the disjunctive normal form of the
+ * expression:
+ *    or     := and ( '|' and )*
+ *    and    := not ( '&' not )*
+ *    not    := '!' not  |  '(' or ')'  |  group-name
+ * An empty disjunction is false, while a term without group is true.
+ */
+class TestGroupFilter::Parser
+{
+public:
+   Parser( const std::string &expression )
+      : expression_( expression )
+      , pos_( 0 )
+   {
+   }
+
+   bool parse( Terms &terms,
+               std::string &error )
+   {
+      if ( !parseOr( terms )  ||  (skipSpaces(), pos_ != expression_.length()) )
+      {
+         if ( error_.empty() )
+            fail( "unexpected character" );
+         error = error_;
+         return false;
+      }
+      return true;
+   }
+
+private:
+   /// Bound to the size of the normal form, which may grow exponentially with negations.
+   enum { maxTermCount = 4096 };
+
+   bool parseOr( Terms &terms )
+   {
+      if ( !parseAnd( terms ) )
+         return false;
+      while ( accept( '|' ) )
+      {
+         Terms other;
+         if ( !parseAnd( other ) )
+            return false;
+         terms.insert( terms.end(), other.begin(), other.end() );
+      }
+      return checkSize( terms );
+   }
+
+   bool parseAnd( Terms &terms )
+   {
+      if ( !parseNot( terms ) )
+         return false;
+      while ( accept( '&' ) )
+      {
+         Terms other;
+         if ( !parseNot( other ) )
+            return false;
+         conjunction( terms, other );
+         if ( !checkSize( terms ) )
+            return false;
+      }
+      return true;
+   }
+
+   bool parseNot( Terms &terms )
+   {
+      if ( accept( '!' ) )
+      {
+         Terms operand;
+         if ( !parseNot( operand ) )
+            return false;
+         return negation( operand, terms );
+      }
+      if ( accept( '(' ) )
+      {
+         if ( !parseOr( terms ) )
+            return false;
+         if ( !accept( ')' ) )
+            return fail( "expected ')'" );
+         return true;
+      }
+      skipSpaces();
+      std::string::size_type start = pos_;
+      while ( pos_ < expression_.length()  &&  !isSpecial( expression_[pos_] ) )
+         ++pos_;
+      if ( pos_ == start )
+         return fail( "expected a group name" );
+      Term term;
+      term.required_.add( TestGroupSet::intern( expression_.substr( start, pos_ - start ) ) );
+      terms.assign( 1, term );
+      return true;
+   }
+
+   /// Replaces \c terms by the terms of (terms & other).
+   static void conjunction( Terms &terms,
+                            const Terms &other )
+   {
+      Terms result;
+      for ( Terms::const_iterator it = terms.begin(); it != terms.end(); ++it )
+      {
+         for ( Terms::const_iterator itOther = other.begin(); itOther != other.end(); ++itOther )
+         {
+            Term term = *it;
+            term.required_.insert( itOther->required_ );
+            term.forbidden_.insert( itOther->forbidden_ );
+            if ( !term.required_.intersects( term.forbidden_ ) ) // always false otherwise
+               result.push_back( term );
+         }
+      }
+      terms.swap( result );
+   }
+
+   /// Sets \c terms to the terms of !operand, using De Morgan's laws.
+   bool negation( const Terms &operand,
+                  Terms &terms )
+   {
+      terms.assign( 1, Term() );
+      for ( Terms::const_iterator it = operand.begin(); it != operand.end(); ++it )
+      {
+         Terms negatedTerm;
+         negateGroups( it->required_, true, negatedTerm );
+         negateGroups( it->forbidden_, false, negatedTerm );
+         conjunction( terms, negatedTerm );
+         if ( !checkSize( terms ) )
+            return false;
+      }
+      return true;
+   }
+
+   /// Appends one term per group of \c groups, forbidding the required groups
+   /// and requiring the forbidden ones.
+   static void negateGroups( const TestGroupSet &groups,
+                             bool isRequired,
+                             Terms &terms )
+   {
+      for ( unsigned int bit = 0; bit < groups.bitCapacity(); ++bit )
+      {
+         if ( !groups.contains( bit ) )
+            continue;
+         Term term;
+         if ( isRequired )
+            term.forbidden_.add( bit );
+         else
+            term.required_.add( bit );
+         terms.push_back( term );
+      }
+   }
+
+   static bool isSpecial( char c )
+   {
+      return c == '&'  ||  c == '|'  ||  c == '!'  ||  c == '('  ||  c == ')'
+             ||  c == ' '  ||  c == '\t';
+   }
+
+   void skipSpaces()
+   {
+      while ( pos_ < expression_.length()  &&
+              (expression_[pos_] == ' '  ||  expression_[pos_] == '\t') )
+         ++pos_;
+   }
+
+   bool accept( char c )
+   {
+      skipSpaces();
+      if ( pos_ >= expression_.length()  ||  expression_[pos_] != c )
+         return false;
+      ++pos_;
+      return true;
+   }
+
+   bool checkSize( const Terms &terms )
+   {
+      if ( terms.size() > maxTermCount )
+         return fail( "expression too complex" );
+      return true;
+   }
+
+   bool fail( const char *message )
+   {
+      if ( error_.empty() )
+      {
+         error_ = message;
+         error_ += " at position ";
+         error_ += CppTL::toString( (unsigned int)pos_ ).c_str();
+      }
+      return false;
+   }
+
+   const std::string &expression_;
+   std::string::size_type pos_;
+   std::string error_;
+};
+
+
+// Class TestGroupFilter
+// //////////////////////////////////////////////////////////////////
+
+TestGroupFilter::TestGroupFilter()
+   : isEmpty_( true )
+{
+}
+
+
+bool
+TestGroupFilter::setExpression( const std::string &expression,
+                                std::string &error )
+{
+   Terms terms;
+   Parser parser( expression );
+   if ( !parser.parse( terms, error ) )
+      return false;
+   terms_.swap( terms );
+   isEmpty_ = false;
+   return true;
+}
+
+
+bool
+TestGroupFilter::isEmpty() const
+{
+   return isEmpty_;
+}
+
+
+} // namespace CppUT
@@ -1,4 +1,5 @@
 #include <cpput/testinfo.h>
+#include <cpput/allocationtracker.h>
 #include <cpptl/stringtools.h>
 #include <cpptl/thread.h>
 
@@ -169,10 +170,18 @@ void
 TestStatus::setStatistics( const std::string &name,
                            const Json::Value &value )
 {
+   AllocationTrackingPause pause;
    statistics_[name] = value;
 }
 
 
+const Json::Value &
+TestStatus::statistics() const
+{
+   return statistics_;
+}
+
+
 //Json::Value 
 //TestStatus::getStatistics( const CppTL::ConstString &name )
 //{
@@ -295,7 +304,10 @@ TestInfo::handleAssertion( const char *file,
          Assertion assertion( Assertion::assertion, SourceLocation( file, line ) );
          assertion.setDetail( result );
          if ( updater_ )
+         {
+            AllocationTrackingPause pause;
             updater_->addResultAssertion( assertion );
+         }
 
          if ( isAbortingAssertion )
          {
@@ -322,6 +334,7 @@ TestInfo::handleUnexpectedException( const CheckerResult &detail )
    {
       Assertion assertion( Assertion::fault );
       assertion.setDetail( detail );
+      AllocationTrackingPause pause;
       updater_->addResultAssertion( assertion );
    }
    testStatus_.setStatus( TestStatus::failed );
@@ -339,7 +352,10 @@ void
 TestInfo::log( const Json::Value &log )
 {
    if ( updater_ )
+   {
+      AllocationTrackingPause pause;
       updater_->addResultLog( log );
+   }
 }
 
 
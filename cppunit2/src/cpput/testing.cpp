@@ -1,5 +1,30 @@
 #include <cpput/testing.h>
 #include <cpptl/conststring.h>
+#include <algorithm>
+
+
+namespace {
+
+   /*! Returns a copy of \a text which lives until the end of the program.
+    * Equal strings are stored once, whichever thread interns them.
+    */
+   const char *internString( const std::string &text )
+   {
+      static CppTL::Mutex lock;
+      static std::set<std::string> strings;
+      CppTL::Mutex::ScopedLockGuard guard( lock );
+      return strings.insert( text ).first->c_str();
+   }
+
+   void addStrings( const std::vector<const char *> &strings,
+                    const char *name,
+                    Json::Value &object )
+   {
+      for ( unsigned int index = 0; index < strings.size(); ++index )
+         object[name].append( strings[index] );
+   }
+
+} // end anonymous namespace
 
 
 namespace CppUT {
@@ -11,16 +36,19 @@ namespace CppUT {
 // //////////////////////////////////////////////////////////////////
 
 MetaData::MetaData( const std::string &name )
+   : name_( internString( name ) )
+   , description_( "" )
+   , timeOut_( 0.0 )
 {
-   info_["configuration/name"] = name;
-   info_["input"] = Json::Value( Json::objectValue );
 }
 
 
 MetaData::MetaData( const std::string &name,
                     const TestExtendedData &metaDataFactory )
+   : name_( internString( name ) )
+   , description_( "" )
+   , timeOut_( 0.0 )
 {
-   info_["configuration/name"] = name;
    metaDataFactory.apply( *this );
 }
 
@@ -32,70 +60,164 @@ MetaData::~MetaData()
 void 
 MetaData::setDescription( const std::string &description )
 {
-   info_["configuration/description"] = description;
+   description_ = internString( description );
 }
 
 
 std::string 
 MetaData::description() const
 {
-   return info_.get("configuration/description", "" ).asString();
+   return description_;
 }
 
 
 std::string 
 MetaData::name() const
 {
-   return info_.get( "configuration/name", "" ).asString();
+   return name_;
+}
+
+
+const char *
+MetaData::internedName() const
+{
+   return name_;
 }
 
 
 void 
 MetaData::setTimeOut( double timeOutInSeconds )
 {
-   info_["configuration/timeOut"] = timeOutInSeconds;
+   timeOut_ = timeOutInSeconds;
 }
 
 
 double 
 MetaData::timeOut() const
 {
-   return info_.get( "configuration/timeOut", 0.0 ).asDouble();
+   return timeOut_;
 }
 
 
 void 
 MetaData::addToGroup( const std::string &groupName )
 {
-   info_["configuration"]["groups"].append( groupName );
+   groups_.push_back( internString( groupName ) );
+   groupSet_.add( TestGroupSet::intern( groupName ) );
 }
 
 
 int 
 MetaData::groupCount() const
 {
-   return info_["configuration"]["groups"].size();
+   return int(groups_.size());
 }
 
 
 std::string 
 MetaData::groupAt( unsigned int index ) const
 {
-   return info_["configuration"]["groups"][index].asString();
+   return groups_.at( index );
+}
+
+
+void 
+MetaData::addDependency( const std::string &testName )
+{
+   dependencies_.push_back( internString( testName ) );
+}
+
+
+void 
+MetaData::setDependenciesFromPackedString( const std::string &dependencies )
+{
+   const char *separators = " \t,;";
+   std::string::size_type start = dependencies.find_first_not_of( separators );
+   while ( start != std::string::npos )
+   {
+      std::string::size_type end = dependencies.find_first_of( separators, start );
+      addDependency( dependencies.substr( start, end - start ) );
+      start = dependencies.find_first_not_of( separators, end );
+   }
+}
+
+
+int 
+MetaData::dependencyCount() const
+{
+   return int(dependencies_.size());
+}
+
+
+std::string 
+MetaData::dependencyAt( unsigned int index ) const
+{
+   return dependencies_.at( index );
+}
+
+
+void 
+MetaData::requireResource( const std::string &resourceName )
+{
+   const char *interned = internString( resourceName );
+   // Interned strings are equal only if they are the same pointer.
+   if ( std::find( resources_.begin(), resources_.end(), interned ) == resources_.end() )
+      resources_.push_back( interned );
+}
+
+
+int 
+MetaData::resourceCount() const
+{
+   return int(resources_.size());
+}
+
+
+std::string 
+MetaData::resourceAt( unsigned int index ) const
+{
+   return resources_.at( index );
+}
+
+
+const TestGroupSet &
+MetaData::groupSet() const
+{
+   return groupSet_;
 }
 
 
 Json::Value &
 MetaData::input()
 {
-   return info_["input"];
+   return input_;
 }
 
 
 const Json::Value &
 MetaData::input() const
 {
-   return info_["input"];
+   return input_;
+}
+
+
+Json::Value 
+MetaData::toJson() const
+{
+   Json::Value configuration( Json::objectValue );
+   configuration["name"] = name_;
+   if ( *description_ )
+      configuration["description"] = description_;
+   if ( timeOut_ != 0.0 )
+      configuration["timeOut"] = timeOut_;
+   addStrings( groups_, "groups", configuration );
+   addStrings( dependencies_, "dependencies", configuration );
+   addStrings( resources_, "resources", configuration );
+
+   Json::Value data( Json::objectValue );
+   data["configuration"] = configuration;
+   data["input"] = input_.isNull() ? Json::Value( Json::objectValue ) : input_;
+   return data;
 }
 
 
@@ -0,0 +1,208 @@
+#include <cpput/testpathfilter.h>
+#include <algorithm>
+
+namespace CppUT {
+
+
+TestPathFilter::TestPathFilter()
+   : hasInclude_( false )
+   , isCompiled_( false )
+{
+}
+
+
+void 
+TestPathFilter::addInclude( const std::string &pattern )
+{
+   addPattern( pattern, false );
+   hasInclude_ = true;
+}
+
+
+void 
+TestPathFilter::addExclude( const std::string &pattern )
+{
+   addPattern( pattern, true );
+}
+
+
+bool 
+TestPathFilter::isEmpty() const
+{
+   return startPositions_.empty();
+}
+
+
+void 
+TestPathFilter::addPattern( const std::string &pattern, 
+                            bool isExclude )
+{
+   // The deterministic states computed so far are invalidated.
+   states_.clear();
+   stateIndex_.clear();
+   isCompiled_ = false;
+   startPositions_.push_back( (unsigned int)tokens_.size() );
+   Token token;
+   token.isExclude_ = isExclude;
+   token.literal_ = 0;
+   for ( std::string::size_type index = 0; index < pattern.length(); ++index )
+   {
+      char c = pattern[index];
+      if ( c == '*' )
+      {
+         token.kind_ = Token::anySequence;
+         if ( !tokens_.empty()  &&  tokens_.back().kind_ == Token::anySequence
+              &&  tokens_.size() > startPositions_.back() )
+            continue; // '**' is equivalent to '*'
+      }
+      else if ( c == '?' )
+         token.kind_ = Token::anyChar;
+      else
+      {
+         if ( c == '\\'  &&  index + 1 < pattern.length() )
+            c = pattern[++index];
+         token.kind_ = Token::literal;
+         token.literal_ = c;
+      }
+      tokens_.push_back( token );
+   }
+   token.kind_ = Token::accept;
+   token.literal_ = 0;
+   tokens_.push_back( token );
+}
+
+
+TestPathFilter::State 
+TestPathFilter::start()
+{
+   if ( !isCompiled_ )
+   {
+      std::vector<unsigned int> positions( startPositions_ );
+      intern( positions );
+      isCompiled_ = true;
+   }
+   return 0;
+}
+
+
+TestPathFilter::State 
+TestPathFilter::advance( State state, 
+                         const std::string &text )
+{
+   for ( std::string::size_type index = 0; index < text.length(); ++index )
+      state = transition( state, (unsigned char)text[index] );
+   return state;
+}
+
+
+bool 
+TestPathFilter::isPruned( State state ) const
+{
+   return states_[state].isPruned_;
+}
+
+
+bool 
+TestPathFilter::isSelected( State state ) const
+{
+   return states_[state].isSelected_;
+}
+
+
+/// Adds the positions reachable without consuming any character: a '*' may
+/// match an empty sequence.
+void 
+TestPathFilter::addClosure( std::vector<unsigned int> &positions ) const
+{
+   for ( unsigned int index = 0; index < positions.size(); ++index )
+   {
+      unsigned int position = positions[index];
+      if ( tokens_[position].kind_ == Token::anySequence
+           &&  std::find( positions.begin(), positions.end(), position + 1 ) == positions.end() )
+      {
+         positions.push_back( position + 1 );
+      }
+   }
+   std::sort( positions.begin(), positions.end() );
+}
+
+
+TestPathFilter::State 
+TestPathFilter::intern( std::vector<unsigned int> &positions )
+{
+   addClosure( positions );
+   StateIndex::const_iterator itFound = stateIndex_.find( positions );
+   if ( itFound != stateIndex_.end() )
+      return itFound->second;
+
+   DeterministicState state;
+   state.positions_ = positions;
+   state.transitions_.resize( 256, -1 );
+   bool canSelect = false;
+   bool isIncluded = false;
+   bool isExcluded = false;
+   bool isSubtreeExcluded = false;
+   for ( unsigned int index = 0; index < positions.size(); ++index )
+   {
+      unsigned int position = positions[index];
+      const Token &token = tokens_[position];
+      if ( token.kind_ == Token::accept )
+      {
+         if ( token.isExclude_ )
+            isExcluded = true;
+         else
+            isIncluded = true;
+      }
+      else if ( !token.isExclude_ )
+         canSelect = true;
+      else if ( token.kind_ == Token::anySequence  
+                &&  tokens_[position + 1].kind_ == Token::accept )
+         isSubtreeExcluded = true;   // any continuation is excluded
+   }
+   if ( !hasInclude_ )
+   {
+      canSelect = true;
+      isIncluded = true;
+   }
+   state.isPruned_ = !canSelect  ||  isSubtreeExcluded;
+   state.isSelected_ = isIncluded  &&  !isExcluded;
+   states_.push_back( state );
+   State interned = State( states_.size() - 1 );
+   stateIndex_[positions] = interned;
+   return interned;
+}
+
+
+TestPathFilter::State 
+TestPathFilter::transition( State state, 
+                            unsigned char c )
+{
+   int next = states_[state].transitions_[c];
+   if ( next >= 0 )
+      return State( next );
+
+   std::vector<unsigned int> nextPositions;
+   const std::vector<unsigned int> &positions = states_[state].positions_;
+   for ( unsigned int index = 0; index < positions.size(); ++index )
+   {
+      unsigned int position = positions[index];
+      const Token &token = tokens_[position];
+      unsigned int nextPosition;
+      if ( token.kind_ == Token::anySequence )
+         nextPosition = position;
+      else if ( token.kind_ == Token::anyChar  
+                ||  (token.kind_ == Token::literal  &&  (unsigned char)token.literal_ == c) )
+         nextPosition = position + 1;
+      else
+         continue;
+      if ( std::find( nextPositions.begin(), nextPositions.end(), nextPosition ) == nextPositions.end() )
+         nextPositions.push_back( nextPosition );
+   }
+   // intern() may reallocate states_.
+   next = int( intern( nextPositions ) );
+   states_[state].transitions_[c] = next;
+   return State( next );
+}
+
+
+} // namespace CppUT
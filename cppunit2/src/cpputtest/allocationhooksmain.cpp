@@ -0,0 +1,19 @@
+// Main of the cpputallocationtest program, which runs the allocation tracking
+// tests with the cpput_allocationhooks library linked in. Every test of the
+// program is checked for memory leaks.
+
+#include <cpput/testing.h>
+#include <cpput/lighttestrunner.h>
+#include <cpput/allocationtracker.h>
+
+
+int main( int argc, const char *argv[] )
+{
+   CppUT::LightTestRunner runner;
+   if ( !runner.parseCommandLine( argc, argv ) )
+      return 2;
+   CppUT::setAllocationTracking( true );
+   runner.addSuite( CppUT::Registry::getRootSuite() );
+   bool sucessful = runner.runTests();
+   return sucessful ? 0 : 1;
+}
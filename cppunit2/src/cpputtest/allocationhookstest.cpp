@@ -0,0 +1,128 @@
+// Only built in the cpputallocationtest program, which is linked with the
+// cpput_allocationhooks library.
+
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/allocationtracker.h>
+#include <cpptl/thread.h>
+#include <vector>
+
+namespace {
+
+   int *leakedValues = 0;
+
+   void leakingTest()
+   {
+      leakedValues = new int[16];
+   }
+
+
+   void allocatingTest()
+   {
+      std::vector<int> values;
+      CPPUT_CHECK_NO_ALLOCATION( values.push_back( 1 ) );
+   }
+
+
+   void notAllocatingTest()
+   {
+      int value = 0;
+      CPPUT_CHECK_NO_ALLOCATION( ++value );
+   }
+
+
+#if CPPTL_HAS_THREAD
+   /* Runs a test in a thread of its own. Run in the calling thread, the test
+    * would replace the TestInfo of the running test.
+    */
+   class TestThread : private CppUT::TestResultUpdater
+   {
+   public:
+      /// Returns \c true if the test failed with a message containing
+      /// \c message, or passed if \c message is 0.
+      static bool runsWith( void (*testFunction)(),
+                            const char *message )
+      {
+         // The test, the thread and the failures are not allocated by the
+         // running test.
+         CppUT::AllocationTrackingPause pause;
+         CppUT::TestMeta test = CppUT::makeTestCase( testFunction, "test" );
+         TestThread testThread( test );
+         CppTL::Thread thread;
+         if ( !thread.start( CppTL::memfn0( &testThread, &TestThread::runTest ) ) )
+            return false;
+         thread.join();
+         if ( message == 0 )
+            return testThread.succeeded_;
+         return !testThread.succeeded_
+                &&  testThread.failures_.find( message ) != std::string::npos;
+      }
+
+   private:
+      TestThread( const CppUT::TestMeta &test )
+         : test_( test )
+         , succeeded_( false )
+      {
+      }
+
+      void runTest()
+      {
+         CppUT::TestInfo::threadInstance().setTestResultUpdater( *this );
+         succeeded_ = test_.runTest();
+         CppUT::TestInfo::threadInstance().removeTestResultUpdater();
+      }
+
+   private: // overridden from CppUT::TestResultUpdater
+      virtual void addResultLog( const Json::Value & )
+      {
+      }
+
+      virtual void addResultAssertion( const CppUT::Assertion &assertion )
+      {
+         failures_ += assertion.toString();
+      }
+
+   private:
+      const CppUT::TestMeta &test_;
+      std::string failures_;
+      bool succeeded_;
+   };
+#endif
+
+} // end anonymous namespace
+
+
+CPPUT_SUITE( "AllocationHooks" ) {
+
+CPPUT_TEST_FUNCTION( testHooksAreInstalled )
+{
+   CPPUT_ASSERT( CppUT::areAllocationHooksInstalled() );
+   CppUT::AllocationRegion region;
+   int *value = new int( 1 );
+   CPPUT_CHECK( region.allocationCount() == 1 );
+   CPPUT_CHECK( region.liveAllocationCount() == 1 );
+   delete value;
+   CPPUT_CHECK( region.liveAllocationCount() == 0 );
+   CPPUT_CHECK( region.liveBytes() == 0 );
+}
+
+
+#if CPPTL_HAS_THREAD
+CPPUT_TEST_FUNCTION( testLeakingTestFails )
+{
+   CPPUT_ASSERT( CppUT::isAllocationTrackingEnabled() );
+   CPPUT_CHECK( TestThread::runsWith( &leakingTest, "Memory leak" ) );
+   CppUT::AllocationTrackingPause pause;   // allocated by the other thread
+   delete[] leakedValues;
+   leakedValues = 0;
+}
+
+
+CPPUT_TEST_FUNCTION( testNoAllocationCheckFailsOnAllocation )
+{
+   CPPUT_CHECK( TestThread::runsWith( &allocatingTest, "expression allocated memory" ) );
+   CPPUT_CHECK( TestThread::runsWith( &notAllocatingTest, 0 ) );
+}
+#endif
+
+} // end suite AllocationHooks
@@ -0,0 +1,49 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/allocationtracker.h>
+#include <vector>
+
+
+CPPUT_SUITE( "AllocationTracker" ) {
+
+CPPUT_TEST_FUNCTION( testRegionCountsAllocations )
+{
+   CppUT::AllocationRegion region;
+   {
+      std::vector<int> values( 1000 );
+      CPPUT_CHECK( values.size() == 1000 );
+   }
+   if ( CppUT::areAllocationHooksInstalled() )
+   {
+      CPPUT_CHECK( region.allocationCount() >= 1 );
+      CPPUT_CHECK( region.allocatedBytes() >= 1000 * sizeof(int) );
+      CPPUT_CHECK( region.peakLiveBytes() >= CppTL::LargestInt( 1000 * sizeof(int) ) );
+   }
+   else
+   {
+      CPPUT_CHECK( region.allocationCount() == 0 );
+   }
+}
+
+
+CPPUT_TEST_FUNCTION( testPausedAllocationsAreNotCounted )
+{
+   CppUT::AllocationRegion region;
+   {
+      CppUT::AllocationTrackingPause pause;
+      std::vector<int> values( 1000 );
+   }
+   CPPUT_CHECK( region.allocationCount() == 0 );
+   CPPUT_CHECK( region.liveBytes() == 0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testNoAllocationCheck )
+{
+   CppUT::AllocationRegion region;
+   CppUT::CheckerResult result = CppUT::checkNoAllocation( region, "nothing" );
+   CPPUT_CHECK( result.status_ == ( CppUT::areAllocationHooksInstalled() ? CppUT::TestStatus::passed 
+                                                                          : CppUT::TestStatus::failed ) );
+}
+
+} // end suite AllocationTracker
@@ -0,0 +1,108 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/benchmark.h>
+
+
+CPPUT_SUITE( "Benchmark" ) {
+
+CPPUT_TEST_FUNCTION( testStatisticsRejectOutliers )
+{
+   std::vector<double> samples;
+   for ( int index = 0; index < 9; ++index )
+      samples.push_back( 10.0 + index );
+   samples.push_back( 1000.0 );
+   CppUT::BenchmarkStatistics statistics = CppUT::BenchmarkStatistics::compute( samples );
+   CPPUT_CHECK( statistics.outlierCount_ == 1 );
+   CPPUT_CHECK( statistics.samples_.size() == 9 );
+   CPPUT_CHECK( statistics.mean_ == 14.0 );
+   CPPUT_CHECK( statistics.median_ == 14.0 );
+   CPPUT_CHECK( statistics.min_ == 10.0 );
+   CPPUT_CHECK( statistics.max_ == 18.0 );
+   CPPUT_CHECK( statistics.p99_ > 17.9  &&  statistics.p99_ <= 18.0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testStatisticsOfIdenticalSamples )
+{
+   std::vector<double> samples( 5, 3.0 );
+   CppUT::BenchmarkStatistics statistics = CppUT::BenchmarkStatistics::compute( samples );
+   CPPUT_CHECK( statistics.outlierCount_ == 0 );
+   CPPUT_CHECK( statistics.mean_ == 3.0 );
+   CPPUT_CHECK( statistics.standardDeviation_ == 0.0 );
+   CPPUT_CHECK( CppUT::BenchmarkStatistics::compute( std::vector<double>() ).samples_.empty() );
+}
+
+
+CPPUT_TEST_FUNCTION( testBenchmarkIsInBenchmarkGroup )
+{
+   CppUT::TestMeta benchmark = CppUT::makeBenchmark( 0, "benchmark" );
+   CPPUT_CHECK( benchmark.groupSet().contains( CppUT::TestGroupSet::intern( "benchmark" ) ) );
+   CppUT::TestMeta threaded = CppUT::makeThreadedBenchmark( 0, CppUT::MetaData( "threaded" ) );
+   CPPUT_CHECK( threaded.groupSet().contains( CppUT::TestGroupSet::intern( "benchmark" ) ) );
+}
+
+CPPUT_TEST_FUNCTION( testComparisonOfSlowerSamples )
+{
+   std::vector<double> baseline;
+   std::vector<double> samples;
+   for ( int index = 0; index < 20; ++index )
+   {
+      baseline.push_back( 100.0 + index % 5 );
+      samples.push_back( 120.0 + index % 5 );
+   }
+   CppUT::BenchmarkComparison comparison = CppUT::BenchmarkComparison::compare( baseline, samples );
+   CPPUT_CHECK( comparison.baselineMedian_ == 102.0 );
+   CPPUT_CHECK( comparison.median_ == 122.0 );
+   CPPUT_CHECK( comparison.change_ > 0.19  &&  comparison.change_ < 0.2 );
+   CPPUT_CHECK( comparison.pValue_ < 0.001 );
+}
+
+
+CPPUT_TEST_FUNCTION( testComparisonOfSimilarSamples )
+{
+   std::vector<double> baseline;
+   std::vector<double> samples;
+   for ( int index = 0; index < 20; ++index )
+   {
+      baseline.push_back( 100.0 + index % 5 );
+      samples.push_back( 100.0 + (index + 2) % 5 );
+   }
+   CPPUT_CHECK( CppUT::BenchmarkComparison::compare( baseline, samples ).pValue_ > 0.5 );
+   CPPUT_CHECK( CppUT::BenchmarkComparison::compare( std::vector<double>( 8, 1.0 ), 
+                                                     std::vector<double>( 8, 1.0 ) ).pValue_ == 1.0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testRangeSizes )
+{
+   std::vector<unsigned int> sizes = CppUT::BenchmarkRange( 8, 100 ).sizes();
+   CPPUT_CHECK( sizes.size() == 5 );
+   CPPUT_CHECK( sizes.front() == 8  &&  sizes[3] == 64  &&  sizes.back() == 100 );
+   CPPUT_CHECK( CppUT::BenchmarkRange( 1, 1000, 10 ).sizes().size() == 4 );
+   CPPUT_CHECK( CppUT::BenchmarkRange().sizes().empty() );
+}
+
+
+CPPUT_TEST_FUNCTION( testComplexityFit )
+{
+   std::vector<unsigned int> sizes = CppUT::BenchmarkRange( 8, 1 << 20 ).sizes();
+   std::vector<double> linear;
+   std::vector<double> quadratic;
+   std::vector<double> constant;
+   for ( unsigned int index = 0; index < sizes.size(); ++index )
+   {
+      double n = sizes[index];
+      linear.push_back( 3 * n + 50 );
+      quadratic.push_back( 0.5 * n * n + 10 * n );
+      constant.push_back( index % 2 ? 20 : 21 );
+   }
+   CppUT::BenchmarkComplexityFit fit = CppUT::BenchmarkComplexityFit::compute( sizes, linear );
+   CPPUT_CHECK( fit.complexity_ == CppUT::complexityLinear );
+   CPPUT_CHECK( fit.coefficient_ > 2.99  &&  fit.coefficient_ < 3.01 );
+   CPPUT_CHECK( CppUT::BenchmarkComplexityFit::compute( sizes, quadratic ).complexity_ 
+                == CppUT::complexityQuadratic );
+   CPPUT_CHECK( CppUT::BenchmarkComplexityFit::compute( sizes, constant ).complexity_ 
+                == CppUT::complexityConstant );
+}
+
+} // end suite Benchmark
@@ -0,0 +1,50 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <json/reader.h>
+#include <json/value.h>
+#include <json/writer.h>
+
+
+CPPUT_SUITE( "Json" ) {
+
+CPPUT_TEST_FUNCTION( testWriterEscapesQuotesAndBackslashes )
+{
+   Json::Value value( "say \"hi\" \\ bye" );
+   CPPUT_CHECK( Json::FastWriter().write( value ) == "\"say \\\"hi\\\" \\\\ bye\"\n" );
+}
+
+
+CPPUT_TEST_FUNCTION( testWriterEscapesControlCharacters )
+{
+   Json::Value value( "a\nb\tc\rd\be\ff\001g\037" );
+   CPPUT_CHECK( Json::FastWriter().write( value )
+                == "\"a\\nb\\tc\\rd\\be\\ff\\u0001g\\u001f\"\n" );
+}
+
+
+CPPUT_TEST_FUNCTION( testEscapedStringsAreReadBack )
+{
+   Json::Value root( Json::objectValue );
+   root["line\n\"name\""] = "first line\nsecond\t\"quoted\" \\path";
+   Json::Value fastRoot;
+   CPPUT_ASSERT( Json::Reader().parse( Json::FastWriter().write( root ), fastRoot ) );
+   CPPUT_CHECK( fastRoot == root );
+   Json::Value styledRoot;
+   CPPUT_ASSERT( Json::Reader().parse( Json::StyledWriter().write( root ), styledRoot ) );
+   CPPUT_CHECK( styledRoot == root );
+}
+
+
+CPPUT_TEST_FUNCTION( testNullValueHasNoMemberNames )
+{
+   const Json::Value null;
+   CPPUT_CHECK( null.getMemberNames().empty() );
+   Json::Value object( Json::objectValue );
+   object["b"] = 1;
+   object["a"] = 2;
+   Json::Value::Members members = object.getMemberNames();
+   CPPUT_ASSERT( members.size() == 2 );
+   CPPUT_CHECK( members[0] == "a"  &&  members[1] == "b" );
+}
+
+} // end suite Json
@@ -0,0 +1,915 @@
+#include <cpput/assertcommon.h>
+#include <cpput/lighttestrunner.h>
+#include <cpput/testing.h>
+#include <cpptl/stringtools.h>
+#include <cpptl/thread.h>
+#include <json/writer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <set>
+#include <string>
+#include <vector>
+#if CPPUT_HAS_FORK
+# include <unistd.h>
+#endif
+
+
+CPPUT_SUITE( "StableHash" ) {
+
+CPPUT_TEST_FUNCTION( testStableHashIsFnv1a )
+{
+   // Reference values of the 32 bits FNV-1a hash.
+   CPPUT_CHECK( CppTL::stableHash( CppTL::ConstString( "" ) ) == 0x811c9dc5u );
+   CPPUT_CHECK( CppTL::stableHash( CppTL::ConstString( "a" ) ) == 0xe40c292cu );
+   CPPUT_CHECK( CppTL::stableHash( CppTL::ConstString( "foobar" ) ) == 0xbf9cf968u );
+   const char text[] = "//Suite/test";
+   CPPUT_CHECK( CppTL::stableHash( text, text + sizeof(text) - 1 ) 
+                == CppTL::stableHash( CppTL::ConstString( text ) ) );
+}
+
+} // end suite StableHash
+
+
+#if CPPTL_HAS_THREAD
+
+namespace {
+
+   /// Records the results streamed by LightTestRunner.
+   class RecordingReporter : public CppUT::LightTestReporter
+   {
+   public:
+      struct Result
+      {
+         std::string path_;
+         CppUT::TestStatus status_;
+         std::string report_;
+      };
+
+      typedef std::vector<Result> Results;
+
+      virtual void testCompleted( const CppTL::ConstString &testPath,
+                                  const CppUT::TestStatus &status,
+                                  const CppTL::ConstString &failureReport )
+      {
+         Result result;
+         result.path_ = testPath.c_str();
+         result.status_ = status;
+         result.report_ = failureReport.c_str();
+         results_.push_back( result );
+      }
+
+      virtual void reportTimings( const CppUT::LightTestTimings &timings )
+      {
+         timings_ = timings;
+      }
+
+      virtual void reportBenchmarkDeltas( const CppUT::LightBenchmarkDeltas &deltas )
+      {
+         deltas_ = deltas;
+      }
+
+      virtual void runCompleted( const CppUT::LightTestSummary &summary )
+      {
+         summary_ = summary;
+      }
+
+      /// Returns the result of the test of the given name, or 0 if it was not reported.
+      const Result *find( const std::string &name ) const
+      {
+         const std::string suffix = "/" + name;
+         for ( Results::const_iterator it = results_.begin(); it != results_.end(); ++it )
+         {
+            if ( it->path_.length() >= suffix.length()
+                 &&  it->path_.compare( it->path_.length() - suffix.length(),
+                                        suffix.length(), suffix ) == 0 )
+               return &*it;
+         }
+         return 0;
+      }
+
+      Results results_;
+      CppUT::LightTestTimings timings_;
+      CppUT::LightBenchmarkDeltas deltas_;
+      CppUT::LightTestSummary summary_;
+   };
+
+
+   /* Runs the tests of a LightTestRunner in a thread of its own. Run in the
+    * calling thread, the tests would replace the TestInfo of the running test.
+    */
+   class RunnerThread
+   {
+   public:
+      static bool run( CppUT::LightTestRunner &runner )
+      {
+         RunnerThread runnerThread( runner );
+         CppTL::Thread thread;
+         if ( !thread.start( CppTL::memfn0( &runnerThread, &RunnerThread::runTests ) ) )
+            return false;
+         thread.join();
+         return runnerThread.succeeded_;
+      }
+
+   private:
+      RunnerThread( CppUT::LightTestRunner &runner )
+         : runner_( runner )
+         , succeeded_( false )
+      {
+      }
+
+      void runTests()
+      {
+         succeeded_ = runner_.runTests();
+      }
+
+      CppUT::LightTestRunner &runner_;
+      bool succeeded_;
+   };
+
+
+   std::string testName( unsigned int index )
+   {
+      char name[32];
+      sprintf( name, "test%02u", index );
+      return name;
+   }
+
+
+   /// Counts how many times each test ran, from several threads.
+   class RunCounter
+   {
+   public:
+      RunCounter( unsigned int testCount )
+         : counts_( testCount, 0 )
+      {
+      }
+
+      void increment( unsigned int index )
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         ++counts_[index];
+      }
+
+      unsigned int count( unsigned int index ) const
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         return counts_[index];
+      }
+
+   private:
+      mutable CppTL::Mutex lock_;
+      std::vector<unsigned int> counts_;
+   };
+
+
+   /// A test incrementing its run counter.
+   struct CountedTest
+   {
+      CountedTest( RunCounter &counter,
+                   unsigned int index )
+         : counter_( &counter )
+         , index_( index )
+      {
+      }
+
+      void operator()() const
+      {
+         counter_->increment( index_ );
+         // Gives the other workers a chance to steal.
+         CppTL::Thread::yield();
+      }
+
+      RunCounter *counter_;
+      unsigned int index_;
+   };
+
+
+   /// Runs the given shard of the suite, and returns the paths of the tests run.
+   std::set<std::string> runShard( const CppUT::Suite &suite,
+                                   unsigned int shardIndex,
+                                   unsigned int shardCount,
+                                   const std::string &timingCachePath = std::string() )
+   {
+      RecordingReporter reporter;
+      CppUT::LightTestRunner runner;
+      runner.setReporter( reporter );
+      runner.setShard( shardIndex, shardCount );
+      runner.setTimingCacheFile( timingCachePath );
+      runner.setThreadCount( 2 );
+      runner.addSuite( suite );
+      RunnerThread::run( runner );
+      std::set<std::string> paths;
+      for ( RecordingReporter::Results::const_iterator it = reporter.results_.begin();
+            it != reporter.results_.end();
+            ++it )
+         paths.insert( it->path_ );
+      return paths;
+   }
+
+
+   void passingTest()
+   {
+   }
+
+
+   void failingTest()
+   {
+      CPPUT_CHECK( false );
+   }
+
+
+   void slowTest()
+   {
+      CppTL::Thread::sleep( 20 );
+   }
+
+
+   /// Returns the text written to the given stream, from its beginning.
+   std::string readBack( FILE *file )
+   {
+      std::string text;
+      rewind( file );
+      char buffer[1024];
+      size_t length;
+      while ( (length = fread( buffer, 1, sizeof(buffer), file )) > 0 )
+         text.append( buffer, length );
+      return text;
+   }
+
+
+   bool fileExists( const std::string &path )
+   {
+      FILE *file = fopen( path.c_str(), "rb" );
+      if ( file == 0 )
+         return false;
+      fclose( file );
+      return true;
+   }
+
+
+   /// Runs a passing test with the runner configured by the given options.
+   /// @returns \c false if the command line was rejected.
+   bool runWithCommandLine( int argc,
+                            const char *argv[] )
+   {
+      CppUT::Suite suite( "CommandLine" );
+      suite.add( CppUT::makeTestCase( &passingTest, "passes" ) );
+      RecordingReporter reporter;
+      CppUT::LightTestRunner runner;
+      runner.setReporter( reporter );
+      if ( !runner.parseCommandLine( argc, argv ) )
+         return false;
+      runner.addSuite( suite );
+      return RunnerThread::run( runner );
+   }
+
+
+   /// Counts its runs, and fails its third run.
+   struct FailingThirdRunTest
+   {
+      FailingThirdRunTest( RunCounter &counter )
+         : counter_( &counter )
+      {
+      }
+
+      void operator()() const
+      {
+         counter_->increment( 0 );
+         CPPUT_CHECK( counter_->count( 0 ) != 3 );
+      }
+
+      RunCounter *counter_;
+   };
+
+
+   /// Records the order in which tests ran, from several threads.
+   class RunLog
+   {
+   public:
+      void append( const std::string &name )
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         names_.push_back( name );
+      }
+
+      /// Returns the rank of the first run of the test, or -1 if it did not run.
+      int rankOf( const std::string &name ) const
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         for ( unsigned int index = 0; index < names_.size(); ++index )
+         {
+            if ( names_[index] == name )
+               return int(index);
+         }
+         return -1;
+      }
+
+   private:
+      mutable CppTL::Mutex lock_;
+      std::vector<std::string> names_;
+   };
+
+
+   /// A test appending its name to a run log, passing or failing.
+   struct LoggedTest
+   {
+      LoggedTest( RunLog &log,
+                  const std::string &name,
+                  bool passes = true )
+         : log_( &log )
+         , name_( name )
+         , passes_( passes )
+      {
+      }
+
+      void operator()() const
+      {
+         log_->append( name_ );
+         CPPUT_CHECK( passes_ );
+      }
+
+      RunLog *log_;
+      std::string name_;
+      bool passes_;
+   };
+
+
+   /// Adds a logged test depending on the given tests, separated by spaces.
+   void addLoggedTest( CppUT::Suite &suite,
+                       RunLog &log,
+                       const std::string &name,
+                       const std::string &dependencies = std::string(),
+                       bool passes = true )
+   {
+      CppUT::MetaData test( name );
+      test.setDependenciesFromPackedString( dependencies );
+      suite.add( CppUT::makeTestCase( LoggedTest( log, name, passes ), test ) );
+   }
+
+
+   /// Returns ten benchmark samples in nanoseconds around the given median.
+   Json::Value benchmarkSamples( double median )
+   {
+      Json::Value samples( Json::arrayValue );
+      for ( int sample = -5; sample < 5; ++sample )
+         samples.append( median + sample );
+      return samples;
+   }
+
+
+   /// A test storing benchmark samples, as a benchmark would, without timing anything.
+   struct FakeBenchmark
+   {
+      FakeBenchmark( double median )
+         : median_( median )
+      {
+      }
+
+      void operator()() const
+      {
+         Json::Value benchmark;
+         benchmark["samples_ns"] = benchmarkSamples( median_ );
+         CppUT::TestInfo::threadInstance().testStatus().setStatistics( "benchmark", benchmark );
+      }
+
+      double median_;
+   };
+
+
+   /// A flag set by one thread and polled by others.
+   class Latch
+   {
+   public:
+      Latch()
+         : isSet_( false )
+      {
+      }
+
+      void set()
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         isSet_ = true;
+      }
+
+      bool isSet() const
+      {
+         CppTL::Mutex::ScopedLockGuard guard( lock_ );
+         return isSet_;
+      }
+
+   private:
+      mutable CppTL::Mutex lock_;
+      bool isSet_;
+   };
+
+   Latch hangingTestRelease;
+
+   /// Runs until released by the test that ran it in a runner.
+   void hangingTest()
+   {
+      while ( !hangingTestRelease.isSet() )
+         CppTL::Thread::sleep( 5 );
+   }
+
+   /// Runs until its worker process is killed.
+   void hangingForeverTest()
+   {
+      for ( ;; )
+         CppTL::Thread::sleep( 5 );
+   }
+
+
+   /// Returns a suite running a test that hangs between two passing tests.
+   /// The suite is never destroyed: the thread of the timed out test may
+   /// outlive the test runner.
+   CppUT::Suite &makeHangingSuite( const std::string &name,
+                                   void (*hang)() )
+   {
+      CppUT::Suite *suite = new CppUT::Suite( name );
+      suite->add( CppUT::makeTestCase( &passingTest, "before" ) );
+      CppUT::MetaData hanging( "hangs" );
+      hanging.setTimeOut( 0.05 );
+      suite->add( CppUT::makeTestCase( hang, hanging ) );
+      suite->add( CppUT::makeTestCase( &passingTest, "after" ) );
+      return *suite;
+   }
+
+
+   void checkHangingTestTimedOut( const RecordingReporter &reporter )
+   {
+      CPPUT_ASSERT( reporter.results_.size() == 3 );
+      const RecordingReporter::Result *hanging = reporter.find( "hangs" );
+      CPPUT_ASSERT( hanging != 0 );
+      CPPUT_CHECK( hanging->status_.hasFailed() );
+      CPPUT_CHECK( hanging->report_.find( "Test timed out after" ) != std::string::npos );
+      CPPUT_CHECK( !reporter.find( "before" )->status_.hasFailed() );
+      CPPUT_CHECK( !reporter.find( "after" )->status_.hasFailed() );
+      CPPUT_CHECK( reporter.summary_.testFailed_ == 1 );
+   }
+
+
+#if CPPUT_HAS_FORK
+   void crashingTest()
+   {
+      abort();
+   }
+
+
+   void exitingTest()
+   {
+      _exit( 3 );
+   }
+#endif
+
+}
+
+
+CPPUT_SUITE( "LightTestRunner" ) {
+
+CPPUT_TEST_FUNCTION( testParallelRunRunsEachTestOnceInPlanOrder )
+{
+   const unsigned int testCount = 40;
+   RunCounter counter( testCount );
+   CppUT::Suite suite( "ParallelRun" );
+   for ( unsigned int index = 0; index < testCount; ++index )
+      suite.add( CppUT::makeTestCase( CountedTest( counter, index ), testName( index ) ) );
+
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setThreadCount( 4 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( RunnerThread::run( runner ) );
+
+   CPPUT_ASSERT( reporter.results_.size() == testCount );
+   for ( unsigned int index = 0; index < testCount; ++index )
+   {
+      CPPUT_CHECK( counter.count( index ) == 1 );
+      CPPUT_CHECK( reporter.results_[index].path_ == "/ParallelRun/" + testName( index ) );
+   }
+   CPPUT_CHECK( reporter.summary_.testRun_ == testCount );
+   CPPUT_CHECK( reporter.summary_.testFailed_ == 0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testShardsPartitionThePlan )
+{
+   const unsigned int testCount = 30;
+   const unsigned int shardCount = 4;
+   RunCounter counter( testCount );
+   CppUT::Suite suite( "Sharded" );
+   for ( unsigned int index = 0; index < testCount; ++index )
+      suite.add( CppUT::makeTestCase( CountedTest( counter, index ), testName( index ) ) );
+
+   std::set<std::string> runPaths;
+   unsigned int runCount = 0;
+   for ( unsigned int shard = 0; shard < shardCount; ++shard )
+   {
+      RecordingReporter reporter;
+      CppUT::LightTestRunner runner;
+      runner.setReporter( reporter );
+      runner.setShard( shard, shardCount );
+      runner.addSuite( suite );
+      CPPUT_CHECK( RunnerThread::run( runner ) );
+      for ( RecordingReporter::Results::const_iterator it = reporter.results_.begin();
+            it != reporter.results_.end();
+            ++it )
+      {
+         runPaths.insert( it->path_ );
+         ++runCount;
+      }
+   }
+
+   // Disjoint shards: no test is reported twice. Complete: all the tests ran.
+   CPPUT_CHECK( runCount == testCount );
+   CPPUT_CHECK( runPaths.size() == testCount );
+   for ( unsigned int index = 0; index < testCount; ++index )
+      CPPUT_CHECK( counter.count( index ) == 1 );
+}
+
+
+CPPUT_TEST_FUNCTION( testShardsDoNotDependOnTimingCache )
+{
+   const unsigned int testCount = 30;
+   const unsigned int shardCount = 3;
+   RunCounter counter( testCount );
+   CppUT::Suite suite( "TimedShards" );
+   for ( unsigned int index = 0; index < testCount; ++index )
+      suite.add( CppUT::makeTestCase( CountedTest( counter, index ), testName( index ) ) );
+
+   // A skewed history, rewritten by each shard run with the measured durations.
+   const std::string cachePath = "lighttestrunnertest.timings";
+   FILE *cache = fopen( cachePath.c_str(), "wt" );
+   CPPUT_ASSERT( cache != 0 );
+   fprintf( cache, "{ \"/TimedShards/test00\" : 10, \"/TimedShards/test01\" : 5 }\n" );
+   fclose( cache );
+
+   for ( unsigned int shard = 0; shard < shardCount; ++shard )
+   {
+      std::set<std::string> paths = runShard( suite, shard, shardCount );
+      CPPUT_CHECK( runShard( suite, shard, shardCount, cachePath ) == paths );
+   }
+   remove( cachePath.c_str() );
+   for ( unsigned int index = 0; index < testCount; ++index )
+      CPPUT_CHECK( counter.count( index ) == 2 );
+}
+
+
+CPPUT_TEST_FUNCTION( testDependentRunsAfterItsPrerequisite )
+{
+   const unsigned int threadCounts[] = { 1, 3 };
+   for ( unsigned int mode = 0; mode < 2; ++mode )
+   {
+      RunLog log;
+      CppUT::Suite suite( "Ordered" );
+      addLoggedTest( suite, log, "dependent", "prerequisite" );
+      addLoggedTest( suite, log, "independent" );
+      addLoggedTest( suite, log, "prerequisite" );
+      RecordingReporter reporter;
+      CppUT::LightTestRunner runner;
+      runner.setReporter( reporter );
+      runner.setThreadCount( threadCounts[mode] );
+      runner.addSuite( suite );
+      CPPUT_CHECK( RunnerThread::run( runner ) );
+
+      CPPUT_CHECK( log.rankOf( "prerequisite" ) >= 0 );
+      CPPUT_CHECK( log.rankOf( "dependent" ) > log.rankOf( "prerequisite" ) );
+      CPPUT_CHECK( log.rankOf( "independent" ) >= 0 );
+      // Still reported in the plan order.
+      CPPUT_ASSERT( reporter.results_.size() == 3 );
+      CPPUT_CHECK( reporter.results_[0].path_ == "/Ordered/dependent" );
+      CPPUT_CHECK( reporter.summary_.testFailed_ == 0 );
+   }
+}
+
+
+CPPUT_TEST_FUNCTION( testDependentsOfFailedTestAreSkipped )
+{
+   RunLog log;
+   CppUT::Suite suite( "FailedPrerequisite" );
+   addLoggedTest( suite, log, "prerequisite", "", false );
+   addLoggedTest( suite, log, "dependent", "prerequisite" );
+   addLoggedTest( suite, log, "transitive", "dependent" );
+   addLoggedTest( suite, log, "independent" );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setThreadCount( 2 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( !RunnerThread::run( runner ) );
+
+   CPPUT_CHECK( log.rankOf( "dependent" ) == -1 );
+   CPPUT_CHECK( log.rankOf( "transitive" ) == -1 );
+   CPPUT_CHECK( log.rankOf( "independent" ) >= 0 );
+   CPPUT_ASSERT( reporter.results_.size() == 4 );
+   CPPUT_CHECK( reporter.find( "prerequisite" )->status_.hasFailed() );
+   const RecordingReporter::Result *dependent = reporter.find( "dependent" );
+   CPPUT_CHECK( dependent->status_.wasSkipped() );
+   CPPUT_CHECK( dependent->report_.find( "Prerequisite /FailedPrerequisite/prerequisite did not pass." ) 
+                != std::string::npos );
+   const RecordingReporter::Result *transitive = reporter.find( "transitive" );
+   CPPUT_CHECK( transitive->status_.wasSkipped() );
+   CPPUT_CHECK( transitive->report_.find( "Prerequisite /FailedPrerequisite/dependent did not pass." ) 
+                != std::string::npos );
+   CPPUT_CHECK( reporter.summary_.testFailed_ == 1 );
+   CPPUT_CHECK( reporter.summary_.testSkipped_ == 2 );
+}
+
+
+CPPUT_TEST_FUNCTION( testOnlyDependencyCyclesAreFaulted )
+{
+   RunLog log;
+   CppUT::Suite suite( "Cycles" );
+   addLoggedTest( suite, log, "first", "second" );
+   addLoggedTest( suite, log, "second", "first" );
+   addLoggedTest( suite, log, "itself", "itself" );
+   addLoggedTest( suite, log, "dependent", "independent first" );
+   addLoggedTest( suite, log, "independent" );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.addSuite( suite );
+   CPPUT_CHECK( !RunnerThread::run( runner ) );
+
+   CPPUT_ASSERT( reporter.results_.size() == 5 );
+   const char *cycleMembers[] = { "first", "second", "itself" };
+   for ( unsigned int index = 0; index < 3; ++index )
+   {
+      const RecordingReporter::Result *member = reporter.find( cycleMembers[index] );
+      CPPUT_CHECK( member->status_.hasFailed() );
+      CPPUT_CHECK( member->report_.find( "Circular dependency" ) != std::string::npos );
+      CPPUT_CHECK( log.rankOf( cycleMembers[index] ) == -1 );
+   }
+   // Depending on a cycle is not a cycle: the dependent is skipped, not faulted.
+   const RecordingReporter::Result *dependent = reporter.find( "dependent" );
+   CPPUT_CHECK( dependent->status_.wasSkipped() );
+   CPPUT_CHECK( dependent->report_.find( "Circular dependency" ) == std::string::npos );
+   CPPUT_CHECK( log.rankOf( "dependent" ) == -1 );
+   CPPUT_CHECK( !reporter.find( "independent" )->status_.hasFailed() );
+   CPPUT_CHECK( log.rankOf( "independent" ) >= 0 );
+   CPPUT_CHECK( reporter.summary_.testFailed_ == 3 );
+}
+
+
+CPPUT_TEST_FUNCTION( testRegressedBenchmarkFailsBeforeItsDependentsRun )
+{
+   const std::string baselinePath = "lighttestrunnertest.baseline";
+   Json::Value baseline;
+   baseline["/Baseline/regressed"]["samples_ns"] = benchmarkSamples( 100 );
+   baseline["/Baseline/steady"]["samples_ns"] = benchmarkSamples( 100 );
+   FILE *file = fopen( baselinePath.c_str(), "wt" );
+   CPPUT_ASSERT( file != 0 );
+   fprintf( file, "%s", Json::FastWriter().write( baseline ).c_str() );
+   fclose( file );
+
+   // Serially, with threads, then with processes.
+   for ( unsigned int mode = 0; mode < 3; ++mode )
+   {
+#if !CPPUT_HAS_FORK
+      if ( mode == 2 )
+         break;
+#endif
+      RunLog log;
+      CppUT::Suite suite( "Baseline" );
+      suite.add( CppUT::makeTestCase( FakeBenchmark( 200 ), "regressed" ) );
+      addLoggedTest( suite, log, "dependent", "regressed" );
+      suite.add( CppUT::makeTestCase( FakeBenchmark( 100 ), "steady" ) );
+      RecordingReporter reporter;
+      CppUT::LightTestRunner runner;
+      runner.setReporter( reporter );
+      runner.setBenchmarkBaselineFile( baselinePath );
+      if ( mode == 1 )
+         runner.setThreadCount( 2 );
+#if CPPUT_HAS_FORK
+      if ( mode == 2 )
+         runner.setProcessCount( 2 );
+#endif
+      runner.addSuite( suite );
+      CPPUT_CHECK( !RunnerThread::run( runner ) );
+
+      CPPUT_ASSERT( reporter.results_.size() == 3 );
+      const RecordingReporter::Result *regressed = reporter.find( "regressed" );
+      CPPUT_CHECK( regressed->status_.hasFailed() );
+      const std::string::size_type at = regressed->report_.find( "Benchmark regressed" );
+      CPPUT_CHECK( at != std::string::npos );
+      CPPUT_CHECK( regressed->report_.find( "Benchmark regressed", at + 1 ) == std::string::npos );
+      CPPUT_CHECK( reporter.find( "dependent" )->status_.wasSkipped() );
+      CPPUT_CHECK( log.rankOf( "dependent" ) == -1 );
+      CPPUT_CHECK( !reporter.find( "steady" )->status_.hasFailed() );
+
+      CPPUT_ASSERT( reporter.deltas_.size() == 2 );
+      CPPUT_CHECK( std::string( reporter.deltas_[0].path_.c_str() ) == "/Baseline/regressed" );
+      CPPUT_CHECK( reporter.deltas_[0].isRegression_ );
+      CPPUT_CHECK( std::string( reporter.deltas_[1].path_.c_str() ) == "/Baseline/steady" );
+      CPPUT_CHECK( !reporter.deltas_[1].isRegression_ );
+   }
+   remove( baselinePath.c_str() );
+}
+
+
+CPPUT_TEST_FUNCTION( testTextReporterStreamsEachResult )
+{
+   CppUT::Suite suite( "Reported" );
+   suite.add( CppUT::makeTestCase( &passingTest, "passes" ) );
+   suite.add( CppUT::makeTestCase( &failingTest, "fails" ) );
+   FILE *output = tmpfile();
+   CPPUT_ASSERT( output != 0 );
+   {
+      CppUT::LightTextReporter reporter( output );
+      CppUT::LightTestRunner runner;
+      runner.setReporter( reporter );
+      runner.addSuite( suite );
+      CPPUT_CHECK( !RunnerThread::run( runner ) );
+   }
+   const std::string text = readBack( output );
+   fclose( output );
+
+   const std::string passedLine = "Testing /Reported/passes : OK (0 assertion)\n";
+   const std::string failedLine = "Testing /Reported/fails : FAIL (1 assertion failed/1 assertion)\n";
+   const std::string summaryLine = "1/2 tests passed, 1 tests failed (1 assertion).\n";
+   CPPUT_ASSERT( text.compare( 0, passedLine.length(), passedLine ) == 0 );
+   const std::string::size_type failedAt = text.find( failedLine );
+   CPPUT_ASSERT( failedAt == passedLine.length() );
+   const std::string::size_type summaryAt = text.find( summaryLine );
+   CPPUT_ASSERT( summaryAt != std::string::npos );
+   // The failure report comes between the status of the failed test and the summary.
+   CPPUT_CHECK( summaryAt > failedAt + failedLine.length() );
+   CPPUT_CHECK( text.find( "Slowest tests:" ) == std::string::npos );
+}
+
+
+CPPUT_TEST_FUNCTION( testHistogramBucketsGrowTenfold )
+{
+   typedef CppUT::LightTestTimings Timings;
+   CPPUT_CHECK( Timings::bucketOf( 0 ) == 0 );
+   CPPUT_CHECK( Timings::bucketOf( 9e-6 ) == 0 );
+   CPPUT_CHECK( Timings::bucketOf( 1e-5 ) == 1 );
+   CPPUT_CHECK( Timings::bucketOf( 5e-4 ) == 2 );
+   CPPUT_CHECK( Timings::bucketOf( 0.02 ) == 4 );
+   CPPUT_CHECK( Timings::bucketOf( 1000 ) == Timings::histogramSize - 1 );
+   for ( unsigned int bucket = 0; bucket + 1 < Timings::histogramSize; ++bucket )
+   {
+      CPPUT_CHECK( Timings::bucketOf( Timings::bucketUpperBound( bucket ) * 0.99 ) == bucket );
+      CPPUT_CHECK( Timings::bucketOf( Timings::bucketUpperBound( bucket ) ) == bucket + 1 );
+   }
+}
+
+
+CPPUT_TEST_FUNCTION( testTimingReportHasSlowestTestsAndPhases )
+{
+   CppUT::Suite suite( "Timed" );
+   suite.add( CppUT::makeTestCase( &passingTest, "fast" ) );
+   suite.add( CppUT::makeTestCase( &slowTest, "slow" ) );
+   suite.add( CppUT::makeTestCase( &passingTest, "alsoFast" ) );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setTimingReport( 2 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( RunnerThread::run( runner ) );
+
+   const CppUT::LightTestTimings &timings = reporter.timings_;
+   CPPUT_ASSERT( timings.slowest_.size() == 2 );
+   const CppUT::LightTestTimings::SlowTest &slowest = timings.slowest_[0];
+   CPPUT_CHECK( std::string( slowest.path_.c_str() ) == "/Timed/slow" );
+   CPPUT_CHECK( slowest.duration_ >= 0.02 );
+   CPPUT_CHECK( slowest.duration_ >= timings.slowest_[1].duration_ );
+   static const char *phases[] = { "setUp", "run", "tearDown", "destruction" };
+   for ( unsigned int index = 0; index < sizeof(phases)/sizeof(phases[0]); ++index )
+   {
+      CPPUT_CHECK( slowest.timing_.isMember( phases[index] ) );
+      CPPUT_CHECK( slowest.timing_[ phases[index] ]["wall"].asDouble() >= 0 );
+   }
+   CPPUT_CHECK( slowest.timing_["run"]["wall"].asDouble() >= 0.02 );
+
+   CPPUT_ASSERT( timings.histogram_.size() == CppUT::LightTestTimings::histogramSize );
+   unsigned int bucketedCount = 0;
+   for ( unsigned int bucket = 0; bucket < timings.histogram_.size(); ++bucket )
+      bucketedCount += timings.histogram_[bucket];
+   CPPUT_CHECK( bucketedCount == 3 );
+   CPPUT_CHECK( timings.histogram_[ CppUT::LightTestTimings::bucketOf( slowest.duration_ ) ] >= 1 );
+}
+
+
+CPPUT_TEST_FUNCTION( testLastRunFileIsOnlyWrittenWhenUsed )
+{
+   const char *program = "lighttestrunnertest";
+   const std::string lastRunPath = std::string( program ) + ".lastrun";
+   remove( lastRunPath.c_str() );
+   const char *plainArgs[] = { program };
+   CPPUT_CHECK( runWithCommandLine( 1, plainArgs ) );
+   CPPUT_CHECK( !fileExists( lastRunPath ) );
+
+   const char *failedFirstArgs[] = { program, "--failed-first" };
+   CPPUT_CHECK( runWithCommandLine( 2, failedFirstArgs ) );
+   CPPUT_CHECK( fileExists( lastRunPath ) );
+   remove( lastRunPath.c_str() );
+
+   const char *disabledArgs[] = { program, "--failures-only", "--last-run=" };
+   CPPUT_CHECK( runWithCommandLine( 3, disabledArgs ) );
+   CPPUT_CHECK( !fileExists( lastRunPath ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testRepeatedTestsAreAggregated )
+{
+   RunCounter counter( 1 );
+   CppUT::Suite suite( "Repeated" );
+   suite.add( CppUT::makeTestCase( CountedTest( counter, 0 ), "counted" ) );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setRepeatCount( 4 );
+   runner.setConcurrentCopies( 3 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( RunnerThread::run( runner ) );
+
+   CPPUT_ASSERT( reporter.results_.size() == 1 );
+   CPPUT_CHECK( counter.count( 0 ) == 12 );
+   const Json::Value &statistics = reporter.results_[0].status_.statistics()["repeat"];
+   CPPUT_CHECK( statistics["runs"].asUInt() == 12 );
+   CPPUT_CHECK( statistics["failed"].asUInt() == 0 );
+   CPPUT_CHECK( reporter.results_[0].report_.find( "12 runs on 3 threads, 12 passed" ) != std::string::npos );
+}
+
+
+CPPUT_TEST_FUNCTION( testRepeatUntilFailureStopsAtFirstFailedRun )
+{
+   RunCounter counter( 1 );
+   CppUT::Suite suite( "UntilFailure" );
+   suite.add( CppUT::makeTestCase( FailingThirdRunTest( counter ), "flaky" ) );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setRepeatCount( 0 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( !RunnerThread::run( runner ) );
+
+   CPPUT_ASSERT( reporter.results_.size() == 1 );
+   CPPUT_CHECK( counter.count( 0 ) == 3 );
+   CPPUT_CHECK( reporter.results_[0].status_.hasFailed() );
+   CPPUT_CHECK( reporter.results_[0].status_.statistics()["repeat"]["failed"].asUInt() == 1 );
+}
+
+
+CPPUT_TEST_FUNCTION( testTimedOutThreadIsAbandoned )
+{
+   CppUT::Suite &suite = makeHangingSuite( "ThreadTimeOut", &hangingTest );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setThreadCount( 2 );
+   runner.addSuite( suite );
+   const bool succeeded = RunnerThread::run( runner );
+   // The abandoned worker thread exits once the test returns.
+   hangingTestRelease.set();
+   CPPUT_CHECK( !succeeded );
+   checkHangingTestTimedOut( reporter );
+}
+
+
+#if CPPUT_HAS_FORK
+CPPUT_TEST_FUNCTION( testTimedOutProcessIsKilled )
+{
+   CppUT::Suite &suite = makeHangingSuite( "ProcessTimeOut", &hangingForeverTest );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   runner.setProcessCount( 2 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( !RunnerThread::run( runner ) );
+   checkHangingTestTimedOut( reporter );
+}
+
+
+CPPUT_TEST_FUNCTION( testCrashedProcessIsReportedAndReplaced )
+{
+   CppUT::Suite suite( "ProcessCrash" );
+   suite.add( CppUT::makeTestCase( &passingTest, "before" ) );
+   suite.add( CppUT::makeTestCase( &crashingTest, "crashes" ) );
+   suite.add( CppUT::makeTestCase( &exitingTest, "exits" ) );
+   suite.add( CppUT::makeTestCase( &passingTest, "after" ) );
+   RecordingReporter reporter;
+   CppUT::LightTestRunner runner;
+   runner.setReporter( reporter );
+   // A single worker process: each test after a crash needs a new one.
+   runner.setProcessCount( 1 );
+   runner.addSuite( suite );
+   CPPUT_CHECK( !RunnerThread::run( runner ) );
+
+   CPPUT_ASSERT( reporter.results_.size() == 4 );
+   const RecordingReporter::Result *crashed = reporter.find( "crashes" );
+   CPPUT_CHECK( crashed->status_.hasFailed() );
+   CPPUT_CHECK( crashed->report_.find( "Test process crashed (signal" ) != std::string::npos );
+   const RecordingReporter::Result *exited = reporter.find( "exits" );
+   CPPUT_CHECK( exited->status_.hasFailed() );
+   CPPUT_CHECK( exited->report_.find( "exited unexpectedly (exit code 3)" ) != std::string::npos );
+   CPPUT_CHECK( !reporter.find( "before" )->status_.hasFailed() );
+   CPPUT_CHECK( !reporter.find( "after" )->status_.hasFailed() );
+   CPPUT_CHECK( reporter.summary_.testFailed_ == 2 );
+}
+#endif
+
+} // end suite LightTestRunner
+
+#endif // #if CPPTL_HAS_THREAD
@@ -120,6 +120,8 @@ int main( int argc, const char *argv[] )
 */
 
    CppUT::LightTestRunner runner;
+   if ( !runner.parseCommandLine( argc, argv ) )
+      return 2;
    runner.addSuite( cpputSuite );
    bool sucessful = runner.runTests();
    return sucessful ? 0 : 1;
@@ -0,0 +1,48 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/perfcounters.h>
+
+
+CPPUT_SUITE( "PerfCounters" ) {
+
+CPPUT_TEST_FUNCTION( testValuesToJson )
+{
+   CppUT::PerfCounterValues values;
+   values.set( CppUT::perfCycles, 200 );
+   values.set( CppUT::perfInstructions, 300 );
+   Json::Value json = values.toJson( 100 );
+   CPPUT_CHECK( json["cycles"].asDouble() == 2.0 );
+   CPPUT_CHECK( json["instructions"].asDouble() == 3.0 );
+   CPPUT_CHECK( json["ipc"].asDouble() == 1.5 );
+   CPPUT_CHECK( !json.isMember( "cache_misses" ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testAddKeepsCommonCounters )
+{
+   CppUT::PerfCounterValues total;
+   CppUT::PerfCounterValues first;
+   first.set( CppUT::perfCycles, 10 );
+   first.set( CppUT::perfPageFaults, 1 );
+   CppUT::PerfCounterValues second;
+   second.set( CppUT::perfPageFaults, 2 );
+   total.add( first );
+   total.add( second );
+   CPPUT_CHECK( !total.isAvailable( CppUT::perfCycles ) );
+   CPPUT_CHECK( total.isAvailable( CppUT::perfPageFaults ) );
+   CPPUT_CHECK( total.value( CppUT::perfPageFaults ) == 3.0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testCountersMeasureTheThread )
+{
+   CppUT::PerfCounters counters;
+   counters.start();
+   CppUT::PerfCounterValues values = counters.stop();
+   if ( counters.hasHardwareCounters() )
+      CPPUT_CHECK( values.isAvailable( CppUT::perfInstructions ) );
+   for ( int counter = 0; counter < CppUT::perfCounterCount; ++counter )
+      CPPUT_CHECK( values.value( CppUT::PerfCounter(counter) ) >= 0 );
+}
+
+} // end suite PerfCounters
@@ -1,5 +1,6 @@
 #include <cpput/testing.h>
 #include <cpput/assertcommon.h>
+#include <cpptl/stringtools.h>
 //#include "minitestrunner.h"
 
 // @todo test in the presence of a default suite
@@ -28,6 +29,173 @@ CPPUT_SUITE( "Root2" ) {
 } // Suite Root2
 
 
+static void emptyTest()
+{
+}
+
+
+CPPUT_SUITE( "FrozenRegistry" ) {
+
+CPPUT_TEST_FUNCTION( testSnapshotIsBreadthFirst )
+{
+   CppUT::Suite suite( "frozen" );
+   CppUT::Suite nested1 = suite.makeNestedSuite( "nested1" );
+   CppUT::Suite nested2 = suite.makeNestedSuite( "nested2" );
+   nested1.makeNestedSuite( "deep" ).add( CppUT::makeTestCase( &emptyTest, "deepTest" ) );
+   nested2.add( CppUT::makeTestCase( &emptyTest, "test2" ) );
+   suite.add( CppUT::makeTestCase( &emptyTest, "test1" ) );
+
+   CppUT::FrozenRegistry registry( suite );
+   CPPUT_ASSERT( registry.suiteCount() == 4 );
+   const CppUT::FrozenRegistry::SuiteEntry &root = registry.suiteAt( 0 );
+   CPPUT_CHECK( root.path_ == "/frozen" );
+   CPPUT_CHECK( root.parent_ == -1 );
+   CPPUT_CHECK( root.firstNestedSuite_ == 1  &&  root.endNestedSuite_ == 3 );
+   CPPUT_CHECK( registry.suiteAt( 3 ).path_ == "/frozen/nested1/deep" );
+   CPPUT_CHECK( registry.suiteAt( 3 ).parent_ == registry.indexOf( nested1 ) );
+   CPPUT_ASSERT( registry.testCount() == 3 );
+   CPPUT_CHECK( registry.testAt( root.firstTest_ ).path_ == "/frozen/test1" );
+   CPPUT_CHECK( registry.testAt( 1 ).path_ == "/frozen/nested2/test2" );
+   CPPUT_CHECK( registry.testAt( 2 ).path_ == "/frozen/nested1/deep/deepTest" );
+   CPPUT_CHECK( registry.testAt( 2 ).suite_ == 3 );
+   CPPUT_CHECK( registry.indexOf( CppUT::Suite() ) == -1 );
+}
+
+
+CPPUT_TEST_FUNCTION( testRegistryIsFrozenByRunner )
+{
+   CPPUT_ASSERT( CppUT::Registry::isFrozen() );
+   const CppUT::FrozenRegistry &registry = CppUT::Registry::freeze();
+   CPPUT_CHECK( registry.suiteAt( 0 ).path_ == "/" );
+   CppUT::Suite root1Suite = CppUT::Registry::getRootSuite().nestedSuiteByName( "Root1" );
+   int index = registry.indexOf( root1Suite );
+   CPPUT_ASSERT( index > 0 );
+   const CppUT::FrozenRegistry::SuiteEntry &root1 = registry.suiteAt( index );
+   CPPUT_CHECK( root1.path_ == "//Root1" );
+   CPPUT_CHECK( root1.endTest_ - root1.firstTest_ == 2 );
+   CPPUT_CHECK( registry.testAt( root1.firstTest_ ).path_ == "//Root1/testRoot1Test1" );
+}
+
+} // end suite FrozenRegistry
+
+
+CPPUT_SUITE( "SuiteLookup" ) {
+
+CPPUT_TEST_FUNCTION( testLookupAmongManyNestedSuites )
+{
+   CppUT::Suite suite( "lookup" );
+   std::vector<CppUT::Suite> nestedSuites;
+   for ( int index = 0; index < 100; ++index )
+      nestedSuites.push_back( suite.makeNestedSuite( "nested" + std::string( CppTL::toString( index ).c_str() ) ) );
+   CPPUT_ASSERT( suite.nestedSuiteCount() == 100 );
+   CPPUT_CHECK( suite.nestedSuiteByName( "nested0" ) == nestedSuites[0] );
+   CPPUT_CHECK( suite.nestedSuiteByName( "nested99" ) == nestedSuites[99] );
+   CPPUT_CHECK( suite.makeNestedSuite( "nested42" ) == nestedSuites[42] );
+   CPPUT_CHECK( !suite.nestedSuiteByName( "nested100" ).isValid() );
+   CPPUT_CHECK( !suite.nestedSuiteByName( "nested" ).isValid() );
+
+   CppUT::Suite otherSuite( "other" );
+   CppUT::Impl::reparentSuite( otherSuite, nestedSuites[42] );
+   CPPUT_CHECK( suite.nestedSuiteCount() == 99 );
+   CPPUT_CHECK( !suite.nestedSuiteByName( "nested42" ).isValid() );
+   CPPUT_CHECK( suite.nestedSuiteByName( "nested43" ) == nestedSuites[43] );
+   CPPUT_CHECK( otherSuite.nestedSuiteByName( "nested42" ) == nestedSuites[42] );
+}
+
+
+CPPUT_TEST_FUNCTION( testAddSeveralTestCases )
+{
+   CppUT::Suite suite( "batch" );
+   suite.addFixture( "registrytest.fixture" );
+   std::vector<CppUT::TestMeta> testCases;
+   testCases.push_back( CppUT::makeTestCase( &emptyTest, "test1" ) );
+   testCases.push_back( CppUT::makeTestCase( &emptyTest, "test2" ) );
+   suite.add( testCases );
+   CPPUT_ASSERT( suite.testCaseCount() == 2 );
+   CPPUT_CHECK( suite.testCaseAt( 1 )->name() == "test2" );
+   CPPUT_CHECK( suite.testCaseAt( 1 )->resourceCount() == 1 );
+}
+
+} // end suite SuiteLookup
+
+
+// Registered without a suite declaration, in //StaticTests.
+CPPUT_STATIC_TEST_FUNCTION( "StaticTests", testStaticTestIsRegistered )
+{
+   CppUT::Suite suite = CppUT::Registry::getRootSuite().nestedSuiteByName( "StaticTests" );
+   CPPUT_ASSERT( suite.isValid() );
+   // Only visible in the frozen registry.
+   CPPUT_CHECK( suite.testCaseCount() == 0 );
+   const CppUT::FrozenRegistry &registry = CppUT::Registry::freeze();
+   const CppUT::FrozenRegistry::SuiteEntry &entry = registry.suiteAt( registry.indexOf( suite ) );
+   CPPUT_ASSERT( entry.endTest_ - entry.firstTest_ == 1 );
+   CPPUT_CHECK( registry.testAt( entry.firstTest_ ).path_ == "//StaticTests/testStaticTestIsRegistered" );
+   CPPUT_CHECK( registry.testAt( entry.firstTest_ ).descriptor_ != 0 );
+}
+
+
+CPPUT_STATIC_TEST_FUNCTION_WITH_META( "StaticTests/Nested", testStaticTestHasMetaData,
+                                      "static test", 30.0, "registry static" )
+{
+   CppUT::Suite suite = CppUT::Registry::getRootSuite().nestedSuiteByName( "StaticTests" )
+                                                       .nestedSuiteByName( "Nested" );
+   const CppUT::FrozenRegistry &registry = CppUT::Registry::freeze();
+   const CppUT::FrozenRegistry::SuiteEntry &entry = registry.suiteAt( registry.indexOf( suite ) );
+   CPPUT_ASSERT( entry.endTest_ - entry.firstTest_ == 1 );
+   const CppUT::TestMeta &test = registry.testMetaAt( entry.firstTest_ );
+   CPPUT_CHECK( &test == registry.testAt( entry.firstTest_ ).test_ );
+   CPPUT_CHECK( test.name() == "testStaticTestHasMetaData" );
+   CPPUT_CHECK( test.description() == "static test" );
+   CPPUT_CHECK( test.timeOut() == 30.0 );
+   CPPUT_ASSERT( test.groupCount() == 2 );
+   CPPUT_CHECK( test.groupAt( 1 ) == "static" );
+}
+
+
+// The registrations of the next suite are profiled: static initialization
+// follows the order of the definitions within a translation unit.
+static bool wasProfilingRegistration = CppUT::Registry::setRegistrationProfiling( true );
+
+CPPUT_SUITE( "RegistrationProfile" ) {
+
+static bool
+endsWith( const std::string &text,
+          const std::string &suffix )
+{
+   return text.length() >= suffix.length()
+          &&  text.compare( text.length() - suffix.length(), suffix.length(), suffix ) == 0;
+}
+
+
+CPPUT_TEST_FUNCTION( testStaticRegistrationsAreRecorded )
+{
+   CppUT::RegistrationProfile profile = CppUT::Registry::registrationProfile();
+   const CppUT::RegistrationProfileEntry *suiteCreation = 0;
+   const CppUT::RegistrationProfileEntry *testRegistration = 0;
+   for ( CppUT::RegistrationProfile::const_iterator it = profile.begin(); it != profile.end(); ++it )
+   {
+      if ( !endsWith( it->suitePath_, "/RegistrationProfile" ) )
+         continue;
+      if ( it->createdSuiteCount_ > 0  &&  suiteCreation == 0 )
+         suiteCreation = &*it;
+      if ( it->testName_ == "testStaticRegistrationsAreRecorded" )
+         testRegistration = &*it;
+   }
+   CPPUT_ASSERT( suiteCreation != 0 );
+   CPPUT_CHECK( suiteCreation->createdSuiteCount_ == 1 );
+   CPPUT_ASSERT( testRegistration != 0 );
+   CPPUT_CHECK( testRegistration->testCount_ == 1 );
+   CPPUT_CHECK( testRegistration->duration_ >= 0 );
+   // The suite is created before its tests are added to it.
+   CPPUT_CHECK( suiteCreation < testRegistration );
+}
+
+} // end suite RegistrationProfile
+
+static bool profiledRegistrationProfileSuite =
+   CppUT::Registry::setRegistrationProfiling( wasProfilingRegistration );
+
+
 // Need to test that the structure of the root tree match the expected one.
 
 static bool
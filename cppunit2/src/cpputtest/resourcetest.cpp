@@ -0,0 +1,185 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/resource.h>
+#include <cpptl/thread.h>
+
+namespace {
+
+   int liveCount = 0;
+   int createdCount = 0;
+
+   class CountedResource : public CppUT::Resource
+   {
+   public:
+      CountedResource()
+      {
+         ++liveCount;
+         ++createdCount;
+      }
+
+      virtual ~CountedResource()
+      {
+         --liveCount;
+      }
+   };
+
+   CppUT::Resource *createCountedResource()
+   {
+      return new CountedResource();
+   }
+
+   void dummyTest()
+   {
+   }
+
+   void registerCountedResource( const char *name )
+   {
+      liveCount = 0;
+      createdCount = 0;
+      CppUT::ResourceRegistry::add( name, CppTL::cfn0r( &createCountedResource ) );
+   }
+
+
+#if CPPTL_HAS_THREAD
+   CppUT::Resource *createNoResource()
+   {
+      return 0;
+   }
+
+
+   CppUT::TestCase *createNoTestCase()
+   {
+      return 0;
+   }
+
+
+   /* Runs a test in a thread of its own. Run in the calling thread, the test
+    * would replace the TestInfo of the running test.
+    */
+   class TestThread
+   {
+   public:
+      static bool run( const CppUT::TestMeta &test )
+      {
+         TestThread testThread( test );
+         CppTL::Thread thread;
+         if ( !thread.start( CppTL::memfn0( &testThread, &TestThread::runTest ) ) )
+            return false;
+         thread.join();
+         return testThread.succeeded_;
+      }
+
+   private:
+      TestThread( const CppUT::TestMeta &test )
+         : test_( test )
+         , succeeded_( false )
+      {
+      }
+
+      void runTest()
+      {
+         succeeded_ = test_.runTest();
+      }
+
+      const CppUT::TestMeta &test_;
+      bool succeeded_;
+   };
+#endif
+
+}
+
+
+CPPUT_SUITE( "Resource" ) {
+
+CPPUT_TEST_FUNCTION( testResourceIsCreatedOnceAndDestroyedAfterLastUse )
+{
+   registerCountedResource( "resourcetest.shared" );
+   CppUT::ResourceRegistry::reserve( "resourcetest.shared" );
+   CppUT::ResourceRegistry::reserve( "resourcetest.shared" );
+   CPPUT_CHECK( liveCount == 0 );
+
+   CppUT::ResourceRegistry::acquire( "resourcetest.shared" );
+   CPPUT_CHECK( liveCount == 1 );
+   CppUT::ResourceRegistry::release( "resourcetest.shared" );
+   CPPUT_CHECK( liveCount == 1 );   // still reserved by the second test
+
+   CppUT::ResourceRegistry::acquire( "resourcetest.shared" );
+   CPPUT_CHECK( createdCount == 1 );
+   CppUT::ResourceRegistry::release( "resourcetest.shared" );
+   CPPUT_CHECK( liveCount == 0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testCancelReservationsDestroysUnusedResources )
+{
+   registerCountedResource( "resourcetest.cancelled" );
+   CppUT::ResourceRegistry::reserve( "resourcetest.cancelled" );
+   CppUT::ResourceRegistry::reserve( "resourcetest.cancelled" );
+   CppUT::ResourceRegistry::acquire( "resourcetest.cancelled" );
+   CppUT::ResourceRegistry::release( "resourcetest.cancelled" );
+   CPPUT_CHECK( liveCount == 1 );
+   CppUT::ResourceRegistry::cancelReservations();
+   CPPUT_CHECK( liveCount == 0 );
+}
+
+
+CPPUT_TEST_FUNCTION( testGetRequiresAcquiredResource )
+{
+   registerCountedResource( "resourcetest.get" );
+   CPPUT_ASSERT_THROW( CppUT::ResourceRegistry::get( "resourcetest.get" ), std::logic_error );
+   CPPUT_ASSERT_THROW( CppUT::ResourceRegistry::acquire( "resourcetest.unknown" ), std::logic_error );
+   CppUT::ResourceRegistry::acquire( "resourcetest.get" );
+   CountedResource &resource = CppUT::resource<CountedResource>( "resourcetest.get" );
+   CPPUT_CHECK( &resource == &CppUT::resource<CountedResource>( "resourcetest.get" ) );
+   CppUT::ResourceRegistry::release( "resourcetest.get" );
+   CPPUT_CHECK( liveCount == 0 );
+}
+
+#if CPPTL_HAS_THREAD
+CPPUT_TEST_FUNCTION( testReservationsOfTestsNotSetUpAreCancelled )
+{
+   registerCountedResource( "resourcetest.notAcquired" );
+   CppUT::ResourceRegistry::add( "resourcetest.failing", CppTL::cfn0r( &createNoResource ) );
+   // Reserved by a test that can not be created, a test whose first resource
+   // can not be created, and a test that runs.
+   for ( int test = 0; test < 3; ++test )
+      CppUT::ResourceRegistry::reserve( "resourcetest.notAcquired" );
+   CppUT::ResourceRegistry::reserve( "resourcetest.failing" );
+
+   CppUT::MetaData notCreated( "notCreated" );
+   notCreated.requireResource( "resourcetest.notAcquired" );
+   CPPUT_CHECK( !TestThread::run( CppUT::TestMeta( &createNoTestCase, notCreated ) ) );
+   CppUT::MetaData notSetUp( "notSetUp" );
+   notSetUp.requireResource( "resourcetest.failing" );
+   notSetUp.requireResource( "resourcetest.notAcquired" );
+   CPPUT_CHECK( !TestThread::run( CppUT::makeTestCase( &dummyTest, notSetUp ) ) );
+   CPPUT_CHECK( createdCount == 0 );
+
+   CppUT::MetaData runs( "runs" );
+   runs.requireResource( "resourcetest.notAcquired" );
+   CPPUT_CHECK( TestThread::run( CppUT::makeTestCase( &dummyTest, runs ) ) );
+   CPPUT_CHECK( createdCount == 1 );
+   // Destroyed after its last use, rather than at the end of the run.
+   CPPUT_CHECK( liveCount == 0 );
+}
+#endif
+
+
+CPPUT_TEST_FUNCTION( testSuiteFixtureIsRequiredByNestedTests )
+{
+   CppUT::Suite suite( "resourcetest" );
+   CppUT::Suite nestedSuite = suite.makeNestedSuite( "nested" );
+   nestedSuite.add( CppUT::makeTestCase( &dummyTest, "before" ) );
+   suite.addFixture( "resourcetest.fixture" );
+   nestedSuite.add( CppUT::makeTestCase( &dummyTest, "after" ) );
+   nestedSuite.addFixture( "resourcetest.fixture" );
+
+   for ( int index = 0; index < nestedSuite.testCaseCount(); ++index )
+   {
+      const CppUT::TestMeta &test = *nestedSuite.testCaseAt( index );
+      CPPUT_CHECK( test.resourceCount() == 1 );
+      CPPUT_CHECK( test.resourceAt( 0 ) == "resourcetest.fixture" );
+   }
+}
+
+} // end suite Resource
@@ -0,0 +1,84 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/testgroupfilter.h>
+
+namespace {
+
+   CppUT::TestGroupSet groups( const char *first = 0,
+                               const char *second = 0 )
+   {
+      CppUT::TestGroupSet groupSet;
+      if ( first != 0 )
+         groupSet.add( CppUT::TestGroupSet::intern( first ) );
+      if ( second != 0 )
+         groupSet.add( CppUT::TestGroupSet::intern( second ) );
+      return groupSet;
+   }
+
+   bool isSelected( const std::string &expression,
+                    const CppUT::TestGroupSet &groupSet )
+   {
+      CppUT::TestGroupFilter filter;
+      std::string error;
+      CPPUT_ASSERT( filter.setExpression( expression, error ), error );
+      return filter.isSelected( groupSet );
+   }
+
+}
+
+
+CPPUT_SUITE( "TestGroupFilter" ) {
+
+CPPUT_TEST_FUNCTION( testEmptyFilterSelectsAll )
+{
+   CppUT::TestGroupFilter filter;
+   CPPUT_CHECK( filter.isEmpty() );
+   CPPUT_CHECK( filter.isSelected( groups() ) );
+   CPPUT_CHECK( filter.isSelected( groups( "fast" ) ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testOperators )
+{
+   const char *expression = "fast & !db | smoke";
+   CPPUT_CHECK( isSelected( expression, groups( "fast" ) ) );
+   CPPUT_CHECK( !isSelected( expression, groups( "fast", "db" ) ) );
+   CPPUT_CHECK( isSelected( expression, groups( "db", "smoke" ) ) );
+   CPPUT_CHECK( !isSelected( expression, groups( "db" ) ) );
+   CPPUT_CHECK( !isSelected( expression, groups() ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testNegatedParentheses )
+{
+   const char *expression = "!(fast | db & !smoke)";
+   CPPUT_CHECK( isSelected( expression, groups() ) );
+   CPPUT_CHECK( !isSelected( expression, groups( "fast" ) ) );
+   CPPUT_CHECK( !isSelected( expression, groups( "db" ) ) );
+   CPPUT_CHECK( isSelected( expression, groups( "db", "smoke" ) ) );
+   CPPUT_CHECK( isSelected( "!!smoke", groups( "smoke" ) ) );
+   CPPUT_CHECK( !isSelected( "smoke & !smoke", groups( "smoke" ) ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testMetaDataGroups )
+{
+   CppUT::MetaData meta( "grouped" );
+   meta.addToGroup( "fast" );
+   CPPUT_CHECK( isSelected( "fast", meta.groupSet() ) );
+   CPPUT_CHECK( !isSelected( "slow", meta.groupSet() ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testInvalidExpression )
+{
+   CppUT::TestGroupFilter filter;
+   std::string error;
+   CPPUT_CHECK( !filter.setExpression( "fast &", error ) );
+   CPPUT_CHECK( !error.empty() );
+   CPPUT_CHECK( !filter.setExpression( "(fast", error ) );
+   CPPUT_CHECK( !filter.setExpression( "fast smoke", error ) );
+   CPPUT_CHECK( filter.isEmpty() );
+}
+
+} // end suite TestGroupFilter
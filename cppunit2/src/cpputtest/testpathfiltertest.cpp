@@ -0,0 +1,70 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpput/testpathfilter.h>
+
+namespace {
+
+   bool isSelected( CppUT::TestPathFilter &filter,
+                    const std::string &path )
+   {
+      return filter.isSelected( filter.advance( filter.start(), path ) );
+   }
+
+   bool isPruned( CppUT::TestPathFilter &filter,
+                  const std::string &suitePath )
+   {
+      return filter.isPruned( filter.advance( filter.start(), suitePath ) );
+   }
+
+}
+
+
+CPPUT_SUITE( "TestPathFilter" ) {
+
+CPPUT_TEST_FUNCTION( testEmptyFilterSelectsAll )
+{
+   CppUT::TestPathFilter filter;
+   CPPUT_CHECK( filter.isEmpty() );
+   CPPUT_CHECK( isSelected( filter, "//Suite/test" ) );
+   CPPUT_CHECK( !isPruned( filter, "//Suite" ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testGlobMatching )
+{
+   CppUT::TestPathFilter filter;
+   filter.addInclude( "//Suite/test?" );
+   filter.addInclude( "*Parser*" );
+   filter.addInclude( "//Escaped/\\*" );
+   CPPUT_CHECK( isSelected( filter, "//Suite/test1" ) );
+   CPPUT_CHECK( !isSelected( filter, "//Suite/test12" ) );
+   CPPUT_CHECK( !isSelected( filter, "//Suite/test" ) );
+   CPPUT_CHECK( isSelected( filter, "//Json/ParserTest/testEmpty" ) );
+   CPPUT_CHECK( isSelected( filter, "//Escaped/*" ) );
+   CPPUT_CHECK( !isSelected( filter, "//Escaped/a" ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testExclude )
+{
+   CppUT::TestPathFilter filter;
+   filter.addExclude( "*Slow*" );
+   CPPUT_CHECK( isSelected( filter, "//Suite/test" ) );
+   CPPUT_CHECK( !isSelected( filter, "//Suite/testSlow" ) );
+   CPPUT_CHECK( isPruned( filter, "//SlowSuite" ) );
+   CPPUT_CHECK( !isPruned( filter, "//Suite" ) );
+}
+
+
+CPPUT_TEST_FUNCTION( testSubtreePruning )
+{
+   CppUT::TestPathFilter filter;
+   filter.addInclude( "//Json/Reader/*" );
+   CPPUT_CHECK( !isPruned( filter, "/" ) );
+   CPPUT_CHECK( !isPruned( filter, "//Json" ) );
+   CPPUT_CHECK( isPruned( filter, "//Xml" ) );
+   CPPUT_CHECK( isPruned( filter, "//Json/Writer" ) );
+   CPPUT_CHECK( !isPruned( filter, "//Json/Reader" ) );
+}
+
+} // end suite TestPathFilter
@@ -356,6 +356,48 @@ static void testCaseMakeTestCaseFromFunctor()
 }
 
 
+static void testMetaDataDependencies()
+{
+   CppUT::MetaData meta( "withDependencies" );
+   CPPUT_ASSERT_EQUAL( 0, meta.dependencyCount() );
+   meta.setDependenciesFromPackedString( " testInit, Nested/test;//Root/other " );
+   meta.addDependency( "last" );
+   CPPUT_ASSERT_EQUAL( 4, meta.dependencyCount() );
+   CPPUT_ASSERT_EQUAL( std::string("testInit"), meta.dependencyAt( 0 ) );
+   CPPUT_ASSERT_EQUAL( std::string("Nested/test"), meta.dependencyAt( 1 ) );
+   CPPUT_ASSERT_EQUAL( std::string("//Root/other"), meta.dependencyAt( 2 ) );
+   CPPUT_ASSERT_EQUAL( std::string("last"), meta.dependencyAt( 3 ) );
+}
+
+
+static void testMetaDataToJson()
+{
+   CppUT::MetaData meta( "withMeta" );
+   meta.setDescription( "described" );
+   meta.setTimeOut( 2.5 );
+   meta.addToGroup( "slow" );
+   meta.addToGroup( "io" );
+   meta.requireResource( "database" );
+   meta.requireResource( "database" );
+   meta.addDependency( "testInit" );
+   CPPUT_ASSERT_EQUAL( 1, meta.resourceCount() );
+
+   CppUT::MetaData copy( meta );
+   CPPUT_ASSERT_EXPR( copy.internedName() == meta.internedName() );
+
+   Json::Value data = meta.toJson();
+   const Json::Value &configuration = data["configuration"];
+   CPPUT_ASSERT_EQUAL( std::string("withMeta"), configuration["name"].asString() );
+   CPPUT_ASSERT_EQUAL( std::string("described"), configuration["description"].asString() );
+   CPPUT_ASSERT_EQUAL( 2.5, configuration["timeOut"].asDouble() );
+   CPPUT_ASSERT_EQUAL( 2u, configuration["groups"].size() );
+   CPPUT_ASSERT_EQUAL( std::string("io"), configuration["groups"][1].asString() );
+   CPPUT_ASSERT_EQUAL( 1u, configuration["resources"].size() );
+   CPPUT_ASSERT_EQUAL( std::string("testInit"), configuration["dependencies"][0].asString() );
+   CPPUT_ASSERT_EXPR( data["input"].isObject() );
+}
+
+
 static void testRunFixture()
 {
    ///@todo fix this
@@ -412,6 +454,8 @@ bool testTestCase()
       testCaseMakeTestCaseFromFunction();
       testCaseMakeTestCaseFromFunctor0();
       testCaseMakeTestCaseFromFunctor();
+      testMetaDataDependencies();
+      testMetaDataToJson();
 /// @todo fix this
 //      testRunFixture();
 //      testParametrizedFixture();
@@ -0,0 +1,106 @@
+#include <cpput/assertcommon.h>
+#include <cpput/testing.h>
+#include <cpptl/workqueue.h>
+#include <vector>
+
+namespace {
+
+#if CPPTL_HAS_THREAD
+   typedef CppTL::WorkStealingQueue<int> IntQueue;
+
+   /// Takes items from a queue until it is empty, as the owner or as a thief.
+   class QueueConsumer
+   {
+   public:
+      QueueConsumer( IntQueue &queue,
+                     bool isOwner )
+         : queue_( queue )
+         , isOwner_( isOwner )
+      {
+      }
+
+      void run()
+      {
+         int value;
+         while ( isOwner_ ? queue_.pop( value ) : queue_.steal( value ) )
+            taken_.push_back( value );
+      }
+
+      IntQueue &queue_;
+      bool isOwner_;
+      std::vector<int> taken_;
+   };
+#endif
+
+}
+
+
+CPPUT_SUITE( "WorkStealingQueue" ) {
+
+CPPUT_TEST_FUNCTION( testOwnerPopsFrontAndThievesStealBack )
+{
+   CppTL::WorkStealingQueue<int> queue;
+   CPPUT_CHECK( queue.empty() );
+   queue.push( 1 );
+   queue.push( 2 );
+   queue.push( 3 );
+   CPPUT_CHECK( !queue.empty() );
+
+   int value = 0;
+   CPPUT_CHECK( queue.pop( value )  &&  value == 1 );
+   CPPUT_CHECK( queue.steal( value )  &&  value == 3 );
+   CPPUT_CHECK( queue.pop( value )  &&  value == 2 );
+   CPPUT_CHECK( queue.empty() );
+   CPPUT_CHECK( !queue.pop( value ) );
+   CPPUT_CHECK( !queue.steal( value ) );
+}
+
+
+#if CPPTL_HAS_THREAD
+CPPUT_TEST_FUNCTION( testConcurrentConsumersTakeEachItemOnce )
+{
+   const int itemCount = 20000;
+   const unsigned int thiefCount = 4;
+   IntQueue queue;
+   for ( int item = 0; item < itemCount; ++item )
+      queue.push( item );
+
+   QueueConsumer owner( queue, true );
+   std::vector<QueueConsumer *> thieves;
+   std::vector<CppTL::Thread *> threads;
+   for ( unsigned int thief = 0; thief < thiefCount; ++thief )
+   {
+      thieves.push_back( new QueueConsumer( queue, false ) );
+      threads.push_back( new CppTL::Thread() );
+      CPPUT_CHECK( threads.back()->start( CppTL::memfn0( thieves.back(), &QueueConsumer::run ) ) );
+   }
+   owner.run();
+
+   std::vector<int> takenCounts( itemCount, 0 );
+   for ( std::vector<int>::const_iterator it = owner.taken_.begin(); it != owner.taken_.end(); ++it )
+      ++takenCounts[*it];
+   // The owner takes its items in the order they were pushed.
+   for ( unsigned int index = 1; index < owner.taken_.size(); ++index )
+      CPPUT_CHECK( owner.taken_[index - 1] < owner.taken_[index] );
+   for ( unsigned int thief = 0; thief < thiefCount; ++thief )
+   {
+      CPPUT_CHECK( threads[thief]->join() );
+      const std::vector<int> &taken = thieves[thief]->taken_;
+      for ( std::vector<int>::const_iterator it = taken.begin(); it != taken.end(); ++it )
+         ++takenCounts[*it];
+      delete threads[thief];
+      delete thieves[thief];
+   }
+
+   CPPUT_CHECK( queue.empty() );
+   int missingOrDuplicateCount = 0;
+   for ( int item = 0; item < itemCount; ++item )
+   {
+      if ( takenCounts[item] != 1 )
+         ++missingOrDuplicateCount;
+   }
+   CPPUT_CHECK( missingOrDuplicateCount == 0 );
+}
+#endif
+
+} // end suite WorkStealingQueue